@@ -0,0 +1,118 @@
+// Micro-benchmark for batched terrain height queries.
+// Compares TerrainSampling::SampleHeights (used by TerrainGrid::GetHeightsAtWorldPos)
+// with the scalar per-sample path of TerrainGrid::GetHeightAtWorldPos, on random
+// positions (worst case for the gather) and on a coherent ray-march pattern.
+//
+// Build with -DBUILDSIM_BUILD_BENCHMARKS=ON and run HeightQueryBenchmark.
+
+#include "Grid/TerrainSampling.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+// TerrainGrid::GetHeightAtWorldPos with its bounds-checked GetHeight calls
+struct ScalarGrid {
+    const std::vector<float>& heights;
+    int width, depth;
+    float worldScale;
+
+    float GetHeight(int x, int z) const {
+        if (x < 0 || x >= width || z < 0 || z >= depth) return 0.0f;
+        size_t index = static_cast<size_t>(z) * width + x;
+        return index < heights.size() ? heights[index] : 0.0f;
+    }
+
+    float GetHeightAtWorldPos(float worldX, float worldZ) const {
+        float gridX = worldX / worldScale;
+        float gridZ = worldZ / worldScale;
+        int x0 = static_cast<int>(std::floor(gridX));
+        int z0 = static_cast<int>(std::floor(gridZ));
+        int x1 = x0 + 1;
+        int z1 = z0 + 1;
+        if (x0 < 0 || x1 >= width || z0 < 0 || z1 >= depth) return 0.0f;
+        float fx = gridX - x0;
+        float fz = gridZ - z0;
+        float h0 = GetHeight(x0, z0) * (1.0f - fx) + GetHeight(x1, z0) * fx;
+        float h1 = GetHeight(x0, z1) * (1.0f - fx) + GetHeight(x1, z1) * fx;
+        return h0 * (1.0f - fz) + h1 * fz;
+    }
+};
+
+template <typename Fn>
+double BestOfMs(int runs, Fn&& fn)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+} // namespace
+
+int main()
+{
+    const float worldScale = 5.0f;
+    const size_t sampleCount = 4 * 1000 * 1000;
+    const int sizes[] = { 250, 1024, 4096 };
+
+    std::printf("%-6s %-8s %14s %14s %14s %10s\n", "size", "pattern", "scalar Ms/s", "batched Ms/s", "+normal Ms/s", "max err");
+    for (int size : sizes) {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> heightDist(0.0f, 120.0f);
+        std::vector<float> heights(static_cast<size_t>(size) * size);
+        for (float& h : heights) h = heightDist(rng);
+        ScalarGrid grid{ heights, size, size, worldScale };
+
+        // Random positions, including a margin outside the grid
+        float extent = size * worldScale;
+        std::uniform_real_distribution<float> posDist(-0.05f * extent, 1.05f * extent);
+        std::vector<vec2> randomPositions(sampleCount);
+        for (vec2& p : randomPositions) p = vec2(posDist(rng), posDist(rng));
+
+        // Rays marched in 0.5-unit steps like Camera::GetTerrainIntersection
+        std::vector<vec2> rayPositions(sampleCount);
+        for (size_t i = 0; i < sampleCount; i += 4000) {
+            vec2 origin(posDist(rng), posDist(rng));
+            float angle = posDist(rng);
+            vec2 dir(std::cos(angle), std::sin(angle));
+            for (size_t k = 0; k < 4000 && i + k < sampleCount; k++) rayPositions[i + k] = origin + dir * (0.5f * k);
+        }
+
+        const std::pair<const char*, std::vector<vec2>*> patterns[] = { { "random", &randomPositions }, { "ray", &rayPositions } };
+        for (const auto& pattern : patterns) {
+            const std::vector<vec2>& positions = *pattern.second;
+            std::vector<float> scalarOut(sampleCount), batchedOut(sampleCount);
+            std::vector<vec3> normals(sampleCount);
+
+            double scalarMs = BestOfMs(3, [&] {
+                for (size_t i = 0; i < sampleCount; i++) scalarOut[i] = grid.GetHeightAtWorldPos(positions[i].x, positions[i].y);
+            });
+            double batchedMs = BestOfMs(3, [&] {
+                TerrainSampling::SampleHeights(heights.data(), size, size, worldScale, positions.data(),
+                                               batchedOut.data(), nullptr, sampleCount);
+            });
+            double normalMs = BestOfMs(3, [&] {
+                TerrainSampling::SampleHeights(heights.data(), size, size, worldScale, positions.data(),
+                                               batchedOut.data(), normals.data(), sampleCount);
+            });
+
+            float maxError = 0.0f;
+            for (size_t i = 0; i < sampleCount; i++) maxError = std::max(maxError, std::fabs(scalarOut[i] - batchedOut[i]));
+
+            auto rate = [&](double ms) { return sampleCount / ms / 1000.0; };
+            std::printf("%-6d %-8s %14.1f %14.1f %14.1f %10.2e\n", size, pattern.first,
+                        rate(scalarMs), rate(batchedMs), rate(normalMs), maxError);
+        }
+    }
+    return 0;
+}
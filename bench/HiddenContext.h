@@ -0,0 +1,46 @@
+// Hidden GLFW window for benchmarks of code that creates GL objects (terrain meshes,
+// object loaders) but never draws. Its context is current for as long as it lives.
+#pragma once
+
+#include "Core/Window.h"
+
+#include <cstdio>
+
+class HiddenContext {
+public:
+    HiddenContext()
+    {
+        if (!glfwInit()) {
+            std::fprintf(stderr, "Failed to initialize GLFW\n");
+            return;
+        }
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        // The same context the app gets, so GL feature checks answer alike
+        m_window = Window::createContextWindow(64, 64, "benchmark");
+        if (!m_window) {
+            std::fprintf(stderr, "Failed to create a hidden GL window\n");
+            return;
+        }
+        glfwMakeContextCurrent(m_window);
+        glewExperimental = GL_TRUE;
+        if (glewInit() != GLEW_OK) {
+            std::fprintf(stderr, "Failed to initialize GLEW\n");
+            glfwDestroyWindow(m_window);
+            m_window = nullptr;
+        }
+    }
+
+    ~HiddenContext()
+    {
+        if (m_window) glfwDestroyWindow(m_window);
+        glfwTerminate();
+    }
+
+    HiddenContext(const HiddenContext&) = delete;
+    HiddenContext& operator=(const HiddenContext&) = delete;
+
+    bool IsValid() const { return m_window != nullptr; }
+
+private:
+    GLFWwindow* m_window = nullptr;
+};
@@ -0,0 +1,119 @@
+// Micro-benchmark for terrain normal generation.
+// Compares the per-vertex virtual GetHeight path that GridMesh::CalculateNormals
+// uses for generic grids with TerrainNormals (single- and multi-threaded), and a
+// dirty-rectangle update the size of a default brush stroke.
+//
+// Build with -DBUILDSIM_BUILD_BENCHMARKS=ON and run NormalsBenchmark.
+
+#include "Grid/TerrainNormals.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct HeightSource {
+    virtual ~HeightSource() = default;
+    virtual float GetHeight(int x, int z) const = 0;
+};
+
+// Same bounds checks as TerrainGrid::GetHeight
+struct HeightmapSource : HeightSource {
+    const std::vector<float>& heights;
+    int width, depth;
+    HeightmapSource(const std::vector<float>& h, int w, int d) : heights(h), width(w), depth(d) {}
+    float GetHeight(int x, int z) const override {
+        if (x < 0 || x >= width || z < 0 || z >= depth) return 0.0f;
+        size_t index = static_cast<size_t>(z) * width + x;
+        return index < heights.size() ? heights[index] : 0.0f;
+    }
+};
+
+struct Vertex {
+    vec3 position;
+    vec2 texCoord;
+    vec3 normal;
+    float splatWeights[5];
+};
+
+// The loop GridMesh::CalculateNormals runs for a generic BaseGrid
+void ReferenceNormals(const HeightSource& grid, int width, int depth, float s, std::vector<Vertex>& out)
+{
+    for (int z = 0; z < depth; z++) {
+        for (int x = 0; x < width; x++) {
+            vec3 tangentX, tangentZ;
+            if (x == 0) tangentX = vec3(s, grid.GetHeight(x + 1, z) - grid.GetHeight(x, z), 0.0f);
+            else if (x == width - 1) tangentX = vec3(s, grid.GetHeight(x, z) - grid.GetHeight(x - 1, z), 0.0f);
+            else tangentX = vec3(2.0f * s, grid.GetHeight(x + 1, z) - grid.GetHeight(x - 1, z), 0.0f);
+
+            if (z == 0) tangentZ = vec3(0.0f, grid.GetHeight(x, z + 1) - grid.GetHeight(x, z), s);
+            else if (z == depth - 1) tangentZ = vec3(0.0f, grid.GetHeight(x, z) - grid.GetHeight(x, z - 1), s);
+            else tangentZ = vec3(0.0f, grid.GetHeight(x, z + 1) - grid.GetHeight(x, z - 1), 2.0f * s);
+
+            vec3 normal = normalize(cross(tangentZ, tangentX));
+            if (length(normal) < 0.0001f) normal = vec3(0.0f, 1.0f, 0.0f);
+            out[static_cast<size_t>(z) * width + x].normal = normal;
+        }
+    }
+}
+
+template <typename Fn>
+double BestOfMs(int runs, Fn&& fn)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+} // namespace
+
+int main()
+{
+    const float worldScale = 5.0f;
+    const int sizes[] = { 250, 1024, 4096 };
+
+    std::printf("%-6s %12s %12s %12s %12s %10s\n", "size", "virtual ms", "simd ms", "simd+mt ms", "brush us", "max err");
+    for (int size : sizes) {
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> dist(0.0f, 120.0f);
+        std::vector<float> heights(static_cast<size_t>(size) * size);
+        for (float& h : heights) h = dist(rng);
+
+        HeightmapSource source(heights, size, size);
+        std::vector<Vertex> reference(heights.size()), fast(heights.size());
+        int runs = size > 1024 ? 3 : 10;
+
+        double virtualMs = BestOfMs(runs, [&] { ReferenceNormals(source, size, size, worldScale, reference); });
+        double simdMs = BestOfMs(runs, [&] {
+            TerrainNormals::Compute(heights.data(), size, size, worldScale, { 0, 0, size - 1, size - 1 },
+                                    &fast[0].normal, sizeof(Vertex));
+        });
+        double parallelMs = BestOfMs(runs, [&] {
+            TerrainNormals::ComputeAll(heights.data(), size, size, worldScale, &fast[0].normal, sizeof(Vertex));
+        });
+
+        // A 15-unit brush at world scale 5 touches a 7x7 block, 9x9 with the normal border
+        int c = size / 2;
+        double brushUs = 1000.0 * BestOfMs(100, [&] {
+            TerrainNormals::Compute(heights.data(), size, size, worldScale, { c - 4, c - 4, c + 4, c + 4 },
+                                    &fast[0].normal, sizeof(Vertex));
+        });
+
+        float maxError = 0.0f;
+        for (size_t i = 0; i < heights.size(); i++) {
+            vec3 d = reference[i].normal - fast[i].normal;
+            maxError = std::max({ maxError, std::fabs(d.x), std::fabs(d.y), std::fabs(d.z) });
+        }
+
+        std::printf("%-6d %12.3f %12.3f %12.3f %12.2f %10.2e\n", size, virtualMs, simdMs, parallelMs, brushUs, maxError);
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+// Benchmark for generatePopulation, the rule-based pass that covers a generated terrain
+// with props. Populates a 4096x4096 world (a 4097x4097 heightmap at scale 1) with the
+// rock, tree and bush habitats main.cpp uses, then checks the output: repeated runs must
+// give identical instances, and no two instances may be closer than their rules allow
+// (a rule's spacing among its own, the mean of both spacings across rules).
+//
+// Needs a display for its hidden GL window (the terrain mesh creates GL objects). Build
+// with -DBUILDSIM_BUILD_BENCHMARKS=ON and run PopulationBenchmark.
+
+#include "HiddenContext.h"
+#include "Grid/TerrainGrid.h"
+#include "ObjectLoader/ObjectPopulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+template <typename Fn>
+double BestOfMs(int runs, Fn&& fn)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+bool SameInstances(const std::vector<std::vector<ScatterInstance>>& a, const std::vector<std::vector<ScatterInstance>>& b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t rule = 0; rule < a.size(); rule++) {
+        if (a[rule].size() != b[rule].size()) return false;
+        if (!a[rule].empty() && std::memcmp(a[rule].data(), b[rule].data(), a[rule].size() * sizeof(ScatterInstance)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct SpacingReport {
+    size_t violations = 0;
+    float worstRatio = 1e30f; // Smallest distance over required distance
+};
+
+// Buckets every instance in cells as wide as the largest spacing, so each pair that could
+// conflict lies in neighbouring cells
+SpacingReport CheckSpacing(const std::vector<std::vector<ScatterInstance>>& instances, const std::vector<PopulationRule>& rules,
+                           float sizeX, float sizeZ)
+{
+    float cellSize = 0.0f;
+    for (const PopulationRule& rule : rules) cellSize = std::max(cellSize, rule.spacing);
+    const int cellsX = static_cast<int>(sizeX / cellSize) + 1;
+    const int cellsZ = static_cast<int>(sizeZ / cellSize) + 1;
+    auto cellOf = [&](const ScatterInstance& instance) {
+        int x = std::min(std::max(static_cast<int>(instance.position[0] / cellSize), 0), cellsX - 1);
+        int z = std::min(std::max(static_cast<int>(instance.position[2] / cellSize), 0), cellsZ - 1);
+        return z * cellsX + x;
+    };
+
+    struct Entry {
+        const ScatterInstance* instance;
+        size_t rule;
+    };
+    std::vector<std::vector<Entry>> cells(static_cast<size_t>(cellsX) * cellsZ);
+    for (size_t rule = 0; rule < instances.size(); rule++) {
+        for (const ScatterInstance& instance : instances[rule]) cells[cellOf(instance)].push_back({ &instance, rule });
+    }
+
+    SpacingReport report;
+    for (int z = 0; z < cellsZ; z++) {
+        for (int x = 0; x < cellsX; x++) {
+            for (const Entry& a : cells[z * cellsX + x]) {
+                for (int nz = std::max(z - 1, 0); nz <= std::min(z + 1, cellsZ - 1); nz++) {
+                    for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, cellsX - 1); nx++) {
+                        for (const Entry& b : cells[nz * cellsX + nx]) {
+                            if (b.instance <= a.instance) continue; // Each pair once
+                            float dx = a.instance->position[0] - b.instance->position[0];
+                            float dz = a.instance->position[2] - b.instance->position[2];
+                            float required = 0.5f * (rules[a.rule].spacing + rules[b.rule].spacing);
+                            float ratio = std::sqrt(dx * dx + dz * dz) / required;
+                            report.worstRatio = std::min(report.worstRatio, ratio);
+                            if (ratio < 1.0f) report.violations++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return report;
+}
+
+} // namespace
+
+int main()
+{
+    HiddenContext context;
+    if (!context.IsValid()) return 1;
+
+    const int heightmapSize = 4097;
+    const float worldScale = 1.0f;
+    TerrainGrid terrain;
+    terrain.Init(heightmapSize, heightmapSize, worldScale, 10.0f, TerrainGrid::TerrainType::VOLCANIC_CALDERA, 120.0f, 0.25f);
+
+    // main.cpp's habitats; rules without an asset are sampled all the same
+    struct Habitat {
+        const char* name;
+        int splatLayer;
+        float minSlope, maxSlope;
+        float spacing;
+        float density;
+    };
+    const Habitat habitats[] = {
+        { "rock", 3, 25.0f, 90.0f, 10.0f, 0.6f },
+        { "tree", 1,  0.0f, 25.0f,  9.0f, 0.7f },
+        { "bush", 1,  0.0f, 30.0f,  5.0f, 0.3f },
+    };
+    std::vector<PopulationRule> rules;
+    for (const Habitat& habitat : habitats) {
+        PopulationRule rule;
+        rule.baseTransform = mat4(1.0f);
+        rule.splatLayer = habitat.splatLayer;
+        rule.minSlope = habitat.minSlope;
+        rule.maxSlope = habitat.maxSlope;
+        rule.spacing = habitat.spacing;
+        rule.density = habitat.density;
+        rules.push_back(rule);
+    }
+
+    const uint32_t seed = 0x5EED;
+    std::vector<std::vector<ScatterInstance>> first;
+    std::vector<std::vector<ScatterInstance>> instances;
+    generatePopulation(terrain, rules, seed, first);
+    bool deterministic = true;
+    double ms = BestOfMs(5, [&] {
+        generatePopulation(terrain, rules, seed, instances);
+        deterministic = deterministic && SameInstances(first, instances);
+    });
+
+    const float size = (heightmapSize - 1) * worldScale;
+    SpacingReport spacing = CheckSpacing(first, rules, size, size);
+
+    size_t total = 0;
+    for (size_t rule = 0; rule < rules.size(); rule++) {
+        std::printf("%-6s %10zu instances\n", habitats[rule].name, first[rule].size());
+        total += first[rule].size();
+    }
+    std::printf("total  %10zu instances in %.1f ms\n", total, ms);
+    std::printf("repeated runs identical: %s\n", deterministic ? "yes" : "NO");
+    std::printf("spacing violations: %zu (closest pair at %.4f of its spacing)\n", spacing.violations, spacing.worstRatio);
+    return deterministic && spacing.violations == 0 ? 0 : 1;
+}
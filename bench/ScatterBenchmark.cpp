@@ -0,0 +1,81 @@
+// Benchmark for ScatterLayer::Scatter, one brush dab of Poisson-disk instances.
+// Dabs the largest brush (radius 50) onto the default terrain at shrinking spacings up to
+// about 50k instances, first on empty ground and then half over an earlier dab so the
+// existing instances block the new ones. One dab should stay within a couple of frames.
+//
+// Needs a display for its hidden GL window (the terrain mesh and the object loader
+// create GL objects). Build with -DBUILDSIM_BUILD_BENCHMARKS=ON and run ScatterBenchmark.
+
+#include "HiddenContext.h"
+#include "Core/Shader.h"
+#include "Grid/TerrainGrid.h"
+#include "ObjectLoader/ObjectLoader.h"
+#include "ObjectLoader/ScatterLayer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+template <typename Fn>
+double BestOfMs(int runs, Fn&& fn)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+} // namespace
+
+int main()
+{
+    HiddenContext context;
+    if (!context.IsValid()) return 1;
+
+    // The terrain main.cpp generates
+    TerrainGrid terrain;
+    terrain.Init(250, 250, 5.0f, 10.0f, TerrainGrid::TerrainType::VOLCANIC_CALDERA, 120.0f, 0.25f);
+    Shader shader;
+    ObjectLoader asset(shader); // Never loaded: Scatter only needs its default bounds
+    const mat4 baseTransform(1.0f);
+
+    const float centerX = 625.0f, centerZ = 625.0f, radius = 50.0f;
+    const float spacings[] = { 1.0f, 0.6f, 0.35f };
+
+    // One long-lived layer, as in the app, so its scratch buffers are warm; each dab is
+    // erased again outside the timing
+    ScatterLayer layer;
+    std::printf("%-8s %-7s %10s %10s %14s\n", "spacing", "ground", "instances", "ms", "ns/instance");
+    for (float spacing : spacings) {
+        ScatterLayer::BrushSettings brush;
+        brush.spacing = spacing;
+
+        size_t added = 0;
+        double emptyMs = 1e30;
+        for (int run = 0; run < 5; run++) {
+            emptyMs = std::min(emptyMs, BestOfMs(1, [&] {
+                added = layer.Scatter(asset, baseTransform, terrain, centerX, centerZ, radius, brush);
+            }));
+            layer.Erase(centerX, centerZ, radius + spacing);
+        }
+        std::printf("%-8.2f %-7s %10zu %10.2f %14.1f\n", spacing, "empty", added, emptyMs, emptyMs * 1e6 / added);
+
+        size_t refilled = 0;
+        double refillMs = 1e30;
+        for (int run = 0; run < 5; run++) {
+            layer.Scatter(asset, baseTransform, terrain, centerX, centerZ, radius, brush);
+            refillMs = std::min(refillMs, BestOfMs(1, [&] {
+                refilled = layer.Scatter(asset, baseTransform, terrain, centerX + radius, centerZ, radius, brush);
+            }));
+            layer.Erase(centerX + 0.5f * radius, centerZ, 2.0f * radius);
+        }
+        std::printf("%-8.2f %-7s %10zu %10.2f %14.1f\n", spacing, "overlap", refilled, refillMs, refillMs * 1e6 / refilled);
+    }
+    return 0;
+}
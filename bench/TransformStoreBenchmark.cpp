@@ -0,0 +1,133 @@
+// Micro-benchmark for TransformStore::Update, the per-frame rebuild of dirty model matrices.
+// Compares Angel's Translate * RotateZ * RotateY * RotateX * Scale per object (what
+// GameObject did before the store) with the batched update on one thread and on all of
+// them, for every object dirty and for a few scattered edits. The target is under 1 ms
+// for 100k dirty transforms; the last line says whether this machine meets it, on one
+// thread and on all of them.
+//
+// Build with -DBUILDSIM_BUILD_BENCHMARKS=ON and run TransformStoreBenchmark.
+
+#include "ObjectLoader/TransformStore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+template <typename Fn>
+double BestOfMs(int runs, Fn&& fn)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+struct Transform {
+    vec3 position;
+    vec3 rotation;
+    float scale;
+};
+
+} // namespace
+
+int main()
+{
+    const size_t counts[] = { 10000, 100000, 400000 };
+    const size_t targetCount = 100000;
+    const double targetMs = 1.0;
+    const size_t scatteredEdits = 1000;
+    const unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::printf("%u hardware threads\n", threads);
+    std::printf("%-8s %12s %12s %12s %14s %10s\n", "objects", "angel ms", "1 thread ms", "all ms", "1k edits ms", "max err");
+    double targetSingleMs = 0.0, targetParallelMs = 0.0;
+    for (size_t count : counts) {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> positionDist(0.0f, 5000.0f);
+        std::uniform_real_distribution<float> angleDist(-180.0f, 180.0f);
+        std::uniform_real_distribution<float> scaleDist(0.5f, 3.0f);
+        std::vector<Transform> transforms(count);
+        for (Transform& t : transforms) {
+            t.position = vec3(positionDist(rng), positionDist(rng), positionDist(rng));
+            t.rotation = vec3(angleDist(rng), angleDist(rng), angleDist(rng));
+            t.scale = scaleDist(rng);
+        }
+
+        TransformStore store;
+        store.Reserve(count);
+        for (const Transform& t : transforms) {
+            size_t index = store.Add();
+            store.SetPosition(index, t.position);
+            store.SetRotation(index, t.rotation);
+            store.SetScale(index, t.scale);
+        }
+        store.Update();
+
+        std::vector<mat4> reference(count);
+        double angelMs = BestOfMs(5, [&] {
+            for (size_t i = 0; i < count; i++) {
+                const Transform& t = transforms[i];
+                reference[i] = transpose(Translate(t.position) * RotateZ(t.rotation.z) * RotateY(t.rotation.y) *
+                                         RotateX(t.rotation.x) * Scale(t.scale));
+            }
+        });
+
+        // Re-dirty everything by setting the scale it already has, outside the timing
+        auto dirtyAll = [&] {
+            for (size_t i = 0; i < count; i++) store.SetScale(i, transforms[i].scale);
+        };
+        auto timedUpdate = [&](unsigned int maxThreads) {
+            double best = 1e30;
+            for (int run = 0; run < 10; run++) {
+                dirtyAll();
+                best = std::min(best, BestOfMs(1, [&] { store.Update(maxThreads); }));
+            }
+            return best;
+        };
+        double singleMs = timedUpdate(1);
+        double parallelMs = timedUpdate(0);
+        if (count == targetCount) {
+            targetSingleMs = singleMs;
+            targetParallelMs = parallelMs;
+        }
+
+        std::uniform_int_distribution<size_t> indexDist(0, count - 1);
+        double editsMs = 1e30;
+        for (int run = 0; run < 10; run++) {
+            for (size_t e = 0; e < scatteredEdits; e++) {
+                size_t i = indexDist(rng);
+                store.SetPosition(i, transforms[i].position);
+            }
+            editsMs = std::min(editsMs, BestOfMs(1, [&] { store.Update(); }));
+        }
+
+        float maxError = 0.0f;
+        for (size_t i = 0; i < count; i++) {
+            const mat4& m = store.GetInstanceMatrix(i);
+            for (int row = 0; row < 4; row++) {
+                for (int column = 0; column < 4; column++) {
+                    // Relative to the translation's magnitude for the last row
+                    float magnitude = std::max(1.0f, std::fabs(reference[i][row][column]));
+                    maxError = std::max(maxError, std::fabs(m[row][column] - reference[i][row][column]) / magnitude);
+                }
+            }
+        }
+
+        std::printf("%-8zu %12.3f %12.3f %12.3f %14.3f %10.2e\n", count, angelMs, singleMs, parallelMs, editsMs, maxError);
+    }
+
+    std::printf("target: %zu dirty in under %.1f ms: 1 thread %.3f ms (%s), %u threads %.3f ms (%s)\n", targetCount, targetMs,
+                targetSingleMs, targetSingleMs < targetMs ? "met" : "missed", threads, targetParallelMs,
+                targetParallelMs < targetMs ? "met" : "missed");
+    return 0;
+}
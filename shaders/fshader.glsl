@@ -11,6 +11,7 @@ in vec2 outTexCoord;        // Texture coordinates from vertex shader
 in vec3 outWorldPos;        // World position from vertex shader
 in vec3 outNormal_world;    // World-space normal from vertex shader
 in vec4 outWorldPosLightSpace; // NEW: World position from the light's perspective
+flat in int outTextureLayer;   // Layer of objectTextureArray
 
 // Texture samplers for terrain layers - now 5 textures
 uniform sampler2D gTextureHeight0; // Sand
@@ -21,6 +22,9 @@ uniform sampler2D gTextureHeight4; // Snow
 
 // Separate texture sampler for objects
 uniform sampler2D objectTexture;
+// Objects imported with texture arrays sample a layer of their size class's array instead
+uniform sampler2DArray objectTextureArray;
+uniform bool u_textureArray;
 
 // Height thresholds for blending textures (for terrain) - kept for compatibility but not used with splat weights
 // NEW: Shadow map sampler
@@ -141,6 +145,8 @@ void main()
     if (u_isTerrain) {
         // Use splat weights for terrain blending
         albedo = CalculateBlendedTextureColorFromWeights();
+    } else if (u_textureArray) {
+        albedo = texture(objectTextureArray, vec3(outTexCoord, float(outTextureLayer)));
     } else {
         albedo = texture(objectTexture, outTexCoord);
     }
@@ -1,11 +1,31 @@
 #version 410
 
 layout (location = 0) in vec4 vPosition;
+layout (location = 5) in mat4 iModelMatrix; // Per-instance model matrix for objects (locations 5-8)
+layout (location = 9) in vec3 iScatterPosition;  // Per-instance ScatterInstance for brush-scattered objects
+layout (location = 10) in vec2 iScatterYawScale; // Fractions of a turn and of u_scatterMaxScale
 
 uniform mat4 gLightSpaceMatrix;
 uniform mat4 gModelMatrix;
+uniform bool u_instanced;
+uniform bool u_scatter;    // See vshader.glsl
+uniform float u_scatterMaxScale;
+uniform bool u_packedVertex;    // Objects use the compact PackedVertex layout (see vshader.glsl)
+uniform vec3 u_positionOffset;
+uniform vec3 u_positionScale;
+
+mat4 ScatterMatrix()
+{
+    float yaw = iScatterYawScale.x * 6.28318530718;
+    float s = iScatterYawScale.y * u_scatterMaxScale;
+    float c = cos(yaw) * s;
+    float n = sin(yaw) * s;
+    return mat4(vec4(c, 0.0, -n, 0.0), vec4(0.0, s, 0.0, 0.0), vec4(n, 0.0, c, 0.0), vec4(iScatterPosition, 1.0));
+}
 
 void main()
 {
-    gl_Position = gLightSpaceMatrix * gModelMatrix * vPosition;
+    mat4 modelMatrix = u_scatter ? ScatterMatrix() * gModelMatrix : (u_instanced ? iModelMatrix : gModelMatrix);
+    vec4 position = u_packedVertex ? vec4(u_positionOffset + vPosition.xyz * u_positionScale, 1.0) : vPosition;
+    gl_Position = gLightSpaceMatrix * modelMatrix * position;
 }
@@ -1,14 +1,22 @@
 #version 410
 
-layout (location = 0) in vec4 vPosition;   // Vertex position (model space)
-layout (location = 1) in vec2 vTexCoord;
-layout (location = 2) in vec3 vNormal;     // Vertex normal (model space)
+layout (location = 0) in vec4 vPosition;   // Vertex position (model space; snorm16 for packed objects, .w their texture layer)
+layout (location = 1) in vec2 vTexCoord;   // Half floats for packed objects, converted by GL
+layout (location = 2) in vec3 vNormal;     // Vertex normal (model space; octahedral in .xy for packed objects)
 layout (location = 3) in vec4 vSplatWeights1234; // First 4 splat weights (sand, grass, dirt, rock)
 layout (location = 4) in float vSplatWeight5;    // Fifth splat weight (snow)
-layout (location = 3) in vec4 vColor;
+layout (location = 5) in mat4 iModelMatrix; // Per-instance model matrix for objects (locations 5-8)
+layout (location = 9) in vec3 iScatterPosition;  // Per-instance ScatterInstance for brush-scattered objects
+layout (location = 10) in vec2 iScatterYawScale; // Fractions of a turn and of u_scatterMaxScale
 
 uniform mat4 gVP;          // Combined View * Projection matrix
 uniform mat4 gModelMatrix; // Model matrix (transforms model to world space)
+uniform bool u_instanced;  // Objects take their model matrix from the instance buffer
+uniform bool u_scatter;    // Objects are ScatterInstances; gModelMatrix is then the asset's base transform
+uniform float u_scatterMaxScale;
+uniform bool u_packedVertex;    // Objects use the compact PackedVertex layout
+uniform vec3 u_positionOffset;  // Packed position = offset + snorm * scale
+uniform vec3 u_positionScale;
 uniform mat4 gLightSpaceMatrix; // NEW: Transforms world to light space
 
 out vec4 baseColor;
@@ -19,24 +27,49 @@ out vec4 outSplatWeights1234; // Pass first 4 splat weights to fragment shader
 out float outSplatWeight5;     // Pass fifth splat weight to fragment shader
 // Pass normal (in world space) to fragment shader
 out vec4 outWorldPosLightSpace; // NEW: Pass light-space position to fragment shader
+flat out int outTextureLayer;   // Layer of objectTextureArray, for objects whose textures are in arrays
 
+// Translate * RotateY(yaw) * Scale of a ScatterInstance
+mat4 ScatterMatrix()
+{
+    float yaw = iScatterYawScale.x * 6.28318530718;
+    float s = iScatterYawScale.y * u_scatterMaxScale;
+    float c = cos(yaw) * s;
+    float n = sin(yaw) * s;
+    return mat4(vec4(c, 0.0, -n, 0.0), vec4(0.0, s, 0.0, 0.0), vec4(n, 0.0, c, 0.0), vec4(iScatterPosition, 1.0));
+}
+
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0); // Unfold the lower hemisphere
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
 
 void main()
 {
+    mat4 modelMatrix = u_scatter ? ScatterMatrix() * gModelMatrix : (u_instanced ? iModelMatrix : gModelMatrix);
+    vec4 position = u_packedVertex ? vec4(u_positionOffset + vPosition.xyz * u_positionScale, 1.0) : vPosition;
+    vec3 normal = u_packedVertex ? DecodeOctahedral(vNormal.xy) : vNormal;
+
     // Transform vertex position to world space
-    vec4 worldPos_vec4 = gModelMatrix * vPosition; // Use vPosition directly
+    vec4 worldPos_vec4 = modelMatrix * position;
     outWorldPos = worldPos_vec4.xyz;
 
     // Transform vertex position to clip space (for the camera)
     gl_Position = gVP * worldPos_vec4;
     
     // Transform normal to world space    
-    //outNormal_world = normalize(mat3(gModelMatrix) * vNormal);eray version
-    outNormal_world = normalize(mat3(transpose(inverse(gModelMatrix))) * vNormal);//main version
+    //outNormal_world = normalize(mat3(modelMatrix) * vNormal);eray version
+    outNormal_world = normalize(mat3(transpose(inverse(modelMatrix))) * normal);//main version
     // Pass through texture coordinates and splat weights
     outTexCoord = vTexCoord;
     outSplatWeights1234 = vSplatWeights1234;
     outSplatWeight5 = vSplatWeight5;
+    // PackedVertex stores the layer as an integer in the snorm16 w. Pre-4.2 GL normalizes
+    // c to (2c + 1) / 65535, half a step above c / 32767, so truncate rather than round.
+    outTextureLayer = u_packedVertex ? int(vPosition.w * 32767.0 + 0.25) : 0;
     
     // Set a default base color
      // NEW: Transform world position to light space for shadow mapping
@@ -0,0 +1,109 @@
+#include "AssetLoader.h"
+#include <exception>
+#include <iostream>
+
+AssetLoader::AssetLoader(unsigned int threadCount)
+    : m_pending(0), m_stopping(false)
+{
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    if (threadCount == 0) {
+        threadCount = 1; // hardware_concurrency may be unknown
+    }
+
+    m_workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        m_workers.emplace_back(&AssetLoader::WorkerLoop, this);
+    }
+}
+
+AssetLoader::~AssetLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_taskReady.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+    // Continuations that never ran are dropped; they may only touch GL on the owning thread
+}
+
+void AssetLoader::Submit(CPUTask task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+        ++m_pending;
+    }
+    m_taskReady.notify_one();
+}
+
+void AssetLoader::WorkerLoop()
+{
+    for (;;) {
+        CPUTask task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_taskReady.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+            if (m_stopping) return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        GLTask continuation;
+        try {
+            continuation = task();
+        } catch (const std::exception& e) {
+            std::cerr << "Asset loading task failed: " << e.what() << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            // Always queue something, even an empty continuation, so m_pending drains
+            m_completions.push_back(std::move(continuation));
+        }
+        m_completionReady.notify_one();
+    }
+}
+
+bool AssetLoader::PopCompletion(GLTask& task, bool wait)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (wait) {
+        m_completionReady.wait(lock, [this] { return !m_completions.empty() || m_pending == 0; });
+    }
+    if (m_completions.empty()) return false;
+
+    task = std::move(m_completions.front());
+    m_completions.pop_front();
+    return true;
+}
+
+size_t AssetLoader::ProcessCompletions()
+{
+    size_t processed = 0;
+    GLTask task;
+    while (PopCompletion(task, false)) {
+        if (task) task();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_pending;
+        }
+        ++processed;
+    }
+    return processed;
+}
+
+void AssetLoader::WaitAll()
+{
+    GLTask task;
+    while (PopCompletion(task, true)) {
+        // Continuations run outside the lock so they may Submit follow-up work
+        if (task) task();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_pending;
+    }
+}
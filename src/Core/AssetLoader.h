@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker pool for asset loading. Each submitted task does its CPU-side work
+// (file reads, decoding, importing) on a worker thread and returns the GL part
+// as a continuation. Continuations are queued and only ever run on the thread
+// that owns the GL context, from ProcessCompletions() or WaitAll().
+class AssetLoader {
+public:
+    using GLTask = std::function<void()>;
+    using CPUTask = std::function<GLTask()>;
+
+    // 0 threads = one per hardware core
+    explicit AssetLoader(unsigned int threadCount = 0);
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    void Submit(CPUTask task);
+
+    // Runs the GL continuations that are ready without blocking; returns how many ran
+    size_t ProcessCompletions();
+
+    // Blocks until every submitted task and its continuation has run
+    void WaitAll();
+
+    unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+private:
+    void WorkerLoop();
+    bool PopCompletion(GLTask& task, bool wait);
+
+    std::vector<std::thread> m_workers;
+    std::deque<CPUTask> m_tasks;
+    std::deque<GLTask> m_completions;
+    std::mutex m_mutex;
+    std::condition_variable m_taskReady;
+    std::condition_variable m_completionReady;
+    size_t m_pending;   // Submitted tasks whose continuation hasn't run yet
+    bool m_stopping;
+};
@@ -2,6 +2,7 @@
 
 #include "Angel.h"
 #include "Shader.h"
+#include <algorithm>
 
 struct PersProjInfo {
     float FOV;
@@ -65,29 +66,45 @@ public:
         vec3 rayOrigin = GetPosition();
         
         // Use smaller step size for more precision
-        float stepSize = 0.5f;
-        float maxDistance = 2000.0f; // Maximum raycast distance
+        const float stepSize = 0.5f;
+        const float maxDistance = 2000.0f; // Maximum raycast distance
+        const int stepCount = static_cast<int>(std::ceil(maxDistance / stepSize));
         
-        for (float distance = 0; distance < maxDistance; distance += stepSize) {
-            vec3 currentPoint = rayOrigin + rayDirection * distance;
-            
-            // Get terrain height at this point
-            float terrainHeight = grid->GetHeightAtWorldPos(currentPoint.x, currentPoint.z);
+        // March in batches so the terrain is sampled with one batched height query per batch
+        const int batchSize = 32;
+        vec2 samplePositions[batchSize];
+        float sampleHeights[batchSize];
+        
+        for (int firstStep = 0; firstStep < stepCount; firstStep += batchSize) {
+            int count = std::min(batchSize, stepCount - firstStep);
+            for (int i = 0; i < count; i++) {
+                vec3 point = rayOrigin + rayDirection * ((firstStep + i) * stepSize);
+                samplePositions[i] = vec2(point.x, point.z);
+            }
+            grid->GetHeightsAtWorldPos(samplePositions, sampleHeights, count);
             
-            // Check if we've hit the terrain (ray point is below terrain)
-            if (currentPoint.y <= terrainHeight) {
-                // Backtrack for more precision
-                vec3 prevPoint = rayOrigin + rayDirection * (distance - stepSize);
+            for (int i = 0; i < count; i++) {
+                float distance = (firstStep + i) * stepSize;
+                vec3 currentPoint = rayOrigin + rayDirection * distance;
+                
+                // Get terrain height at this point
+                float terrainHeight = sampleHeights[i];
                 
-                // Linear interpolation between the two points for better accuracy
-                float ratio = (terrainHeight - prevPoint.y) / (currentPoint.y - prevPoint.y);
-                if (ratio >= 0.0f && ratio <= 1.0f) {
-                    vec3 precisePoint = prevPoint + ratio * (currentPoint - prevPoint);
-                    intersectionPoint = vec3(precisePoint.x, terrainHeight, precisePoint.z);
-                } else {
-                    intersectionPoint = vec3(currentPoint.x, terrainHeight, currentPoint.z);
+                // Check if we've hit the terrain (ray point is below terrain)
+                if (currentPoint.y <= terrainHeight) {
+                    // Backtrack for more precision
+                    vec3 prevPoint = rayOrigin + rayDirection * (distance - stepSize);
+                    
+                    // Linear interpolation between the two points for better accuracy
+                    float ratio = (terrainHeight - prevPoint.y) / (currentPoint.y - prevPoint.y);
+                    if (ratio >= 0.0f && ratio <= 1.0f) {
+                        vec3 precisePoint = prevPoint + ratio * (currentPoint - prevPoint);
+                        intersectionPoint = vec3(precisePoint.x, terrainHeight, precisePoint.z);
+                    } else {
+                        intersectionPoint = vec3(currentPoint.x, terrainHeight, currentPoint.z);
+                    }
+                    return true;
                 }
-                return true;
             }
         }
         
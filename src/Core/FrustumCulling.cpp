@@ -0,0 +1,115 @@
+#include "FrustumCulling.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLING_SSE 1
+#endif
+
+namespace {
+
+// A box is outside once it is entirely behind any one plane
+inline bool BoxVisible(const FrustumCulling::Frustum& frustum, float cx, float cy, float cz,
+                       float ex, float ey, float ez)
+{
+    for (const vec4& plane : frustum.planes) {
+        float distance = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+        float radius = std::fabs(plane.x) * ex + std::fabs(plane.y) * ey + std::fabs(plane.z) * ez;
+        if (distance + radius < 0.0f) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+FrustumCulling::Frustum FrustumCulling::FromMatrix(const mat4& clipFromWorld)
+{
+    // Angel matrices are row-major: clip = M * p, so each clip coordinate is a row.
+    // -w <= x, y, z <= w gives the six planes.
+    const vec4& rowX = clipFromWorld[0];
+    const vec4& rowY = clipFromWorld[1];
+    const vec4& rowZ = clipFromWorld[2];
+    const vec4& rowW = clipFromWorld[3];
+
+    Frustum frustum;
+    frustum.planes[0] = rowW + rowX; // Left
+    frustum.planes[1] = rowW - rowX; // Right
+    frustum.planes[2] = rowW + rowY; // Bottom
+    frustum.planes[3] = rowW - rowY; // Top
+    frustum.planes[4] = rowW + rowZ; // Near
+    frustum.planes[5] = rowW - rowZ; // Far
+    return frustum;
+}
+
+void FrustumCulling::BoxList::Clear()
+{
+    centerX.clear(); centerY.clear(); centerZ.clear();
+    extentX.clear(); extentY.clear(); extentZ.clear();
+}
+
+void FrustumCulling::BoxList::Push(const vec3& boxMin, const vec3& boxMax)
+{
+    centerX.push_back((boxMin.x + boxMax.x) * 0.5f);
+    centerY.push_back((boxMin.y + boxMax.y) * 0.5f);
+    centerZ.push_back((boxMin.z + boxMax.z) * 0.5f);
+    extentX.push_back((boxMax.x - boxMin.x) * 0.5f);
+    extentY.push_back((boxMax.y - boxMin.y) * 0.5f);
+    extentZ.push_back((boxMax.z - boxMin.z) * 0.5f);
+}
+
+size_t FrustumCulling::CullBoxes(const Frustum& frustum, const BoxList& boxes, std::vector<uint8_t>& visible)
+{
+    const size_t count = boxes.Size();
+    visible.resize(count);
+    size_t visibleCount = 0;
+    size_t i = 0;
+
+#ifdef FRUSTUM_CULLING_SSE
+    // Splat each plane once; |n| via clearing the sign bit
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+    for (int p = 0; p < 6; ++p) {
+        planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+        planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+        planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+        planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+        absX[p] = _mm_and_ps(planeX[p], absMask);
+        absY[p] = _mm_and_ps(planeY[p], absMask);
+        absZ[p] = _mm_and_ps(planeZ[p], absMask);
+    }
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 cx = _mm_loadu_ps(&boxes.centerX[i]);
+        __m128 cy = _mm_loadu_ps(&boxes.centerY[i]);
+        __m128 cz = _mm_loadu_ps(&boxes.centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&boxes.extentX[i]);
+        __m128 ey = _mm_loadu_ps(&boxes.extentY[i]);
+        __m128 ez = _mm_loadu_ps(&boxes.extentZ[i]);
+
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; ++p) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+                                         _mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)),
+                                       _mm_mul_ps(absZ[p], ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        int outsideBits = _mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4; ++lane) {
+            uint8_t laneVisible = (outsideBits & (1 << lane)) ? 0 : 1;
+            visible[i + lane] = laneVisible;
+            visibleCount += laneVisible;
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        uint8_t boxVisible = BoxVisible(frustum, boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i],
+                                        boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]) ? 1 : 0;
+        visible[i] = boxVisible;
+        visibleCount += boxVisible;
+    }
+    return visibleCount;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Angel.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Visibility tests of world-space AABBs against the clip volume of a camera
+// view-projection or light-space matrix. Planes are taken straight from the matrix
+// rows, so perspective and ortho volumes work the same. Boxes are stored as
+// structure-of-arrays and tested four at a time with SSE.
+namespace FrustumCulling {
+
+    // Inside where dot(plane.xyz, p) + plane.w >= 0 (planes are not normalized)
+    struct Frustum {
+        vec4 planes[6];
+    };
+
+    Frustum FromMatrix(const mat4& clipFromWorld);
+
+    // Centers and half extents of a list of boxes
+    struct BoxList {
+        std::vector<float> centerX, centerY, centerZ;
+        std::vector<float> extentX, extentY, extentZ;
+
+        void Clear();
+        void Push(const vec3& boxMin, const vec3& boxMax);
+        size_t Size() const { return centerX.size(); }
+    };
+
+    // visible[i] = 1 if box i may intersect the frustum (conservative: boxes near a
+    // corner can pass without touching it), 0 otherwise. Returns the number visible.
+    size_t CullBoxes(const Frustum& frustum, const BoxList& boxes, std::vector<uint8_t>& visible);
+}
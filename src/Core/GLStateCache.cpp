@@ -0,0 +1,167 @@
+#include "GLStateCache.h"
+
+GLStateCache& GLStateCache::GetInstance()
+{
+    static GLStateCache instance;
+    return instance;
+}
+
+GLStateCache::GLStateCache()
+{
+    Invalidate();
+}
+
+int GLStateCache::TargetIndex(GLenum target)
+{
+    switch (target) {
+    case GL_TEXTURE_2D: return TARGET_2D;
+    case GL_TEXTURE_2D_ARRAY: return TARGET_2D_ARRAY;
+    default: return -1;
+    }
+}
+
+int GLStateCache::CapabilityIndex(GLenum capability)
+{
+    switch (capability) {
+    case GL_DEPTH_TEST: return CAP_DEPTH_TEST;
+    case GL_BLEND: return CAP_BLEND;
+    case GL_CULL_FACE: return CAP_CULL_FACE;
+    case GL_PRIMITIVE_RESTART: return CAP_PRIMITIVE_RESTART;
+    default: return -1;
+    }
+}
+
+bool GLStateCache::Changes(GLuint& current, GLuint value)
+{
+    if (current == value) {
+        ++m_stats.saved;
+        return false;
+    }
+    ++m_stats.issued;
+    current = value;
+    return true;
+}
+
+void GLStateCache::UseProgram(GLuint program)
+{
+    if (Changes(m_program, program)) glUseProgram(program);
+}
+
+void GLStateCache::BindVertexArray(GLuint vertexArray)
+{
+    if (Changes(m_vertexArray, vertexArray)) glBindVertexArray(vertexArray);
+}
+
+void GLStateCache::ActiveTexture(GLuint unit)
+{
+    if (Changes(m_activeUnit, unit)) glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void GLStateCache::BindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    int targetIndex = TargetIndex(target);
+    if (unit < TRACKED_UNITS && targetIndex >= 0) {
+        if (!Changes(m_textures[unit][targetIndex], texture)) return;
+    } else {
+        ++m_stats.issued;
+    }
+    ActiveTexture(unit);
+    glBindTexture(target, texture);
+}
+
+void GLStateCache::BindTexture(GLenum target, GLuint texture)
+{
+    if (m_activeUnit == UNKNOWN) ActiveTexture(0);
+    BindTexture(m_activeUnit, target, texture);
+}
+
+void GLStateCache::SetCapability(GLenum capability, bool enabled)
+{
+    int index = CapabilityIndex(capability);
+    if (index >= 0) {
+        if (!Changes(m_capabilities[index], enabled ? GL_TRUE : GL_FALSE)) return;
+    } else {
+        ++m_stats.issued;
+    }
+    if (enabled) glEnable(capability);
+    else glDisable(capability);
+}
+
+void GLStateCache::BlendFunc(GLenum sourceFactor, GLenum destinationFactor)
+{
+    if (sourceFactor == m_blendSource && destinationFactor == m_blendDestination) {
+        ++m_stats.saved;
+        return;
+    }
+    ++m_stats.issued;
+    m_blendSource = sourceFactor;
+    m_blendDestination = destinationFactor;
+    glBlendFunc(sourceFactor, destinationFactor);
+}
+
+void GLStateCache::CullFace(GLenum mode)
+{
+    if (Changes(m_cullFace, mode)) glCullFace(mode);
+}
+
+void GLStateCache::PrimitiveRestartIndex(GLuint index)
+{
+    if (m_restartIndexKnown && index == m_restartIndex) {
+        ++m_stats.saved;
+        return;
+    }
+    ++m_stats.issued;
+    m_restartIndex = index;
+    m_restartIndexKnown = true;
+    glPrimitiveRestartIndex(index);
+}
+
+void GLStateCache::DeleteProgram(GLuint program)
+{
+    if (program == 0) return;
+    // Deleting the current program only flags it; it stays in use until replaced
+    glDeleteProgram(program);
+}
+
+void GLStateCache::DeleteVertexArray(GLuint vertexArray)
+{
+    if (vertexArray == 0) return;
+    glDeleteVertexArrays(1, &vertexArray);
+    if (m_vertexArray == vertexArray) m_vertexArray = 0;
+}
+
+void GLStateCache::DeleteTexture(GLuint texture)
+{
+    if (texture == 0) return;
+    glDeleteTextures(1, &texture);
+    for (GLuint unit = 0; unit < TRACKED_UNITS; ++unit) {
+        for (int target = 0; target < TRACKED_TARGET_COUNT; ++target) {
+            if (m_textures[unit][target] == texture) m_textures[unit][target] = 0;
+        }
+    }
+}
+
+void GLStateCache::Invalidate()
+{
+    m_program = UNKNOWN;
+    m_vertexArray = UNKNOWN;
+    m_activeUnit = UNKNOWN;
+    for (GLuint unit = 0; unit < TRACKED_UNITS; ++unit) {
+        for (int target = 0; target < TRACKED_TARGET_COUNT; ++target) {
+            m_textures[unit][target] = UNKNOWN;
+        }
+    }
+    for (int capability = 0; capability < TRACKED_CAPABILITY_COUNT; ++capability) {
+        m_capabilities[capability] = UNKNOWN;
+    }
+    m_blendSource = m_blendDestination = UNKNOWN;
+    m_cullFace = UNKNOWN;
+    m_restartIndex = 0;
+    m_restartIndexKnown = false;
+}
+
+void GLStateCache::EndFrame()
+{
+    m_frameStats = m_stats;
+    m_stats = Stats();
+}
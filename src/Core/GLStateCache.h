@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Angel.h"
+
+// Shadow copy of the GL state the renderer changes most: the program, the VAO, the
+// active texture unit, the 2D / 2D array texture on each unit, the depth test, blending,
+// face culling and primitive restart. Calls that match the copy never reach the driver.
+// This only holds if every change goes through the cache, so the renderer makes none
+// directly; after code that does (a third-party library, say), call Invalidate. There is
+// one GL context, so there is one cache.
+class GLStateCache
+{
+public:
+    // Calls made through the cache during one frame
+    struct Stats {
+        unsigned int issued = 0; // Passed on to GL
+        unsigned int saved = 0;  // Dropped as redundant
+    };
+
+    static GLStateCache& GetInstance();
+
+    void UseProgram(GLuint program);
+    void BindVertexArray(GLuint vertexArray);
+    // Units are indices (0 for GL_TEXTURE0), as shaders' sampler uniforms take them
+    void ActiveTexture(GLuint unit);
+    void BindTexture(GLuint unit, GLenum target, GLuint texture);
+    // Binds on whichever unit is active, for creating or updating a texture
+    void BindTexture(GLenum target, GLuint texture);
+
+    // glEnable / glDisable; capabilities other than the four tracked ones are passed straight on
+    void SetCapability(GLenum capability, bool enabled);
+    void BlendFunc(GLenum sourceFactor, GLenum destinationFactor);
+    void CullFace(GLenum mode);
+    void PrimitiveRestartIndex(GLuint index);
+
+    // Delete through these: GL unbinds a deleted object, and its name may be handed
+    // out again, so the cache must not keep believing it is bound
+    void DeleteProgram(GLuint program);
+    void DeleteVertexArray(GLuint vertexArray);
+    void DeleteTexture(GLuint texture);
+
+    // Forget everything; the next call of each kind goes through
+    void Invalidate();
+
+    // Closes the frame's call counts; GetFrameStats then returns them until the next EndFrame
+    void EndFrame();
+    const Stats& GetFrameStats() const { return m_frameStats; }
+
+private:
+    GLStateCache();
+
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+    // Units past this are bound without caching (the renderer uses 0-10)
+    static const GLuint TRACKED_UNITS = 16;
+    enum TrackedTarget { TARGET_2D, TARGET_2D_ARRAY, TRACKED_TARGET_COUNT };
+    enum TrackedCapability { CAP_DEPTH_TEST, CAP_BLEND, CAP_CULL_FACE, CAP_PRIMITIVE_RESTART, TRACKED_CAPABILITY_COUNT };
+
+    // Index into m_textures for target, or -1 if bindings of it aren't tracked
+    static int TargetIndex(GLenum target);
+    // Index into m_capabilities, or -1 if the capability isn't tracked
+    static int CapabilityIndex(GLenum capability);
+
+    // Whether a call changing `current` to `value` has to reach GL; counts it either way
+    bool Changes(GLuint& current, GLuint value);
+
+    GLuint m_program;
+    GLuint m_vertexArray;
+    GLuint m_activeUnit;
+    GLuint m_textures[TRACKED_UNITS][TRACKED_TARGET_COUNT];
+    GLuint m_capabilities[TRACKED_CAPABILITY_COUNT]; // GL_TRUE / GL_FALSE, or UNKNOWN
+    GLuint m_blendSource, m_blendDestination;
+    GLuint m_cullFace;
+    GLuint m_restartIndex;
+    bool m_restartIndexKnown; // Every GLuint is a valid index, so UNKNOWN can't mark it
+
+    Stats m_stats;      // Of the frame being drawn
+    Stats m_frameStats; // Of the last finished frame
+};
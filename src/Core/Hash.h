@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit FNV-1a. Used to content-address cached assets (mesh cache validation,
+// texture de-duplication); not cryptographic.
+namespace Hash {
+
+const uint64_t FNV_OFFSET = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+// Pass the previous result as `hash` to hash data in chunks
+inline uint64_t Fnv1a64(const void* bytes, size_t count, uint64_t hash = FNV_OFFSET)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(bytes);
+    for (size_t i = 0; i < count; ++i) {
+        hash ^= p[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+} // namespace Hash
@@ -0,0 +1,53 @@
+#include "IndirectDrawBuffer.h"
+#include <algorithm>
+
+bool IndirectDrawBuffer::IsSupported()
+{
+    // Asked once the context exists; the answer can't change while it does
+    static const bool supported =
+        GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+    return supported;
+}
+
+IndirectDrawBuffer::IndirectDrawBuffer()
+    : m_buffer(0), m_capacity(0)
+{
+}
+
+IndirectDrawBuffer::~IndirectDrawBuffer()
+{
+    if (m_buffer != 0) {
+        glDeleteBuffers(1, &m_buffer);
+    }
+}
+
+GLsizei IndirectDrawBuffer::Add(const DrawElementsIndirectCommand& command)
+{
+    m_commands.push_back(command);
+    return static_cast<GLsizei>(m_commands.size() - 1);
+}
+
+void IndirectDrawBuffer::Upload()
+{
+    if (m_commands.empty()) return;
+    if (m_buffer == 0) {
+        glGenBuffers(1, &m_buffer);
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_buffer);
+    if (m_commands.size() > m_capacity) {
+        m_capacity = std::max(m_commands.size(), m_capacity * 2);
+    }
+    // Orphan the previous pass's commands rather than wait for the draws reading them
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, m_capacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, m_commands.size() * sizeof(DrawElementsIndirectCommand), m_commands.data());
+}
+
+void IndirectDrawBuffer::Draw(GLenum mode, GLenum indexType, GLsizei first, GLsizei count) const
+{
+    if (count == 0) return;
+    // The binding isn't VAO state, but another buffer may have taken it since the upload
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_buffer);
+    glMultiDrawElementsIndirect(mode, indexType, (const void*)(first * sizeof(DrawElementsIndirectCommand)),
+                                count, 0);
+}
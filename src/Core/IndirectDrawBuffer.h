@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Angel.h"
+#include <cstddef>
+#include <vector>
+
+// One draw of glMultiDrawElementsIndirect, laid out as GL reads it
+struct DrawElementsIndirectCommand {
+    GLuint count;         // Indices
+    GLuint instanceCount;
+    GLuint firstIndex;    // In indices, not bytes
+    GLint baseVertex;
+    GLuint baseInstance;  // Offsets the per-instance attributes, like a base-instance draw
+};
+
+// Draw commands built on the CPU each pass and submitted with a single
+// glMultiDrawElementsIndirect per run of draws that share all other state.
+// The GL buffer is created on first upload and orphaned on every later one,
+// so rebuilding the commands never waits on draws still reading them.
+class IndirectDrawBuffer {
+public:
+    // GL 4.3, or the multi-draw-indirect and base-instance extensions. The window asks
+    // for a 3.2 core context, which most drivers upgrade; callers draw directly otherwise.
+    static bool IsSupported();
+
+    IndirectDrawBuffer();
+    ~IndirectDrawBuffer();
+    IndirectDrawBuffer(const IndirectDrawBuffer&) = delete;
+    IndirectDrawBuffer& operator=(const IndirectDrawBuffer&) = delete;
+
+    void Clear() { m_commands.clear(); }
+    // Returns the index of the command
+    GLsizei Add(const DrawElementsIndirectCommand& command);
+    GLsizei Size() const { return static_cast<GLsizei>(m_commands.size()); }
+
+    // Sends the commands added since the last Clear to the GPU
+    void Upload();
+    // Commands [first, first + count) of the last Upload, as one call
+    void Draw(GLenum mode, GLenum indexType, GLsizei first, GLsizei count) const;
+
+private:
+    GLuint m_buffer;
+    size_t m_capacity; // In commands
+    std::vector<DrawElementsIndirectCommand> m_commands;
+};
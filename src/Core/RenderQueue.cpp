@@ -0,0 +1,137 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const int DEPTH_BITS = 20;
+const int VAO_BITS = 16;
+const int TEXTURE_BITS = 16;
+const int PROGRAM_BITS = 8;
+const int PASS_BITS = 4;
+
+uint64_t Field(uint64_t value, int bits, int shift)
+{
+    return (value & ((uint64_t(1) << bits) - 1)) << shift;
+}
+
+} // namespace
+
+uint64_t RenderQueue::MakeKey(unsigned int pass, GLuint program, GLuint texture, GLuint vertexArray, float depth)
+{
+    // Non-negative floats order like their bit patterns; the top bits past the sign keep
+    // the exponent and 11 mantissa bits, i.e. better than 0.05% of the distance
+    uint32_t depthBits;
+    depth = std::max(depth, 0.0f);
+    std::memcpy(&depthBits, &depth, sizeof(depthBits));
+    depthBits >>= 31 - DEPTH_BITS;
+
+    int shift = 0;
+    uint64_t key = Field(depthBits, DEPTH_BITS, shift);
+    key |= Field(vertexArray, VAO_BITS, shift += DEPTH_BITS);
+    key |= Field(texture, TEXTURE_BITS, shift += VAO_BITS);
+    key |= Field(program, PROGRAM_BITS, shift += TEXTURE_BITS);
+    key |= Field(pass, PASS_BITS, shift += PROGRAM_BITS);
+    return key;
+}
+
+void RenderQueue::Sort()
+{
+    const size_t count = m_order.size();
+    m_sortScratch.resize(count);
+
+    // Every byte's histogram in one read of the keys
+    size_t histograms[8][256] = {};
+    for (const SortEntry& entry : m_order) {
+        for (int byte = 0; byte < 8; ++byte) {
+            ++histograms[byte][(entry.key >> (byte * 8)) & 0xFF];
+        }
+    }
+
+    for (int byte = 0; byte < 8; ++byte) {
+        size_t* histogram = histograms[byte];
+        // One bucket holding everything means this byte is the same in every key
+        if (histogram[(m_order[0].key >> (byte * 8)) & 0xFF] == count) continue;
+
+        size_t offset = 0;
+        for (int bucket = 0; bucket < 256; ++bucket) {
+            size_t bucketSize = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketSize;
+        }
+        for (const SortEntry& entry : m_order) {
+            m_sortScratch[histogram[(entry.key >> (byte * 8)) & 0xFF]++] = entry;
+        }
+        m_order.swap(m_sortScratch);
+    }
+}
+
+bool RenderQueue::SameState(const RenderPacket& a, const RenderPacket& b)
+{
+    return a.source == b.source && a.shader == b.shader && a.context == b.context &&
+           a.vertexArray == b.vertexArray && a.texture == b.texture;
+}
+
+void RenderQueue::Submit(GLStateCache& state)
+{
+    m_stats = Stats();
+    if (m_packets.empty()) return;
+
+    m_order.resize(m_packets.size());
+    for (size_t i = 0; i < m_packets.size(); ++i) {
+        m_order[i] = { m_packets[i].key, static_cast<uint32_t>(i) };
+    }
+    Sort();
+
+    // Group the sorted packets into runs and upload every indirect command in one go
+    const bool indirect = IndirectDrawBuffer::IsSupported();
+    m_runs.clear();
+    m_commands.Clear();
+    for (uint32_t i = 0; i < m_order.size(); ++i) {
+        const RenderPacket& packet = m_packets[m_order[i].packet];
+        DrawElementsIndirectCommand command;
+        if (!indirect || !packet.source->WriteCommand(packet, command)) {
+            m_runs.push_back({ i, 0, 0 });
+            continue;
+        }
+        // A run's packets are consecutive in m_order: any packet that can't join ends it
+        if (!m_runs.empty() && m_runs.back().commandCount > 0 &&
+            SameState(m_packets[m_order[m_runs.back().first].packet], packet)) {
+            m_commands.Add(command);
+            ++m_runs.back().commandCount;
+        } else {
+            m_runs.push_back({ i, m_commands.Add(command), 1 });
+        }
+    }
+    m_commands.Upload();
+
+    const RenderPacket* previous = nullptr;
+    for (const Run& run : m_runs) {
+        const RenderPacket& packet = m_packets[m_order[run.first].packet];
+        state.UseProgram(packet.shader->getProgramID());
+        if (packet.vertexArray != 0) {
+            state.BindVertexArray(packet.vertexArray);
+        }
+        if (packet.texture != 0) {
+            GLuint unit = packet.textureTarget == GL_TEXTURE_2D_ARRAY ? MATERIAL_ARRAY_UNIT : MATERIAL_TEXTURE_UNIT;
+            state.BindTexture(unit, packet.textureTarget, packet.texture);
+        }
+        bool continuing = previous && previous->source == packet.source && previous->shader == packet.shader &&
+                          previous->context == packet.context;
+        if (run.commandCount == 0) {
+            packet.source->Draw(packet, continuing);
+            ++m_stats.drawCalls;
+        } else if (packet.source->DrawIndirect(packet, continuing, m_commands, run.firstCommand, run.commandCount)) {
+            ++m_stats.drawCalls;
+        } else {
+            // Same state throughout the run, so only the first packet can start afresh
+            for (GLsizei i = 0; i < run.commandCount; ++i) {
+                packet.source->Draw(m_packets[m_order[run.first + i].packet], continuing || i > 0);
+            }
+            m_stats.drawCalls += static_cast<unsigned int>(run.commandCount);
+        }
+        previous = &packet;
+    }
+    m_stats.packets = static_cast<unsigned int>(m_packets.size());
+    m_packets.clear();
+}
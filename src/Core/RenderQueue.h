@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Angel.h"
+#include "GLStateCache.h"
+#include "IndirectDrawBuffer.h"
+#include "Shader.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct RenderPacket;
+
+// Issues the draws of the packets it queued. By the time Draw is called the queue has
+// bound the packet's program, VAO and material texture; the source sets everything else
+// the draw needs (uniforms, instance attributes) and makes the draw call.
+class RenderSource
+{
+public:
+    virtual ~RenderSource() = default;
+    // `continuing` is true when the previous packet came from this source with the same
+    // shader and context, so any uniforms the source set for that one still hold
+    virtual void Draw(const RenderPacket& packet, bool continuing) = 0;
+
+    // Multi-draw indirect, where supported: a source that can express a packet as one
+    // indirect command writes it and returns true. Consecutive packets from the source
+    // that share their state (shader, context, VAO, texture) then reach DrawIndirect
+    // together, which issues commands [first, first + count) of `commands` in one call.
+    // A source that writes commands without overriding DrawIndirect is drawn a packet at a
+    // time through Draw instead (the default returns false).
+    virtual bool WriteCommand(const RenderPacket& packet, DrawElementsIndirectCommand& command) const { return false; }
+    virtual bool DrawIndirect(const RenderPacket& packet, bool continuing, const IndirectDrawBuffer& commands,
+                              GLsizei first, GLsizei count) { return false; }
+};
+
+struct RenderPacket
+{
+    uint64_t key;            // RenderQueue::MakeKey; packets are drawn in ascending key order
+    const Shader* shader;
+    GLuint vertexArray;      // 0 if the source binds its own
+    GLuint texture;          // Material texture, unless 0...
+    GLenum textureTarget = GL_TEXTURE_2D; // ...bound on MATERIAL_TEXTURE_UNIT, or MATERIAL_ARRAY_UNIT if an array
+    RenderSource* source;
+    const void* context;     // For the source, e.g. the uniform handles of the pass
+    uint32_t args[3];        // For the source, e.g. which mesh and instances to draw
+};
+
+// Collects the draws of a frame as packets, sorts them by a 64-bit key so that draws
+// sharing state run back to back, and submits them through the GLStateCache, which
+// drops the binds the order made redundant. Where multi-draw indirect is supported,
+// each such run of packets is one driver call.
+class RenderQueue
+{
+public:
+    // Of the last Submit
+    struct Stats {
+        unsigned int packets = 0;
+        unsigned int drawCalls = 0; // Draw and DrawIndirect calls on the sources
+    };
+
+    // Object (material) textures; units 0-4 hold the terrain layers, 5 the shadow map.
+    // Array textures get their own unit: samplers of different types may not share one.
+    static const GLuint MATERIAL_TEXTURE_UNIT = 6;
+    static const GLuint MATERIAL_ARRAY_UNIT = 7;
+
+    // Values of the key's pass field, in drawing order within one Submit
+    static const unsigned int SHADOW_PASS = 0;
+    static const unsigned int MAIN_PASS = 1;
+
+    // Key fields, most significant first: pass (4 bits), program (8), texture (16), VAO (16),
+    // depth (20). GL names are truncated to their fields, which at worst costs a redundant
+    // bind. Depth is a view distance, nearest first; any non-negative value orders correctly.
+    static uint64_t MakeKey(unsigned int pass, GLuint program, GLuint texture, GLuint vertexArray, float depth);
+
+    void Clear() { m_packets.clear(); }
+    void Add(const RenderPacket& packet) { m_packets.push_back(packet); }
+    size_t Size() const { return m_packets.size(); }
+
+    // Sorts and draws every packet, then clears the queue
+    void Submit(GLStateCache& state);
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    struct SortEntry {
+        uint64_t key;
+        uint32_t packet;
+    };
+
+    // Stable LSD radix sort of m_order by key, a byte per pass; passes over bytes that
+    // are the same in every key are skipped
+    void Sort();
+
+    // Whether b can join the indirect run that a started
+    static bool SameState(const RenderPacket& a, const RenderPacket& b);
+
+    // Sorted packets drawn with one call: a direct Draw, or DrawIndirect of its commands
+    struct Run {
+        uint32_t first;        // Index into m_order of the first packet, whose state the run is drawn with
+        GLsizei firstCommand;
+        GLsizei commandCount;  // 0 for a direct draw
+    };
+
+    std::vector<RenderPacket> m_packets;
+    std::vector<SortEntry> m_order;
+    std::vector<SortEntry> m_sortScratch;
+    std::vector<Run> m_runs;
+    IndirectDrawBuffer m_commands;
+    Stats m_stats;
+};
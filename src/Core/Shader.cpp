@@ -1,16 +1,16 @@
 #include "Shader.h"
+#include "GLStateCache.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <vector>
+#include <algorithm>
 
 Shader::Shader() : m_programID(0) {
 }
 
 Shader::~Shader() {
-    if (m_programID != 0) {
-        glDeleteProgram(m_programID);
-    }
+    GLStateCache::GetInstance().DeleteProgram(m_programID);
 }
 
 bool Shader::loadFromFiles(const std::string& vertexPath, const std::string& fragmentPath) {
@@ -54,9 +54,10 @@ bool Shader::loadFromFiles(const std::string& vertexPath, const std::string& fra
 bool Shader::loadFromStrings(const std::string& vertexSource, const std::string& fragmentSource) {
     // Delete existing program if any
     if (m_programID != 0) {
-        glDeleteProgram(m_programID);
+        GLStateCache::GetInstance().DeleteProgram(m_programID);
         m_programID = 0;
     }
+    m_uniformLocationCache.clear();
     
     // Compile shaders
     GLuint vertexShader = compileShader(vertexSource, GL_VERTEX_SHADER);
@@ -91,7 +92,7 @@ bool Shader::loadFromStrings(const std::string& vertexSource, const std::string&
 void Shader::use() const {
 
     if (m_programID != 0) {
-        glUseProgram(m_programID);
+        GLStateCache::GetInstance().UseProgram(m_programID);
     }
 }
 
@@ -128,57 +129,113 @@ bool Shader::linkProgram() {
         return false;
     }
     
+    cacheActiveUniforms();
     return true;
 }
 
+void Shader::cacheActiveUniforms() {
+    // Resolve every active uniform up front so setting one never round-trips to the driver
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(m_programID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(m_programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<GLchar> nameBuffer(std::max(maxNameLength, 1));
+    for (GLint i = 0; i < uniformCount; ++i) {
+        GLsizei nameLength = 0;
+        GLint arraySize = 0;
+        GLenum type = 0;
+        glGetActiveUniform(m_programID, static_cast<GLuint>(i), static_cast<GLsizei>(nameBuffer.size()),
+                           &nameLength, &arraySize, &type, nameBuffer.data());
+        std::string name(nameBuffer.data(), nameLength);
+
+        GLint location = glGetUniformLocation(m_programID, name.c_str());
+        m_uniformLocationCache[name] = location;
+
+        // Arrays are reported as "name[0]"; also allow addressing them by their base name
+        size_t bracket = name.find('[');
+        if (bracket != std::string::npos && name.compare(bracket, std::string::npos, "[0]") == 0) {
+            m_uniformLocationCache[name.substr(0, bracket)] = location;
+        }
+    }
+}
+
 GLint Shader::getUniformLocation(const std::string& name) const {
-    // Check if location is already cached
+    // Every active uniform was cached at link time, so a miss means the
+    // program doesn't use it (or it was optimized out); GL ignores location -1
     auto it = m_uniformLocationCache.find(name);
-    if (it != m_uniformLocationCache.end()) {
-        return it->second;
-    }
-    
-    // Get location and cache it
-    GLint location = glGetUniformLocation(m_programID, name.c_str());
-    m_uniformLocationCache[name] = location;
-    
-    return location;
+    return it != m_uniformLocationCache.end() ? it->second : -1;
+}
+
+void Shader::setUniformAt(GLint location, int value) const {
+    glUniform1i(location, value);
+}
+
+void Shader::setUniformAt(GLint location, float value) const {
+    glUniform1f(location, value);
+}
+
+void Shader::setUniformAt(GLint location, const vec2& value) const {
+    glUniform2fv(location, 1, value);
+}
+
+void Shader::setUniformAt(GLint location, const vec3& value) const {
+    glUniform3fv(location, 1, value);
+}
+
+void Shader::setUniformAt(GLint location, const vec4& value) const {
+    glUniform4fv(location, 1, value);
+}
+
+void Shader::setUniformAt(GLint location, const mat2& value) const {
+    glUniformMatrix2fv(location, 1, GL_TRUE, value);
+}
+
+void Shader::setUniformAt(GLint location, const mat3& value) const {
+    glUniformMatrix3fv(location, 1, GL_TRUE, value);
+}
+
+void Shader::setUniformAt(GLint location, const mat4& value) const {
+    glUniformMatrix4fv(location, 1, GL_TRUE, value);
+}
+
+void Shader::setUniformAt(GLint location, bool value) const {
+    // Explicitly convert the C++ bool to a GLint (0 for false, 1 for true) for OpenGL.
+    glUniform1i(location, static_cast<GLint>(value));
 }
 
 void Shader::setUniform(const std::string& name, int value) const {
-    glUniform1i(getUniformLocation(name), value);
+    setUniformAt(getUniformLocation(name), value);
 }
 
 void Shader::setUniform(const std::string& name, float value) const {
-    glUniform1f(getUniformLocation(name), value);
+    setUniformAt(getUniformLocation(name), value);
 }
 
 void Shader::setUniform(const std::string& name, const vec2& value) const {
-    glUniform2fv(getUniformLocation(name), 1, value);
+    setUniformAt(getUniformLocation(name), value);
 }
 
 void Shader::setUniform(const std::string& name, const vec3& value) const {
-    glUniform3fv(getUniformLocation(name), 1, value);
+    setUniformAt(getUniformLocation(name), value);
 }
 
 void Shader::setUniform(const std::string& name, const vec4& value) const {
-    glUniform4fv(getUniformLocation(name), 1, value);
+    setUniformAt(getUniformLocation(name), value);
 }
 
 void Shader::setUniform(const std::string& name, const mat2& value) const {
-    glUniformMatrix2fv(getUniformLocation(name), 1, GL_TRUE, value);
+    setUniformAt(getUniformLocation(name), value);
 }
 
 void Shader::setUniform(const std::string& name, const mat3& value) const {
-    glUniformMatrix3fv(getUniformLocation(name), 1, GL_TRUE, value);
+    setUniformAt(getUniformLocation(name), value);
 }
 
 void Shader::setUniform(const std::string& name, const mat4& value) const {
-    glUniformMatrix4fv(getUniformLocation(name), 1, GL_TRUE, value);
+    setUniformAt(getUniformLocation(name), value);
 }
 
 void Shader::setUniform(const std::string& name, bool value) const {
-    // We get the location and then explicitly convert the C++ bool
-    // to a GLint (0 for false, 1 for true) for OpenGL.
-    glUniform1i(getUniformLocation(name), static_cast<GLint>(value));
+    setUniformAt(getUniformLocation(name), value);
 }
@@ -5,6 +5,14 @@
 #include <unordered_map>
 #include <memory>
 
+// Typed handle to a uniform location. Resolve it once from a linked Shader and
+// reuse it every frame instead of looking the uniform up by name.
+template <typename T>
+struct UniformHandle {
+    GLint location = -1;
+    bool isValid() const { return location != -1; }
+};
+
 class Shader {
 public:
     // Constructor and destructor
@@ -30,6 +38,16 @@ public:
     void setUniform(const std::string& name, const mat2& value) const;
     void setUniform(const std::string& name, const mat3& value) const;
     void setUniform(const std::string& name, const mat4& value) const;
+
+    // Typed handles; all active uniforms are resolved when the program links
+    template <typename T>
+    UniformHandle<T> getUniformHandle(const std::string& name) const { return UniformHandle<T>{ getUniformLocation(name) }; }
+
+    template <typename T>
+    void setUniform(UniformHandle<T> handle, const T& value) const { setUniformAt(handle.location, value); }
+
+    // Location of an active uniform (-1 if the program doesn't use it). Never queries GL.
+    GLint getUniformLocation(const std::string& name) const;
     
     // Get program ID
     GLuint getProgramID() const { return m_programID; }
@@ -41,11 +59,21 @@ private:
     // Helper methods
     GLuint compileShader(const std::string& source, GLenum type);
     bool linkProgram();
-    GLint getUniformLocation(const std::string& name) const;
+    void cacheActiveUniforms();
+
+    void setUniformAt(GLint location, bool value) const;
+    void setUniformAt(GLint location, int value) const;
+    void setUniformAt(GLint location, float value) const;
+    void setUniformAt(GLint location, const vec2& value) const;
+    void setUniformAt(GLint location, const vec3& value) const;
+    void setUniformAt(GLint location, const vec4& value) const;
+    void setUniformAt(GLint location, const mat2& value) const;
+    void setUniformAt(GLint location, const mat3& value) const;
+    void setUniformAt(GLint location, const mat4& value) const;
     
     // Shader program ID
     GLuint m_programID;
     
-    // Cache for uniform locations
-    mutable std::unordered_map<std::string, GLint> m_uniformLocationCache;
+    // Locations of all active uniforms, filled once after linking
+    std::unordered_map<std::string, GLint> m_uniformLocationCache;
 }; 
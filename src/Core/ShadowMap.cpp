@@ -1,4 +1,5 @@
 #include "ShadowMap.h"
+#include "GLStateCache.h"
 #include <iostream>
 
 ShadowMap::ShadowMap()
@@ -14,9 +15,7 @@ ShadowMap::~ShadowMap()
     if (m_fbo != 0) {
         glDeleteFramebuffers(1, &m_fbo);
     }
-    if (m_shadowMap != 0) {
-        glDeleteTextures(1, &m_shadowMap);
-    }
+    GLStateCache::GetInstance().DeleteTexture(m_shadowMap);
 }
 
 bool ShadowMap::Init(unsigned int width, unsigned int height)
@@ -29,7 +28,7 @@ bool ShadowMap::Init(unsigned int width, unsigned int height)
 
     // Create the depth texture
     glGenTextures(1, &m_shadowMap);
-    glBindTexture(GL_TEXTURE_2D, m_shadowMap);
+    GLStateCache::GetInstance().BindTexture(GL_TEXTURE_2D, m_shadowMap);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, m_shadowWidth, m_shadowHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
     
     // Set texture parameters
@@ -68,6 +67,5 @@ void ShadowMap::Write()
 
 void ShadowMap::Read(GLenum textureUnit)
 {
-    glActiveTexture(textureUnit);
-    glBindTexture(GL_TEXTURE_2D, m_shadowMap);
+    GLStateCache::GetInstance().BindTexture(textureUnit - GL_TEXTURE0, GL_TEXTURE_2D, m_shadowMap);
 }
@@ -19,6 +19,7 @@ public:
 
     unsigned int GetShadowWidth() const { return m_shadowWidth; }
     unsigned int GetShadowHeight() const { return m_shadowHeight; }
+    GLuint GetTextureID() const { return m_shadowMap; }
 
 protected:
     GLuint m_fbo;
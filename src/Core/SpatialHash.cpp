@@ -0,0 +1,212 @@
+#include "SpatialHash.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Entry distance of the ray into the box, or false if it misses within [0, maxDistance]
+bool RayBox(const vec3& origin, const vec3& direction, float maxDistance,
+            const vec3& boxMin, const vec3& boxMax, float& entry)
+{
+    float tMin = 0.0f;
+    float tMax = maxDistance;
+    for (int axis = 0; axis < 3; ++axis) {
+        if (std::fabs(direction[axis]) < 1e-8f) {
+            if (origin[axis] < boxMin[axis] || origin[axis] > boxMax[axis]) return false;
+            continue;
+        }
+        float inverse = 1.0f / direction[axis];
+        float t0 = (boxMin[axis] - origin[axis]) * inverse;
+        float t1 = (boxMax[axis] - origin[axis]) * inverse;
+        if (t0 > t1) std::swap(t0, t1);
+        tMin = std::max(tMin, t0);
+        tMax = std::min(tMax, t1);
+        if (tMin > tMax) return false;
+    }
+    entry = tMin;
+    return true;
+}
+
+} // namespace
+
+SpatialHash::SpatialHash(float cellSize)
+    : m_cellSize(cellSize)
+    , m_inverseCellSize(1.0f / cellSize)
+    , m_itemCount(0)
+    , m_queryStamp(0)
+{
+}
+
+int SpatialHash::CellCoord(float world) const
+{
+    return static_cast<int>(std::floor(world * m_inverseCellSize));
+}
+
+uint64_t SpatialHash::CellKey(int x, int z)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z);
+}
+
+void SpatialHash::Insert(uint32_t id, int minX, int minZ, int maxX, int maxZ)
+{
+    for (int z = minZ; z <= maxZ; ++z) {
+        for (int x = minX; x <= maxX; ++x) {
+            m_cells[CellKey(x, z)].push_back(id);
+        }
+    }
+}
+
+void SpatialHash::Erase(uint32_t id, int minX, int minZ, int maxX, int maxZ)
+{
+    for (int z = minZ; z <= maxZ; ++z) {
+        for (int x = minX; x <= maxX; ++x) {
+            auto cell = m_cells.find(CellKey(x, z));
+            if (cell == m_cells.end()) continue;
+            std::vector<uint32_t>& ids = cell->second;
+            auto it = std::find(ids.begin(), ids.end(), id);
+            if (it != ids.end()) {
+                *it = ids.back();
+                ids.pop_back();
+            }
+        }
+    }
+}
+
+void SpatialHash::Update(uint32_t id, const vec3& boundsMin, const vec3& boundsMax)
+{
+    if (id >= m_items.size()) m_items.resize(id + 1);
+    Item& item = m_items[id];
+
+    int minX = CellCoord(boundsMin.x);
+    int minZ = CellCoord(boundsMin.z);
+    int maxX = CellCoord(boundsMax.x);
+    int maxZ = CellCoord(boundsMax.z);
+    if (!item.present) {
+        Insert(id, minX, minZ, maxX, maxZ);
+        item.present = true;
+        ++m_itemCount;
+    } else if (minX != item.cellMinX || minZ != item.cellMinZ || maxX != item.cellMaxX || maxZ != item.cellMaxZ) {
+        Erase(id, item.cellMinX, item.cellMinZ, item.cellMaxX, item.cellMaxZ);
+        Insert(id, minX, minZ, maxX, maxZ);
+    }
+    item.boundsMin = boundsMin;
+    item.boundsMax = boundsMax;
+    item.cellMinX = minX;
+    item.cellMinZ = minZ;
+    item.cellMaxX = maxX;
+    item.cellMaxZ = maxZ;
+}
+
+void SpatialHash::Remove(uint32_t id)
+{
+    if (!Contains(id)) return;
+    Item& item = m_items[id];
+    Erase(id, item.cellMinX, item.cellMinZ, item.cellMaxX, item.cellMaxZ);
+    item.present = false;
+    --m_itemCount;
+}
+
+uint32_t SpatialHash::NextStamp()
+{
+    if (++m_queryStamp == 0) {
+        // Wrapped: forget every old stamp so none collides with the new ones
+        for (Item& item : m_items) item.queryStamp = 0;
+        m_queryStamp = 1;
+    }
+    return m_queryStamp;
+}
+
+template <typename Test>
+void SpatialHash::VisitCell(int x, int z, Test test)
+{
+    auto cell = m_cells.find(CellKey(x, z));
+    if (cell == m_cells.end()) return;
+    for (uint32_t id : cell->second) {
+        Item& item = m_items[id];
+        if (item.queryStamp == m_queryStamp) continue;
+        item.queryStamp = m_queryStamp;
+        test(id, item);
+    }
+}
+
+void SpatialHash::QueryRect(float minX, float minZ, float maxX, float maxZ, std::vector<uint32_t>& out)
+{
+    NextStamp();
+    int cellMinX = CellCoord(minX), cellMaxX = CellCoord(maxX);
+    int cellMinZ = CellCoord(minZ), cellMaxZ = CellCoord(maxZ);
+    for (int z = cellMinZ; z <= cellMaxZ; ++z) {
+        for (int x = cellMinX; x <= cellMaxX; ++x) {
+            VisitCell(x, z, [&](uint32_t id, const Item& item) {
+                if (item.boundsMax.x >= minX && item.boundsMin.x <= maxX &&
+                    item.boundsMax.z >= minZ && item.boundsMin.z <= maxZ) {
+                    out.push_back(id);
+                }
+            });
+        }
+    }
+}
+
+void SpatialHash::QueryRadius(float centerX, float centerZ, float radius, std::vector<uint32_t>& out)
+{
+    NextStamp();
+    const float radiusSquared = radius * radius;
+    int cellMinX = CellCoord(centerX - radius), cellMaxX = CellCoord(centerX + radius);
+    int cellMinZ = CellCoord(centerZ - radius), cellMaxZ = CellCoord(centerZ + radius);
+    for (int z = cellMinZ; z <= cellMaxZ; ++z) {
+        for (int x = cellMinX; x <= cellMaxX; ++x) {
+            VisitCell(x, z, [&](uint32_t id, const Item& item) {
+                // Distance from the center to the nearest point of the box
+                float dx = std::max(std::max(item.boundsMin.x - centerX, 0.0f), centerX - item.boundsMax.x);
+                float dz = std::max(std::max(item.boundsMin.z - centerZ, 0.0f), centerZ - item.boundsMax.z);
+                if (dx * dx + dz * dz <= radiusSquared) {
+                    out.push_back(id);
+                }
+            });
+        }
+    }
+}
+
+void SpatialHash::Raycast(const vec3& origin, const vec3& direction, float maxDistance, std::vector<RayHit>& hits)
+{
+    NextStamp();
+    size_t firstHit = hits.size();
+    auto test = [&](uint32_t id, const Item& item) {
+        float entry;
+        if (RayBox(origin, direction, maxDistance, item.boundsMin, item.boundsMax, entry)) {
+            hits.push_back({ id, entry });
+        }
+    };
+
+    // Walk the cells under the ray's xz projection in order (Amanatides & Woo)
+    int x = CellCoord(origin.x);
+    int z = CellCoord(origin.z);
+    int endX = CellCoord(origin.x + direction.x * maxDistance);
+    int endZ = CellCoord(origin.z + direction.z * maxDistance);
+    int stepX = direction.x > 0.0f ? 1 : -1;
+    int stepZ = direction.z > 0.0f ? 1 : -1;
+    const float infinity = std::numeric_limits<float>::infinity();
+    float deltaX = direction.x != 0.0f ? m_cellSize / std::fabs(direction.x) : infinity;
+    float deltaZ = direction.z != 0.0f ? m_cellSize / std::fabs(direction.z) : infinity;
+    float nextX = direction.x != 0.0f
+        ? ((x + (stepX > 0 ? 1 : 0)) * m_cellSize - origin.x) / direction.x : infinity;
+    float nextZ = direction.z != 0.0f
+        ? ((z + (stepZ > 0 ? 1 : 0)) * m_cellSize - origin.z) / direction.z : infinity;
+
+    // One cell per step, so the walk ends after |endX - x| + |endZ - z| steps at most
+    int steps = std::abs(endX - x) + std::abs(endZ - z);
+    for (int i = 0; ; ++i) {
+        VisitCell(x, z, test);
+        if (i >= steps) break;
+        if (nextX < nextZ) {
+            x += stepX;
+            nextX += deltaX;
+        } else {
+            z += stepZ;
+            nextZ += deltaZ;
+        }
+    }
+
+    std::sort(hits.begin() + firstHit, hits.end(),
+              [](const RayHit& a, const RayHit& b) { return a.distance < b.distance; });
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Angel.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Uniform hash grid over world AABBs in the xz plane. Items are small integer ids
+// (e.g. GameObject slots) and are registered in every cell their box overlaps, so
+// queries only visit the cells under the query shape and the items inside them.
+// Updates that keep an item within the same cells only rewrite its box.
+class SpatialHash
+{
+public:
+    struct RayHit {
+        uint32_t id;
+        float distance; // Along the ray, in units of the direction's length
+    };
+
+    explicit SpatialHash(float cellSize);
+
+    // Adds the item, or moves it if it is already present
+    void Update(uint32_t id, const vec3& boundsMin, const vec3& boundsMax);
+    void Remove(uint32_t id);
+    bool Contains(uint32_t id) const { return id < m_items.size() && m_items[id].present; }
+    size_t Size() const { return m_itemCount; }
+
+    // Append the ids of every item whose xz box overlaps the query to out (each id once)
+    void QueryRect(float minX, float minZ, float maxX, float maxZ, std::vector<uint32_t>& out);
+    void QueryRadius(float centerX, float centerZ, float radius, std::vector<uint32_t>& out);
+    // Every item whose full 3D box the ray enters within maxDistance, nearest first
+    void Raycast(const vec3& origin, const vec3& direction, float maxDistance, std::vector<RayHit>& hits);
+
+private:
+    struct Item {
+        vec3 boundsMin, boundsMax;
+        int cellMinX, cellMinZ, cellMaxX, cellMaxZ; // Inclusive cell range the item is registered in
+        uint32_t queryStamp = 0;                    // Last query that reported it, to skip duplicates
+        bool present = false;
+    };
+
+    int CellCoord(float world) const;
+    static uint64_t CellKey(int x, int z);
+    void Insert(uint32_t id, int minX, int minZ, int maxX, int maxZ);
+    void Erase(uint32_t id, int minX, int minZ, int maxX, int maxZ);
+    uint32_t NextStamp();
+    // Reports the not-yet-seen items of a cell whose box passes the test
+    template <typename Test>
+    void VisitCell(int x, int z, Test test);
+
+    float m_cellSize;
+    float m_inverseCellSize;
+    std::vector<Item> m_items;  // By id
+    size_t m_itemCount;
+    // Emptied cells keep their vectors so objects moving back and forth don't reallocate
+    std::unordered_map<uint64_t, std::vector<uint32_t>> m_cells;
+    uint32_t m_queryStamp;
+};
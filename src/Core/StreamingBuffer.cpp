@@ -0,0 +1,124 @@
+#include "StreamingBuffer.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+StreamingBuffer::StreamingBuffer()
+    : m_buffer(0), m_segmentSize(0), m_segment(0), m_cursor(0),
+      m_segmentAcquired(false), m_stallCount(0)
+{
+    for (GLsync& fence : m_fences) {
+        fence = nullptr;
+    }
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+    Cleanup();
+}
+
+void StreamingBuffer::Cleanup()
+{
+    for (GLsync& fence : m_fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (m_buffer != 0) {
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+    }
+}
+
+bool StreamingBuffer::Init(size_t segmentSize)
+{
+    Cleanup();
+    if (segmentSize == 0) return false;
+    m_segmentSize = segmentSize;
+    m_segment = 0;
+    m_cursor = 0;
+    m_segmentAcquired = false;
+
+    glGenBuffers(1, &m_buffer);
+    if (m_buffer == 0) {
+        std::cerr << "StreamingBuffer: failed to create staging buffer" << std::endl;
+        return false;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, m_buffer);
+    glBufferData(GL_COPY_READ_BUFFER, m_segmentSize * SEGMENT_COUNT, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    return true;
+}
+
+void StreamingBuffer::AcquireSegment()
+{
+    GLsync& fence = m_fences[m_segment];
+    if (fence) {
+        // With three segments and uploads at most once per frame this is normally
+        // already signalled; only block if the GPU is more than two submits behind.
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            m_stallCount++;
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+        }
+        if (result == GL_WAIT_FAILED) {
+            std::cerr << "StreamingBuffer: glClientWaitSync failed" << std::endl;
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    m_cursor = 0;
+    m_segmentAcquired = true;
+}
+
+void StreamingBuffer::Upload(GLuint target, size_t targetOffset, const void* data, size_t size)
+{
+    if (m_buffer == 0 || size == 0) return;
+
+    const unsigned char* src = static_cast<const unsigned char*>(data);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, target);
+
+    while (size > 0) {
+        if (!m_segmentAcquired) {
+            AcquireSegment();
+        } else if (m_cursor == m_segmentSize) {
+            Submit();
+            AcquireSegment();
+        }
+
+        size_t chunk = std::min(size, m_segmentSize - m_cursor);
+        GLintptr stagingOffset = static_cast<GLintptr>(m_segment * m_segmentSize + m_cursor);
+
+        // The fence guarantees the GPU is done with this range, so skip the driver's implicit sync
+        void* dst = glMapBufferRange(GL_COPY_READ_BUFFER, stagingOffset, chunk,
+                                     GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        if (!dst) {
+            std::cerr << "StreamingBuffer: glMapBufferRange failed" << std::endl;
+            break;
+        }
+        std::memcpy(dst, src, chunk);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, stagingOffset,
+                            static_cast<GLintptr>(targetOffset), chunk);
+
+        m_cursor += chunk;
+        src += chunk;
+        targetOffset += chunk;
+        size -= chunk;
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void StreamingBuffer::Submit()
+{
+    if (!m_segmentAcquired) return;
+
+    m_fences[m_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_segment = (m_segment + 1) % SEGMENT_COUNT;
+    m_segmentAcquired = false;
+}
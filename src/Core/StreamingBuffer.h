@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Angel.h"
+#include <cstddef>
+
+// Ring of staging segments for updating GPU buffers while the GPU may still be
+// reading them. Data is written into an unsynchronized mapping of the current
+// segment and copied into the destination on the GPU with glCopyBufferSubData,
+// so the CPU never waits for draws that use the destination buffer. Each segment
+// is fenced when submitted and only reused once that fence has signalled.
+class StreamingBuffer {
+public:
+    static const int SEGMENT_COUNT = 3;
+
+    StreamingBuffer();
+    ~StreamingBuffer();
+
+    bool Init(size_t segmentSize);
+    bool IsInitialized() const { return m_buffer != 0; }
+
+    // Stage `size` bytes and queue a copy into `target` at `targetOffset`.
+    // Uploads larger than the free space in a segment spill into the next one.
+    void Upload(GLuint target, size_t targetOffset, const void* data, size_t size);
+
+    // Fence the segment written since the last Submit and advance the ring.
+    void Submit();
+
+    // Number of times an upload had to wait for the GPU to release a segment
+    unsigned int GetStallCount() const { return m_stallCount; }
+
+private:
+    void AcquireSegment();
+    void Cleanup();
+
+    GLuint m_buffer;
+    size_t m_segmentSize;
+    int m_segment;
+    size_t m_cursor;       // Write position inside the current segment
+    bool m_segmentAcquired;
+    GLsync m_fences[SEGMENT_COUNT];
+    unsigned int m_stallCount;
+};
@@ -1,5 +1,6 @@
 #include "../include/stb/stb_image.h"
 #include "Texture.h"
+#include "GLStateCache.h"
 
 Texture::Texture(GLenum TextureTarget, const std::string& FileName)
 {
@@ -7,44 +8,90 @@ Texture::Texture(GLenum TextureTarget, const std::string& FileName)
     m_fileName = FileName;
 }
 
+Texture::~Texture()
+{
+    GLStateCache::GetInstance().DeleteTexture(m_textureObj);
+}
+
+void DecodedImage::Deleter::operator()(unsigned char* pixels) const
+{
+    stbi_image_free(pixels);
+}
+
 bool Texture::Load()
 {
-    stbi_set_flip_vertically_on_load(1);
+    DecodedImage image;
+    return Decode(m_fileName, image) && Upload(image);
+}
+
+bool Texture::Decode(const std::string& fileName, DecodedImage& image, bool flipVertically)
+{
+    // The thread-local flag keeps concurrent decodes from racing on stb's global one
+    stbi_set_flip_vertically_on_load_thread(flipVertically ? 1 : 0);
     int width= 0, height= 0, bpp= 0;
-    unsigned char* image_data = stbi_load(m_fileName.c_str(), &width, &height, &bpp, 0);
+    unsigned char* image_data = stbi_load(fileName.c_str(), &width, &height, &bpp, 0);
     if (!image_data)
     {
-        std::cerr << "Error in loading the texture " << m_fileName << std::endl;
+        std::cerr << "Error in loading the texture " << fileName << std::endl;
         return false;
     }
 
-    glGenTextures(1, &m_textureObj);
-    glBindTexture(m_textureTarget, m_textureObj);
-    if (m_textureTarget == GL_TEXTURE_2D) 
+    image.width = width;
+    image.height = height;
+    image.channels = bpp;
+    image.pixels.reset(image_data);
+    return true;
+}
+
+bool Texture::DecodeFromMemory(const unsigned char* bytes, size_t size, DecodedImage& image, bool flipVertically)
+{
+    stbi_set_flip_vertically_on_load_thread(flipVertically ? 1 : 0);
+    int width= 0, height= 0, bpp= 0;
+    unsigned char* image_data = stbi_load_from_memory(bytes, static_cast<int>(size), &width, &height, &bpp, 0);
+    if (!image_data)
     {
-        GLenum format = GL_RGB;
-        GLenum internalFormat = GL_RGB;
-        if (bpp == 4) {
-            format = GL_RGBA;
-            internalFormat = GL_RGBA;
-        }
-        glTexImage2D(m_textureTarget, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, image_data);
+        std::cerr << "Error in decoding texture data: " << stbi_failure_reason() << std::endl;
+        return false;
     }
-    
-    else
+
+    image.width = width;
+    image.height = height;
+    image.channels = bpp;
+    image.pixels.reset(image_data);
+    return true;
+}
+
+bool Texture::Upload(const DecodedImage& image, bool mipmapped)
+{
+    if (!image.pixels)
+    {
+        std::cerr << "No decoded pixels for texture " << m_fileName << std::endl;
+        return false;
+    }
+    if (m_textureTarget != GL_TEXTURE_2D)
     {
         std::cerr << "Unsupported texture target" << std::endl;
         return false;
     }
 
-    glTexParameterf(m_textureTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glGenTextures(1, &m_textureObj);
+    GLStateCache::GetInstance().BindTexture(m_textureTarget, m_textureObj);
+
+    GLenum format = GL_RGB;
+    GLenum internalFormat = GL_RGB;
+    if (image.channels == 4) {
+        format = GL_RGBA;
+        internalFormat = GL_RGBA;
+    }
+    glTexImage2D(m_textureTarget, 0, internalFormat, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels.get());
+    if (mipmapped) {
+        glGenerateMipmap(m_textureTarget);
+    }
+
+    glTexParameterf(m_textureTarget, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
     glTexParameterf(m_textureTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameterf(m_textureTarget, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameterf(m_textureTarget, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-    glBindTexture(m_textureTarget, 0);
-
-    stbi_image_free(image_data);
     return true;
 }
 
@@ -59,7 +106,7 @@ bool Texture::LoadRawData(int width, int height, int bpp, unsigned char* data) {
         std::cerr << "Error generating texture object for '" << m_fileName << "'" << std::endl;
         return false;
     }
-    glBindTexture(m_textureTarget, m_textureObj);
+    GLStateCache::GetInstance().BindTexture(m_textureTarget, m_textureObj);
 
     GLenum internalFormat = GL_RGB;
     GLenum format = GL_RGB;
@@ -76,8 +123,7 @@ bool Texture::LoadRawData(int width, int height, int bpp, unsigned char* data) {
         glTexImage2D(m_textureTarget, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, data);
     } else {
         std::cerr << "Unsupported texture target in LoadRawData for '" << m_fileName << "'" << std::endl;
-        glBindTexture(m_textureTarget, 0); // Unbind before returning false
-        glDeleteTextures(1, &m_textureObj); // Clean up generated texture object
+        GLStateCache::GetInstance().DeleteTexture(m_textureObj); // Clean up generated texture object
         m_textureObj = 0;
         return false;
     }
@@ -90,14 +136,11 @@ bool Texture::LoadRawData(int width, int height, int bpp, unsigned char* data) {
     
     glGenerateMipmap(m_textureTarget); // Generate mipmaps for better quality at distance
 
-    glBindTexture(m_textureTarget, 0); // Unbind texture
-
     std::cout << "Successfully loaded raw data into texture '" << m_fileName << "' (" << width << "x" << height << ", " << bpp << "bpp)" << std::endl;
     return true;
 }
 
 void Texture::Bind(GLenum TextureUnit)
 {
-    glActiveTexture(TextureUnit);
-    glBindTexture(m_textureTarget, m_textureObj);
+    GLStateCache::GetInstance().BindTexture(TextureUnit - GL_TEXTURE0, m_textureTarget, m_textureObj);
 }
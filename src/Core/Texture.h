@@ -1,19 +1,45 @@
 #pragma once
 
 #include "Angel.h"
+#include <memory>
 #include <string>
 
+// Pixels decoded by stb_image, produced off the GL thread and uploaded later
+struct DecodedImage {
+    struct Deleter { void operator()(unsigned char* pixels) const; };
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::unique_ptr<unsigned char, Deleter> pixels;
+};
+
 class Texture
 {
 public:
     Texture(GLenum TextureTarget, const std::string& FileName);
+    ~Texture();
+
+    // Textures own their GL object; share them through TextureCache instead of copying
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
 
     bool Load();
 
+    // Decode + upload split in two: Decode is thread-safe and touches no GL state,
+    // Upload must run on the context thread. Mipmapped uploads filter trilinearly,
+    // plain ones linearly.
+    static bool Decode(const std::string& fileName, DecodedImage& image, bool flipVertically = true);
+    static bool DecodeFromMemory(const unsigned char* bytes, size_t size, DecodedImage& image, bool flipVertically = true);
+    bool Upload(const DecodedImage& image, bool mipmapped = false);
+
     bool LoadRawData(int width, int height, int bpp, unsigned char* data);
 
     void Bind(GLenum TextureUnit);
 
+    const std::string& GetFileName() const { return m_fileName; }
+    GLuint GetTextureID() const { return m_textureObj; }
+
 private:
     std::string m_fileName;
     GLenum m_textureTarget;
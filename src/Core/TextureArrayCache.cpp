@@ -0,0 +1,303 @@
+#include "TextureArrayCache.h"
+#include "GLStateCache.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+
+const int CLASS_SIZES[TextureArrayCache::SIZE_CLASS_COUNT] = { 256, 512, 1024 };
+// Layers a class's array starts with; it doubles from there
+const GLint INITIAL_CAPACITY = 4;
+
+int mipLevelCount(int size) {
+    int levels = 1;
+    while (size > 1) {
+        size /= 2;
+        ++levels;
+    }
+    return levels;
+}
+
+// The class nearest the image's larger side on a log scale, so it is neither blown up
+// nor shrunk by more than about 1.4x unless it is outside the classes' range
+int sizeClassFor(int width, int height) {
+    const double extent = std::max(width, height);
+    int sizeClass = 0;
+    for (int c = 1; c < TextureArrayCache::SIZE_CLASS_COUNT; ++c) {
+        if (extent >= std::sqrt(static_cast<double>(CLASS_SIZES[c - 1]) * CLASS_SIZES[c])) sizeClass = c;
+    }
+    return sizeClass;
+}
+
+struct Tap {
+    int source;
+    float weight;
+};
+
+// Source texels feeding each destination texel along one axis: their average over the
+// texel's footprint when shrinking, linear interpolation between the nearest two when enlarging
+std::vector<std::vector<Tap>> axisTaps(int sourceLength, int destinationLength) {
+    std::vector<std::vector<Tap>> taps(destinationLength);
+    const float ratio = static_cast<float>(sourceLength) / destinationLength;
+    for (int i = 0; i < destinationLength; ++i) {
+        if (ratio > 1.0f) {
+            const float begin = i * ratio;
+            const float end = begin + ratio;
+            for (int s = static_cast<int>(begin); s < sourceLength && s < end; ++s) {
+                float coverage = std::min(end, s + 1.0f) - std::max(begin, static_cast<float>(s));
+                if (coverage > 0.0f) taps[i].push_back({ s, coverage / ratio });
+            }
+        } else {
+            const float center = (i + 0.5f) * ratio - 0.5f;
+            const int s = static_cast<int>(std::floor(center));
+            const float t = center - s;
+            taps[i].push_back({ std::max(s, 0), 1.0f - t });
+            taps[i].push_back({ std::min(s + 1, sourceLength - 1), t });
+        }
+    }
+    return taps;
+}
+
+// Image as RGBA floats, whatever its channel count
+std::vector<float> expandToRgba(const DecodedImage& image) {
+    std::vector<float> rgba(static_cast<size_t>(image.width) * image.height * 4);
+    const unsigned char* pixels = image.pixels.get();
+    for (size_t i = 0; i < rgba.size() / 4; ++i) {
+        const unsigned char* texel = pixels + i * image.channels;
+        float* out = &rgba[i * 4];
+        switch (image.channels) {
+        case 1: out[0] = out[1] = out[2] = texel[0]; out[3] = 255.0f; break;
+        case 2: out[0] = out[1] = out[2] = texel[0]; out[3] = texel[1]; break;
+        case 3: out[0] = texel[0]; out[1] = texel[1]; out[2] = texel[2]; out[3] = 255.0f; break;
+        default: out[0] = texel[0]; out[1] = texel[1]; out[2] = texel[2]; out[3] = texel[3]; break;
+        }
+    }
+    return rgba;
+}
+
+// Separable resample of an RGBA float image to size x size: rows first, then columns
+std::vector<float> resampleSquare(const std::vector<float>& source, int width, int height, int size) {
+    const std::vector<std::vector<Tap>> columnTaps = axisTaps(width, size);
+    std::vector<float> rows(static_cast<size_t>(size) * height * 4, 0.0f);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < size; ++x) {
+            float* out = &rows[(static_cast<size_t>(y) * size + x) * 4];
+            for (const Tap& tap : columnTaps[x]) {
+                const float* in = &source[(static_cast<size_t>(y) * width + tap.source) * 4];
+                for (int c = 0; c < 4; ++c) out[c] += in[c] * tap.weight;
+            }
+        }
+    }
+
+    const std::vector<std::vector<Tap>> rowTaps = axisTaps(height, size);
+    std::vector<float> square(static_cast<size_t>(size) * size * 4, 0.0f);
+    for (int y = 0; y < size; ++y) {
+        for (const Tap& tap : rowTaps[y]) {
+            const float* in = &rows[static_cast<size_t>(tap.source) * size * 4];
+            float* out = &square[static_cast<size_t>(y) * size * 4];
+            for (int i = 0; i < size * 4; ++i) out[i] += in[i] * tap.weight;
+        }
+    }
+    return square;
+}
+
+// level (size x size) as RGBA8 appended to levels, then every smaller mip by 2x2 averages
+void appendMipChain(std::vector<float> level, int size, std::vector<unsigned char>& levels) {
+    while (true) {
+        for (float value : level) {
+            levels.push_back(static_cast<unsigned char>(std::min(std::max(value + 0.5f, 0.0f), 255.0f)));
+        }
+        if (size == 1) break;
+
+        const int half = size / 2;
+        std::vector<float> next(static_cast<size_t>(half) * half * 4);
+        for (int y = 0; y < half; ++y) {
+            for (int x = 0; x < half; ++x) {
+                for (int c = 0; c < 4; ++c) {
+                    const size_t top = (static_cast<size_t>(2 * y) * size + 2 * x) * 4 + c;
+                    const size_t bottom = top + static_cast<size_t>(size) * 4;
+                    next[(static_cast<size_t>(y) * half + x) * 4 + c] =
+                        (level[top] + level[top + 4] + level[bottom] + level[bottom + 4]) * 0.25f;
+                }
+            }
+        }
+        level.swap(next);
+        size = half;
+    }
+}
+
+// Decodes the image at path and resamples it into its class, mips included
+bool decodeLevels(const std::string& path, int& sizeClass, std::vector<unsigned char>& levels) {
+    DecodedImage image;
+    if (!Texture::Decode(path, image)) return false;
+
+    sizeClass = sizeClassFor(image.width, image.height);
+    const int size = CLASS_SIZES[sizeClass];
+    appendMipChain(resampleSquare(expandToRgba(image), image.width, image.height, size), size, levels);
+    return true;
+}
+
+} // namespace
+
+int TextureArrayCache::getClassSize(int sizeClass) {
+    return CLASS_SIZES[sizeClass];
+}
+
+TextureArrayCache::Layer::~Layer() {
+    TextureArrayCache::getInstance().release(m_sizeClass, m_index);
+}
+
+TextureArrayCache& TextureArrayCache::getInstance() {
+    static TextureArrayCache instance;
+    return instance;
+}
+
+std::shared_ptr<TextureArrayCache::Layer> TextureArrayCache::findByPath(const std::string& canonicalPath) {
+    auto it = m_byPath.find(canonicalPath);
+    if (it == m_byPath.end()) return nullptr;
+    std::shared_ptr<Layer> layer = it->second.lock();
+    if (!layer) m_byPath.erase(it); // Every user released it
+    return layer;
+}
+
+bool TextureArrayCache::isResident(const std::string& canonicalPath) const {
+    auto it = m_byPath.find(canonicalPath);
+    return it != m_byPath.end() && !it->second.expired();
+}
+
+TextureArrayCache::Prepared TextureArrayCache::prepare(const std::string& path) {
+    Prepared prepared;
+
+    std::error_code ec;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, ec);
+    prepared.canonicalPath = ec ? path : canonical.generic_string();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        prepared.resident = isResident(prepared.canonicalPath);
+    }
+    if (!prepared.resident) decodeLevels(path, prepared.sizeClass, prepared.levels);
+    return prepared;
+}
+
+std::shared_ptr<TextureArrayCache::Layer> TextureArrayCache::acquire(Prepared& prepared) {
+    // Another load of the same path may have finished since prepare()
+    std::shared_ptr<Layer> layer;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        layer = findByPath(prepared.canonicalPath);
+    }
+    if (layer) return layer;
+    // Or the layer prepare() found resident may have been released since; resample it here
+    if (prepared.resident && prepared.sizeClass < 0) decodeLevels(prepared.canonicalPath, prepared.sizeClass, prepared.levels);
+    if (prepared.sizeClass < 0) return nullptr;
+
+    layer = upload(prepared.sizeClass, prepared.levels);
+    if (!layer) return nullptr;
+    std::vector<unsigned char>().swap(prepared.levels); // Pixels are on the GPU now
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_byPath[prepared.canonicalPath] = layer;
+    return layer;
+}
+
+std::shared_ptr<TextureArrayCache::Layer> TextureArrayCache::acquireWhite() {
+    std::shared_ptr<Layer> layer = m_white.lock();
+    if (layer) return layer;
+
+    const int size = CLASS_SIZES[0];
+    std::vector<unsigned char> levels;
+    appendMipChain(std::vector<float>(static_cast<size_t>(size) * size * 4, 255.0f), size, levels);
+    layer = upload(0, levels);
+    m_white = layer;
+    return layer;
+}
+
+bool TextureArrayCache::reserveLayer(SizeClass& sizeClass, int classIndex) {
+    if (sizeClass.used < sizeClass.capacity) return true;
+
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    if (sizeClass.capacity >= maxLayers) {
+        std::cerr << "Texture array of " << CLASS_SIZES[classIndex] << "px layers is full ("
+                  << maxLayers << " layers)" << std::endl;
+        return false;
+    }
+
+    const GLint capacity = std::min(std::max(INITIAL_CAPACITY, sizeClass.capacity * 2), maxLayers);
+    const int size = CLASS_SIZES[classIndex];
+    const int levelCount = mipLevelCount(size);
+
+    GLStateCache& state = GLStateCache::GetInstance();
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    state.BindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    for (int level = 0; level < levelCount; ++level) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size >> level, size >> level, capacity, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    if (sizeClass.texture != 0) {
+        // Carry the layers over on the GPU, each mip through a read framebuffer (GL 3.x has
+        // no glCopyImageSubData)
+        GLint previousFramebuffer = 0;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        GLuint framebuffer = 0;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        for (int level = 0; level < levelCount; ++level) {
+            for (GLint layer = 0; layer < sizeClass.used; ++layer) {
+                glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, sizeClass.texture, level, layer);
+                glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, 0, 0, size >> level, size >> level);
+            }
+        }
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+        glDeleteFramebuffers(1, &framebuffer);
+        state.DeleteTexture(sizeClass.texture);
+    }
+
+    sizeClass.texture = texture;
+    sizeClass.capacity = capacity;
+    return true;
+}
+
+std::shared_ptr<TextureArrayCache::Layer> TextureArrayCache::upload(int classIndex, const std::vector<unsigned char>& levels) {
+    SizeClass& sizeClass = m_classes[classIndex];
+    GLint index;
+    if (!sizeClass.freeLayers.empty()) {
+        index = sizeClass.freeLayers.back();
+        sizeClass.freeLayers.pop_back();
+    } else {
+        if (!reserveLayer(sizeClass, classIndex)) return nullptr;
+        index = sizeClass.used++;
+    }
+
+    GLStateCache::GetInstance().BindTexture(GL_TEXTURE_2D_ARRAY, sizeClass.texture);
+    const int size = CLASS_SIZES[classIndex];
+    const unsigned char* pixels = levels.data();
+    for (int level = 0; level < mipLevelCount(size); ++level) {
+        const int levelSize = size >> level;
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, index, levelSize, levelSize, 1,
+                        GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        pixels += static_cast<size_t>(levelSize) * levelSize * 4;
+    }
+    ++sizeClass.liveLayers;
+    return std::make_shared<Layer>(classIndex, index);
+}
+
+void TextureArrayCache::release(int classIndex, GLint index) {
+    SizeClass& sizeClass = m_classes[classIndex];
+    if (--sizeClass.liveLayers > 0) {
+        sizeClass.freeLayers.push_back(index);
+        return;
+    }
+    // Nothing left in the class: give its memory back rather than keep an empty array
+    GLStateCache::GetInstance().DeleteTexture(sizeClass.texture);
+    sizeClass = SizeClass();
+}
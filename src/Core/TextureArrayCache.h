@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Texture.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Object diffuse textures resampled into a few square size classes, one GL_TEXTURE_2D_ARRAY
+// per class. Every texture of a class then binds as the same GL texture and is picked by
+// its layer in the shader, so draws of different materials no longer differ in texture
+// state. Layers are keyed by canonical path and shared like TextureCache entries: a layer
+// is reused once its last handle is dropped, and a class's array is deleted with its last
+// layer. Arrays grow by doubling, copying the resident layers over. Only the context
+// thread holds Layer handles, so layers are only ever released there.
+class TextureArrayCache {
+public:
+    static const int SIZE_CLASS_COUNT = 3;
+    // Edge length of each class's layers (with a full mip chain)
+    static int getClassSize(int sizeClass);
+
+    // A texture's place in its class's array; release the handle to free the layer
+    // (context thread)
+    class Layer {
+    public:
+        Layer(int sizeClass, GLint index) : m_sizeClass(sizeClass), m_index(index) {}
+        ~Layer();
+        Layer(const Layer&) = delete;
+        Layer& operator=(const Layer&) = delete;
+
+        int getSizeClass() const { return m_sizeClass; }
+        GLint getIndex() const { return m_index; }
+
+    private:
+        int m_sizeClass;
+        GLint m_index;
+    };
+
+    static TextureArrayCache& getInstance();
+
+    // CPU half: canonicalizes and, unless the path is resident, decodes the image and
+    // resamples it into its class with the mip chain. Thread-safe and GL-free.
+    struct Prepared {
+        std::string canonicalPath;
+        bool resident = false;             // The path was resident when prepared...
+        int sizeClass = -1;                // ...otherwise set if decoding succeeded...
+        std::vector<unsigned char> levels; // ...with the RGBA8 mip levels, largest first
+    };
+    Prepared prepare(const std::string& path);
+
+    // GL half: returns the cached layer or uploads the prepared levels into a free one
+    // (context thread). nullptr if the image couldn't be loaded or the class is full.
+    std::shared_ptr<Layer> acquire(Prepared& prepared);
+
+    // A white layer of the smallest class, for meshes without a texture (context thread)
+    std::shared_ptr<Layer> acquireWhite();
+
+    // The class's array, 0 while it holds no layer. Growing renames it, so look it up
+    // when drawing rather than keeping it (context thread).
+    GLuint getArrayTexture(int sizeClass) const { return m_classes[sizeClass].texture; }
+    unsigned int getLayerCount(int sizeClass) const { return m_classes[sizeClass].liveLayers; }
+    unsigned int getLayerCapacity(int sizeClass) const { return static_cast<unsigned int>(m_classes[sizeClass].capacity); }
+
+private:
+    TextureArrayCache() = default;
+    TextureArrayCache(const TextureArrayCache&) = delete;
+    TextureArrayCache& operator=(const TextureArrayCache&) = delete;
+
+    struct SizeClass {
+        GLuint texture = 0;
+        GLint capacity = 0;             // Layers allocated in texture
+        GLint used = 0;                 // Layers below this have been handed out at some point
+        std::vector<GLint> freeLayers;  // Handed out and released since
+        unsigned int liveLayers = 0;
+    };
+
+    // Context thread only: locking an entry makes the caller a possible last owner
+    std::shared_ptr<Layer> findByPath(const std::string& canonicalPath);
+    // Any thread
+    bool isResident(const std::string& canonicalPath) const;
+    // Makes room for one more layer; false if the class is at GL's layer limit
+    bool reserveLayer(SizeClass& sizeClass, int classIndex);
+    std::shared_ptr<Layer> upload(int sizeClass, const std::vector<unsigned char>& levels);
+    void release(int sizeClass, GLint index);
+
+    mutable std::mutex m_mutex; // prepare() looks up layers from worker threads
+    std::unordered_map<std::string, std::weak_ptr<Layer>> m_byPath;
+    std::weak_ptr<Layer> m_white;
+    SizeClass m_classes[SIZE_CLASS_COUNT];
+};
@@ -0,0 +1,117 @@
+#include "TextureCache.h"
+#include "AssetLoader.h"
+#include "Hash.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+TextureCache& TextureCache::getInstance() {
+    static TextureCache instance;
+    return instance;
+}
+
+std::shared_ptr<Texture> TextureCache::findByPath(const std::string& canonicalPath, bool mipmapped) {
+    auto& byPath = m_byPath[mipmapped];
+    auto it = byPath.find(canonicalPath);
+    if (it == byPath.end()) return nullptr;
+    std::shared_ptr<Texture> texture = it->second.lock();
+    if (!texture) byPath.erase(it); // Every user released it
+    return texture;
+}
+
+std::shared_ptr<Texture> TextureCache::findByHash(uint64_t contentHash, bool mipmapped) {
+    auto& byHash = m_byHash[mipmapped];
+    auto it = byHash.find(contentHash);
+    if (it == byHash.end()) return nullptr;
+    std::shared_ptr<Texture> texture = it->second.lock();
+    if (!texture) byHash.erase(it);
+    return texture;
+}
+
+bool TextureCache::isResident(const std::string& canonicalPath, bool mipmapped) const {
+    auto it = m_byPath[mipmapped].find(canonicalPath);
+    return it != m_byPath[mipmapped].end() && !it->second.expired();
+}
+
+bool TextureCache::isResident(uint64_t contentHash, bool mipmapped) const {
+    auto it = m_byHash[mipmapped].find(contentHash);
+    return it != m_byHash[mipmapped].end() && !it->second.expired();
+}
+
+TextureCache::Prepared TextureCache::prepare(const std::string& path, bool mipmapped) {
+    Prepared prepared;
+    prepared.mipmapped = mipmapped;
+
+    std::error_code ec;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, ec);
+    prepared.canonicalPath = ec ? path : canonical.generic_string();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        prepared.resident = isResident(prepared.canonicalPath, mipmapped);
+    }
+    if (prepared.resident) return prepared;
+
+    // The contents are needed for the hash anyway, so decode from memory afterwards
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Error in loading the texture " << path << std::endl;
+        return prepared;
+    }
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    prepared.contentHash = Hash::Fnv1a64(bytes.data(), bytes.size());
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        prepared.resident = isResident(prepared.contentHash, mipmapped);
+    }
+    if (prepared.resident) return prepared;
+
+    if (!Texture::DecodeFromMemory(bytes.data(), bytes.size(), prepared.image)) {
+        std::cerr << "Error in loading the texture " << path << std::endl;
+    }
+    return prepared;
+}
+
+std::shared_ptr<Texture> TextureCache::acquire(Prepared& prepared) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Another load of the same path or contents may have finished since prepare()
+    std::shared_ptr<Texture> texture = findByPath(prepared.canonicalPath, prepared.mipmapped);
+    if (!texture && prepared.contentHash != 0) texture = findByHash(prepared.contentHash, prepared.mipmapped);
+
+    if (texture) {
+        ++m_hitCount;
+    } else {
+        // Or the resident copy prepare() found may have been released since; decode it here
+        if (prepared.resident && !prepared.image.pixels) Texture::Decode(prepared.canonicalPath, prepared.image);
+        if (!prepared.image.pixels) return nullptr;
+        texture = std::make_shared<Texture>(GL_TEXTURE_2D, prepared.canonicalPath);
+        if (!texture->Upload(prepared.image, prepared.mipmapped)) return nullptr;
+        prepared.image = DecodedImage(); // Pixels are on the GPU now
+        ++m_uploadCount;
+    }
+
+    m_byPath[prepared.mipmapped][prepared.canonicalPath] = texture;
+    if (prepared.contentHash != 0) m_byHash[prepared.mipmapped][prepared.contentHash] = texture;
+    return texture;
+}
+
+std::shared_ptr<Texture> TextureCache::acquire(const std::string& path, bool mipmapped) {
+    Prepared prepared = prepare(path, mipmapped);
+    return acquire(prepared);
+}
+
+void TextureCache::acquireAsync(const std::string& path, AssetLoader& loader,
+                                std::function<void(std::shared_ptr<Texture>)> onLoaded, bool mipmapped) {
+    loader.Submit([this, path, onLoaded, mipmapped]() -> AssetLoader::GLTask {
+        // shared_ptr because std::function needs a copyable callable
+        auto prepared = std::make_shared<Prepared>(prepare(path, mipmapped));
+        return [this, prepared, onLoaded]() {
+            std::shared_ptr<Texture> texture = acquire(*prepared);
+            if (onLoaded) onLoaded(texture);
+        };
+    });
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Texture.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class AssetLoader;
+
+// Process-wide cache of 2D textures shared by terrain, objects and UI.
+// Entries are keyed by canonical path and by a hash of the file contents, so the
+// same file reached through different paths, or byte-identical copies of it,
+// are decoded and uploaded once. Mipmapped and plain uploads are cached apart.
+// Handles are shared_ptrs: the GL texture is released when the last user drops its
+// handle, which only ever happens on the context thread (workers never hold one).
+class TextureCache {
+public:
+    static TextureCache& getInstance();
+
+    // CPU half of a load: canonicalizes, reads, hashes and, unless the contents are
+    // already cached, decodes. Thread-safe and GL-free, so it can run on a worker.
+    struct Prepared {
+        std::string canonicalPath;
+        uint64_t contentHash = 0;
+        bool mipmapped = false;
+        bool resident = false; // The path or contents were cached when prepared...
+        DecodedImage image;    // ...otherwise the decoded pixels, if decoding succeeded
+    };
+    Prepared prepare(const std::string& path, bool mipmapped = false);
+
+    // GL half: returns the cached texture or uploads the prepared image (context thread)
+    std::shared_ptr<Texture> acquire(Prepared& prepared);
+
+    // Both halves on the calling (context) thread
+    std::shared_ptr<Texture> acquire(const std::string& path, bool mipmapped = false);
+
+    // prepare() on a loader worker, acquire() from its completion queue; onLoaded gets
+    // nullptr if the image couldn't be loaded
+    void acquireAsync(const std::string& path, AssetLoader& loader,
+                      std::function<void(std::shared_ptr<Texture>)> onLoaded, bool mipmapped = false);
+
+    // Number of textures uploaded vs. requests served from the cache
+    unsigned int getUploadCount() const { return m_uploadCount; }
+    unsigned int getHitCount() const { return m_hitCount; }
+
+private:
+    TextureCache() : m_uploadCount(0), m_hitCount(0) {}
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // Context thread only: locking an entry makes the caller a possible last owner
+    std::shared_ptr<Texture> findByPath(const std::string& canonicalPath, bool mipmapped);
+    std::shared_ptr<Texture> findByHash(uint64_t contentHash, bool mipmapped);
+    // Any thread
+    bool isResident(const std::string& canonicalPath, bool mipmapped) const;
+    bool isResident(uint64_t contentHash, bool mipmapped) const;
+
+    mutable std::mutex m_mutex; // prepare() looks up entries from worker threads
+    std::unordered_map<std::string, std::weak_ptr<Texture>> m_byPath[2]; // Indexed by mipmapped
+    std::unordered_map<uint64_t, std::weak_ptr<Texture>> m_byHash[2];
+    unsigned int m_uploadCount;
+    unsigned int m_hitCount;
+};
@@ -14,14 +14,10 @@ Window::Window(int width, int height, const std::string& title)
     }
     
     // Configure GLFW
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
     glfwWindowHint(GLFW_RESIZABLE, GL_TRUE);
     
     // Create window
-    m_window = glfwCreateWindow(width, height, title.c_str(), NULL, NULL);
+    m_window = createContextWindow(width, height, title.c_str());
     if (!m_window) {
         std::cerr << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -48,6 +44,25 @@ Window::Window(int width, int height, const std::string& title)
     glfwSetFramebufferSizeCallback(m_window, framebufferSizeCallback);
 }
 
+GLFWwindow* Window::createContextWindow(int width, int height, const char* title) {
+    // 4.3 brings multi-draw indirect into core; 4.1 is as far as macOS goes
+    const int versions[][2] = { { 4, 6 }, { 4, 5 }, { 4, 3 }, { 4, 1 } };
+    const int versionCount = sizeof(versions) / sizeof(versions[0]);
+
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    GLFWwindow* window = nullptr;
+    for (int i = 0; i < versionCount && !window; ++i) {
+        // Only the last refusal is an error worth reporting
+        glfwSetErrorCallback(i + 1 < versionCount ? nullptr : errorCallback);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, versions[i][0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, versions[i][1]);
+        window = glfwCreateWindow(width, height, title, NULL, NULL);
+    }
+    glfwSetErrorCallback(errorCallback);
+    return window;
+}
+
 Window::~Window() {
     if (m_window) {
         glfwDestroyWindow(m_window);
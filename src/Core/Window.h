@@ -15,6 +15,11 @@ public:
     void swapBuffers();
     void pollEvents();
     
+    // Creates a window with the newest core context the shaders can run on, trying
+    // 4.6 down to 4.1 (they are #version 410). Other window hints are left to the caller.
+    // nullptr if the driver offers none of them.
+    static GLFWwindow* createContextWindow(int width, int height, const char* title);
+
     // Getters
     GLFWwindow* getHandle() const { return m_window; }
     int getWidth() const { return m_width; }
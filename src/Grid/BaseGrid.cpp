@@ -26,7 +26,8 @@ void BaseGrid::Init(int width, int depth, float worldScale, float textureScale)
     }
 
     // Initialize the mesh
-    // The GridMesh will call back to the virtual GetHeight() of the derived class.
+    // The GridMesh reads GetHeightData() when the derived class provides it and
+    // only falls back to the virtual GetHeight() otherwise.
     m_gridMesh->CreateMesh(width, depth, this);
 }
 
@@ -39,3 +40,10 @@ void BaseGrid::Render()
         m_gridMesh->Render();
     }
 }
+
+void BaseGrid::Render(const FrustumCulling::Frustum& frustum)
+{
+    if (m_gridMesh) {
+        m_gridMesh->Render(frustum);
+    }
+}
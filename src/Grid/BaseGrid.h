@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Angel.h"
+#include "../Core/FrustumCulling.h"
 // #include "../Core/Texture.h" // Texture.h might not be needed directly by BaseGrid anymore
 #include <vector>
 #include <memory> // Still useful for m_gridMesh if it were a smart pointer, but it's raw now.
@@ -25,6 +26,8 @@ public:
 
     virtual void Init(int width, int depth, float worldScale, float textureScale);
     virtual void Render();
+    // Draws only the parts of the grid that may be inside `frustum`
+    void Render(const FrustumCulling::Frustum& frustum);
     
     // Accessors
     float GetWorldScale() const { return m_worldScale; }
@@ -34,6 +37,13 @@ public:
     
     // Pure virtual method to get height at a position
     virtual float GetHeight(int x, int z) const = 0;
+
+    // Raw row-major heights (width * depth values) if the grid stores them, else nullptr.
+    // GridMesh uses this to build the mesh without a virtual call per height.
+    virtual const float* GetHeightData() const { return nullptr; }
+
+    // Height range used for the default splat weights
+    virtual void GetHeightRange(float& minHeight, float& maxHeight) const { minHeight = 0.0f; maxHeight = 1.0f; }
     
     // Removed: Methods to set up terrain textures for GPU blending
     // void AddTerrainTextureLayer(const std::string& texturePath, float transitionHeight);
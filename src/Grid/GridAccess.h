@@ -0,0 +1,30 @@
+#pragma once
+
+#include "BaseGrid.h"
+#include <cstddef>
+
+// Grid-access policies for GridMesh's build kernels. The kernels are templated on
+// the policy so that height reads are inlined: HeightmapGridAccess reads a raw
+// row-major array with no bounds checks or virtual dispatch, VirtualGridAccess
+// falls back to BaseGrid::GetHeight for grids that do not expose their heights.
+// Coordinates passed to Height() are always inside [0, width) x [0, depth).
+
+struct HeightmapGridAccess {
+    const float* heights;
+    int width;
+    int depth;
+    float worldScale;
+    float textureScale;
+
+    float Height(int x, int z) const { return heights[static_cast<size_t>(z) * width + x]; }
+};
+
+struct VirtualGridAccess {
+    const BaseGrid* grid;
+    int width;
+    int depth;
+    float worldScale;
+    float textureScale;
+
+    float Height(int x, int z) const { return grid->GetHeight(x, z); }
+};
@@ -1,8 +1,11 @@
 #include "GridMesh.h"
 #include "BaseGrid.h"
-#include "TerrainGrid.h"
+#include "GridAccess.h"
+#include "../Core/GLStateCache.h"
 #include <cassert>
 #include <algorithm>
+#include <limits>
+#include <type_traits>
 
 GridMesh::GridMesh()
 {
@@ -11,7 +14,7 @@ GridMesh::GridMesh()
 GridMesh::~GridMesh()
 {
     // Cleanup OpenGL resources
-    glDeleteVertexArrays(1, &m_vao);
+    GLStateCache::GetInstance().DeleteVertexArray(m_vao);
     glDeleteBuffers(1, &m_vb);
     glDeleteBuffers(1, &m_ib);
 }
@@ -27,7 +30,7 @@ void GridMesh::CreateMesh(int width, int depth, const BaseGrid* baseGrid)
     // Populate buffers
     PopulateBuffers(baseGrid);
 
-    glBindVertexArray(0);
+    GLStateCache::GetInstance().BindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
@@ -36,7 +39,7 @@ void GridMesh::CreateGLState()
 {
     // Create vertex array object
     glGenVertexArrays(1, &m_vao);
-    glBindVertexArray(m_vao);
+    GLStateCache::GetInstance().BindVertexArray(m_vao);
     
     // Create vertex buffer
     glGenBuffers(1, &m_vb);
@@ -83,21 +86,40 @@ void GridMesh::PopulateBuffers(const BaseGrid* baseGrid)
 {
     // Ensure m_vertices is the member variable
     m_vertices.resize(m_width * m_depth); // m_width and m_depth are GridMesh members
-    InitVertices(baseGrid, m_vertices);    // Pass the member m_vertices
+
+    // Pick the access policy once; the per-vertex loops are instantiated for it
+    float minHeight, maxHeight;
+    baseGrid->GetHeightRange(minHeight, maxHeight);
+    if (const float* heights = baseGrid->GetHeightData()) {
+        HeightmapGridAccess grid{ heights, m_width, m_depth, baseGrid->GetWorldScale(), baseGrid->GetTextureScale() };
+        InitVertices(grid, minHeight, maxHeight, m_vertices);
+    } else {
+        VirtualGridAccess grid{ baseGrid, m_width, m_depth, baseGrid->GetWorldScale(), baseGrid->GetTextureScale() };
+        InitVertices(grid, minHeight, maxHeight, m_vertices);
+    }
     
-    // Create indices
-    std::vector<unsigned int> indices;
-    int numQuads = (m_width - 1) * (m_depth - 1);
-    indices.resize(numQuads * 6); // 2 triangles per quad, 3 indices per triangle
+    // Split the grid into tiles and create the shared strip indices
+    InitTiles();
+    std::vector<GLushort> indices;
     InitIndices(indices);
     
-    // Send vertex data to GPU
+    // Lay the row-major vertices out tile by tile and send them to the GPU
+    std::vector<Vertex> tileVertices;
+    tileVertices.reserve(m_gpuVertexCount);
+    for (Tile& tile : m_tiles) {
+        UpdateTileBounds(tile);
+        GatherTileRows(tile, tile.z0, tile.z0 + tile.depth - 1);
+        tileVertices.insert(tileVertices.end(), m_uploadScratch.begin(), m_uploadScratch.end());
+    }
     glBindBuffer(GL_ARRAY_BUFFER, m_vb); // Bind m_vb before glBufferData
-    if (!m_vertices.empty()) {
-        glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * m_vertices.size(), m_vertices.data(), GL_STATIC_DRAW);
+    if (!tileVertices.empty()) {
+        glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * tileVertices.size(), tileVertices.data(), GL_STATIC_DRAW);
     } else {
         glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STATIC_DRAW); // Handle empty case
     }
+
+    // Edits stream through a small ring; a full re-upload is split across its segments
+    m_uploadRing.Init(std::min(sizeof(Vertex) * m_gpuVertexCount, MAX_UPLOAD_SEGMENT_BYTES));
     
     // Send index data to GPU
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ib); // Bind m_ib before glBufferData
@@ -108,44 +130,160 @@ void GridMesh::PopulateBuffers(const BaseGrid* baseGrid)
     }
 }
 
-void GridMesh::InitVertices(const BaseGrid* baseGrid, std::vector<Vertex>& vertices_ref)
+void GridMesh::InitTiles()
 {
-    const TerrainGrid* terrainGrid = dynamic_cast<const TerrainGrid*>(baseGrid);
-    float minHeight = terrainGrid ? terrainGrid->GetMinHeight() : 0.0f;
-    float maxHeight = terrainGrid ? terrainGrid->GetMaxHeight() : 1.0f;
+    m_tiles.clear();
+    m_gpuVertexCount = 0;
+    if (m_width < 2 || m_depth < 2) return;
 
-    int index = 0;
-    
-    for (int z = 0; z < m_depth; z++) { // Use GridMesh's m_depth
-        for (int x = 0; x < m_width; x++) { // Use GridMesh's m_width
-            if (index < vertices_ref.size()) { // Check bounds
-                vertices_ref[index].InitPosAndTex(baseGrid, x, z);
-                vertices_ref[index].InitSplatWeights(baseGrid, x, z, minHeight, maxHeight);
-            }
-            index++;
+    for (int z0 = 0; z0 < m_depth - 1; z0 += TILE_QUADS) {
+        for (int x0 = 0; x0 < m_width - 1; x0 += TILE_QUADS) {
+            Tile tile;
+            tile.x0 = x0;
+            tile.z0 = z0;
+            tile.width = std::min(TILE_QUADS, m_width - 1 - x0) + 1;
+            tile.depth = std::min(TILE_QUADS, m_depth - 1 - z0) + 1;
+            tile.baseVertex = static_cast<GLint>(m_gpuVertexCount);
+            m_gpuVertexCount += static_cast<size_t>(tile.width) * tile.depth;
+            m_tiles.push_back(tile);
+        }
+    }
+}
+
+void GridMesh::InitIndices(std::vector<GLushort>& indices)
+{
+    // One strip list per distinct tile size: at most four (interior, right, top, corner)
+    m_stripRanges.clear();
+    for (Tile& tile : m_tiles) {
+        auto key = std::make_pair(tile.width, tile.depth);
+        auto it = m_stripRanges.find(key);
+        if (it == m_stripRanges.end()) {
+            size_t offset = indices.size() * sizeof(GLushort);
+            std::vector<GLushort> strip;
+            InitStripIndices(tile.width, tile.depth, strip);
+            indices.insert(indices.end(), strip.begin(), strip.end());
+            it = m_stripRanges.emplace(key, std::make_pair(offset, static_cast<GLsizei>(strip.size()))).first;
+        }
+        tile.indexOffset = it->second.first;
+        tile.indexCount = it->second.second;
+    }
+}
+
+void GridMesh::InitStripIndices(int tileWidth, int tileDepth, std::vector<GLushort>& indices) const
+{
+    assert(tileWidth * tileDepth <= PRIMITIVE_RESTART_INDEX);
+
+    // One strip per row of quads, zig-zagging (x, z) -> (x, z + 1) from left to right.
+    // This keeps the counter-clockwise winding of the old triangle list; rows are
+    // separated by the restart index.
+    indices.clear();
+    indices.reserve((tileDepth - 1) * (2 * tileWidth + 1));
+    for (int z = 0; z < tileDepth - 1; z++) {
+        if (z > 0) {
+            indices.push_back(PRIMITIVE_RESTART_INDEX);
+        }
+        for (int x = 0; x < tileWidth; x++) {
+            indices.push_back(static_cast<GLushort>(z * tileWidth + x));
+            indices.push_back(static_cast<GLushort>((z + 1) * tileWidth + x));
+        }
+    }
+}
+
+void GridMesh::UpdateTileBounds(Tile& tile)
+{
+    tile.boundsMin = vec3(std::numeric_limits<float>::max());
+    tile.boundsMax = vec3(-std::numeric_limits<float>::max());
+    for (int z = tile.z0; z < tile.z0 + tile.depth; z++) {
+        const Vertex* row = &m_vertices[static_cast<size_t>(z) * m_width + tile.x0];
+        for (int x = 0; x < tile.width; x++) {
+            const vec3& p = row[x].position;
+            tile.boundsMin = vec3(std::min(tile.boundsMin.x, p.x), std::min(tile.boundsMin.y, p.y), std::min(tile.boundsMin.z, p.z));
+            tile.boundsMax = vec3(std::max(tile.boundsMax.x, p.x), std::max(tile.boundsMax.y, p.y), std::max(tile.boundsMax.z, p.z));
+        }
+    }
+    m_tileBoundsDirty = true;
+}
+
+void GridMesh::GatherTileRows(const Tile& tile, int rowBegin, int rowEnd)
+{
+    m_uploadScratch.clear();
+    for (int z = rowBegin; z <= rowEnd; z++) {
+        auto rowStart = m_vertices.begin() + static_cast<size_t>(z) * m_width + tile.x0;
+        m_uploadScratch.insert(m_uploadScratch.end(), rowStart, rowStart + tile.width);
+    }
+}
+
+template <typename GridAccess>
+void GridMesh::InitVertices(const GridAccess& grid, float minHeight, float maxHeight, std::vector<Vertex>& vertices_ref)
+{
+    if (vertices_ref.size() < static_cast<size_t>(grid.width) * grid.depth) return;
+
+    vec2 texStep(grid.width > 1 ? grid.textureScale / (grid.width - 1) : 0.0f,
+                 grid.depth > 1 ? grid.textureScale / (grid.depth - 1) : 0.0f);
+
+    for (int z = 0; z < grid.depth; z++) {
+        Vertex* row = &vertices_ref[static_cast<size_t>(z) * grid.width];
+        for (int x = 0; x < grid.width; x++) {
+            float height = grid.Height(x, z);
+            row[x].InitPosAndTex(height, x, z, grid.worldScale, texStep);
+            row[x].InitSplatWeights(height, minHeight, maxHeight);
         }
     }
     
     // After all positions are set, calculate normals using the same vertices_ref
-    CalculateNormals(baseGrid, vertices_ref);
+    BuildNormals(grid, vertices_ref);
+}
+
+void GridMesh::CalculateNormals(const float* heightMap, float worldScale, const TerrainNormals::Rect& rect)
+{
+    if (!heightMap || m_vertices.empty()) return;
+
+    bool fullGrid = rect.minX <= 0 && rect.minZ <= 0 && rect.maxX >= m_width - 1 && rect.maxZ >= m_depth - 1;
+    if (fullGrid) {
+        TerrainNormals::ComputeAll(heightMap, m_width, m_depth, worldScale, &m_vertices[0].normal, sizeof(Vertex));
+    } else {
+        TerrainNormals::Compute(heightMap, m_width, m_depth, worldScale, rect, &m_vertices[0].normal, sizeof(Vertex));
+    }
 }
 
 void GridMesh::CalculateNormals(const BaseGrid* baseGrid, std::vector<Vertex>& vertices_ref)
 {
     if (!baseGrid) return;
 
-    for (int z = 0; z < m_depth; z++) {
-        for (int x = 0; x < m_width; x++) {
+    if (const float* heights = baseGrid->GetHeightData()) {
+        BuildNormals(HeightmapGridAccess{ heights, m_width, m_depth, baseGrid->GetWorldScale(), baseGrid->GetTextureScale() },
+                         vertices_ref);
+    } else {
+        BuildNormals(VirtualGridAccess{ baseGrid, m_width, m_depth, baseGrid->GetWorldScale(), baseGrid->GetTextureScale() },
+                         vertices_ref);
+    }
+}
+
+template <typename GridAccess>
+void GridMesh::BuildNormals(const GridAccess& grid, std::vector<Vertex>& vertices_ref)
+{
+    if (vertices_ref.size() < static_cast<size_t>(grid.width) * grid.depth || vertices_ref.empty()) return;
+
+    // Raw heights: row-wise SIMD kernel, split across threads for large grids.
+    // Every other policy takes the generic per-vertex loop below.
+    if constexpr (std::is_same_v<GridAccess, HeightmapGridAccess>) {
+        TerrainNormals::ComputeAll(grid.heights, grid.width, grid.depth, grid.worldScale,
+                                   &vertices_ref[0].normal, sizeof(Vertex));
+        return;
+    }
+
+    for (int z = 0; z < grid.depth; z++) {
+        for (int x = 0; x < grid.width; x++) {
             // Heights of neighboring points for finite difference
             // Handle boundaries by clamping coordinates
-            float hL = baseGrid->GetHeight(std::max(0, x - 1), z);
-            float hR = baseGrid->GetHeight(std::min(m_width - 1, x + 1), z);
-            float hD = baseGrid->GetHeight(x, std::max(0, z - 1));
-            float hU = baseGrid->GetHeight(x, std::min(m_depth - 1, z + 1));
+            float hL = grid.Height(std::max(0, x - 1), z);
+            float hR = grid.Height(std::min(grid.width - 1, x + 1), z);
+            float hD = grid.Height(x, std::max(0, z - 1));
+            float hU = grid.Height(x, std::min(grid.depth - 1, z + 1));
 
             // If on an edge, the difference is only one-sided for that axis
-            // For x: if x is 0, hL is height at x=0. if x is m_width-1, hR is height at m_width-1.
-            // For z: if z is 0, hD is height at z=0. if z is m_depth-1, hU is height at m_depth-1.
+            // For x: if x is 0, hL is height at x=0. if x is grid.width-1, hR is height at grid.width-1.
+            // For z: if z is 0, hD is height at z=0. if z is grid.depth-1, hU is height at grid.depth-1.
             // This means for edges, the tangent might not be centered, which is acceptable for this method.
 
             // Create two tangent vectors on the surface.
@@ -158,19 +296,19 @@ void GridMesh::CalculateNormals(const BaseGrid* baseGrid, std::vector<Vertex>& v
             vec3 tangentX, tangentZ;
 
             if (x == 0) { // Left edge
-                 tangentX = vec3(baseGrid->GetWorldScale(), baseGrid->GetHeight(x + 1, z) - baseGrid->GetHeight(x, z), 0.0f);
-            } else if (x == m_width - 1) { // Right edge
-                 tangentX = vec3(baseGrid->GetWorldScale(), baseGrid->GetHeight(x, z) - baseGrid->GetHeight(x - 1, z), 0.0f);
+                 tangentX = vec3(grid.worldScale, grid.Height(x + 1, z) - grid.Height(x, z), 0.0f);
+            } else if (x == grid.width - 1) { // Right edge
+                 tangentX = vec3(grid.worldScale, grid.Height(x, z) - grid.Height(x - 1, z), 0.0f);
             } else { // Interior X
-                 tangentX = vec3(2.0f * baseGrid->GetWorldScale(), baseGrid->GetHeight(std::min(m_width - 1, x + 1), z) - baseGrid->GetHeight(std::max(0, x - 1), z), 0.0f);
+                 tangentX = vec3(2.0f * grid.worldScale, grid.Height(std::min(grid.width - 1, x + 1), z) - grid.Height(std::max(0, x - 1), z), 0.0f);
             }
 
             if (z == 0) { // Bottom edge
-                tangentZ = vec3(0.0f, baseGrid->GetHeight(x, z + 1) - baseGrid->GetHeight(x, z), baseGrid->GetWorldScale());
-            } else if (z == m_depth - 1) { // Top edge
-                tangentZ = vec3(0.0f, baseGrid->GetHeight(x, z) - baseGrid->GetHeight(x, z - 1), baseGrid->GetWorldScale());
+                tangentZ = vec3(0.0f, grid.Height(x, z + 1) - grid.Height(x, z), grid.worldScale);
+            } else if (z == grid.depth - 1) { // Top edge
+                tangentZ = vec3(0.0f, grid.Height(x, z) - grid.Height(x, z - 1), grid.worldScale);
             } else { // Interior Z
-                tangentZ = vec3(0.0f, baseGrid->GetHeight(x, std::min(m_depth - 1, z + 1)) - baseGrid->GetHeight(x, std::max(0, z - 1)), 2.0f * baseGrid->GetWorldScale());
+                tangentZ = vec3(0.0f, grid.Height(x, std::min(grid.depth - 1, z + 1)) - grid.Height(x, std::max(0, z - 1)), 2.0f * grid.worldScale);
             }
             
             // The cross product gives the normal. Order matters for direction (Y-up).
@@ -183,39 +321,30 @@ void GridMesh::CalculateNormals(const BaseGrid* baseGrid, std::vector<Vertex>& v
                 normal = vec3(0.0f, 1.0f, 0.0f);
             }
 
-            if ((z * m_width + x) < vertices_ref.size()){ // Check bounds
-                vertices_ref[z * m_width + x].normal = normal;
+            if ((z * grid.width + x) < vertices_ref.size()){ // Check bounds
+                vertices_ref[z * grid.width + x].normal = normal;
             }
         }
     }
 }
 
-void GridMesh::Vertex::InitPosAndTex(const BaseGrid* baseGrid, int x, int z)
+void GridMesh::Vertex::InitPosAndTex(float height, int x, int z, float worldScale, const vec2& texStep)
 {
-    // Get the height from the grid at this position
-    float y = baseGrid->GetHeight(x, z);
-    
     // Set the position using the world scale and height
-    position = vec3(x * baseGrid->GetWorldScale(), y, z * baseGrid->GetWorldScale());
+    position = vec3(x * worldScale, height, z * worldScale);
     
     // Set texture coordinates
-    texCoord = vec2(
-        static_cast<float>(x) / (baseGrid->GetWidth() - 1) * baseGrid->GetTextureScale(),
-        static_cast<float>(z) / (baseGrid->GetDepth() - 1) * baseGrid->GetTextureScale()
-    );
+    texCoord = vec2(x * texStep.x, z * texStep.y);
     
     // Normal will be calculated later
     normal = vec3(0.0f, 1.0f, 0.0f); // Initialize to a default, e.g., pointing up
 }
 
-void GridMesh::Vertex::InitSplatWeights(const BaseGrid* baseGrid, int x, int z, float minHeight, float maxHeight)
+void GridMesh::Vertex::InitSplatWeights(float currentHeight, float minHeight, float maxHeight)
 {
     // Initialize weights to zero
     splatWeights.fill(0.0f);
     
-    // Get current height at this position
-    float currentHeight = baseGrid->GetHeight(x, z);
-    
     // Calculate height-based weights for 5 textures: sand, grass, dirt, rock, snow
     float heightRange = maxHeight - minHeight;
     if (heightRange <= 1e-5f) {
@@ -267,50 +396,71 @@ void GridMesh::Vertex::InitSplatWeights(const BaseGrid* baseGrid, int x, int z,
     }
 }
 
-void GridMesh::InitIndices(std::vector<unsigned int>& indices) // Ensure it's unsigned int
+void GridMesh::Render()
 {
-    int index = 0;
-    
-    for (int z = 0; z < m_depth - 1; z++) {
-        for (int x = 0; x < m_width - 1; x++) {
-            unsigned int indexBottomLeft = z * m_width + x;
-            unsigned int indexTopLeft = (z + 1) * m_width + x;
-            unsigned int indexTopRight = (z + 1) * m_width + x + 1;
-            unsigned int indexBottomRight = z * m_width + x + 1;
-            
-            // Add top left triangle
-            assert(index < (int)indices.size());
-            indices[index++] = indexBottomLeft;
-            assert(index < (int)indices.size());
-            indices[index++] = indexTopLeft;
-            assert(index < (int)indices.size());
-            indices[index++] = indexTopRight;
-            
-            // Add bottom right triangle
-            assert(index < (int)indices.size());
-            indices[index++] = indexBottomLeft;
-            assert(index < (int)indices.size());
-            indices[index++] = indexTopRight;
-            assert(index < (int)indices.size());
-            indices[index++] = indexBottomRight;
+    m_visibleTiles.assign(m_tiles.size(), 1);
+    DrawVisibleTiles();
+}
+
+void GridMesh::Render(const FrustumCulling::Frustum& frustum)
+{
+    if (m_tileBoundsDirty) {
+        m_tileBounds.Clear();
+        for (const Tile& tile : m_tiles) {
+            m_tileBounds.Push(tile.boundsMin, tile.boundsMax);
         }
+        m_tileBoundsDirty = false;
     }
-    
-    assert(index == (int)indices.size());
+    FrustumCulling::CullBoxes(frustum, m_tileBounds, m_visibleTiles);
+    DrawVisibleTiles();
 }
 
-void GridMesh::Render()
+void GridMesh::DrawVisibleTiles()
 {
-    glBindVertexArray(m_vao);
-    glDrawElements(GL_TRIANGLES, (m_width - 1) * (m_depth - 1) * 6, GL_UNSIGNED_INT, NULL);
-    glBindVertexArray(0);
+    GLStateCache& state = GLStateCache::GetInstance();
+    state.BindVertexArray(m_vao);
+    state.SetCapability(GL_PRIMITIVE_RESTART, true);
+    state.PrimitiveRestartIndex(PRIMITIVE_RESTART_INDEX);
+    if (IndirectDrawBuffer::IsSupported()) {
+        m_tileCommands.Clear();
+        for (size_t i = 0; i < m_tiles.size(); ++i) {
+            if (!m_visibleTiles[i]) continue;
+            const Tile& tile = m_tiles[i];
+            m_tileCommands.Add({ static_cast<GLuint>(tile.indexCount), 1,
+                                 static_cast<GLuint>(tile.indexOffset / sizeof(GLushort)), tile.baseVertex, 0 });
+        }
+        m_tileCommands.Upload();
+        m_tileCommands.Draw(GL_TRIANGLE_STRIP, GL_UNSIGNED_SHORT, 0, m_tileCommands.Size());
+    } else {
+        for (size_t i = 0; i < m_tiles.size(); ++i) {
+            if (!m_visibleTiles[i]) continue;
+            const Tile& tile = m_tiles[i];
+            glDrawElementsBaseVertex(GL_TRIANGLE_STRIP, tile.indexCount, GL_UNSIGNED_SHORT,
+                                     (const void*)tile.indexOffset, tile.baseVertex);
+        }
+    }
+    state.SetCapability(GL_PRIMITIVE_RESTART, false); // Object meshes use 32-bit indices and must not restart
 }
 
-void GridMesh::UpdateVertexBuffer()
+void GridMesh::UpdateVertexBuffer(int firstRow, int lastRow)
 {
-    glBindBuffer(GL_ARRAY_BUFFER, m_vb);
-    if (!m_vertices.empty()) { // Check if m_vertices is empty
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Vertex) * m_vertices.size(), m_vertices.data());
+    if (lastRow < 0) lastRow = m_depth - 1;
+    firstRow = std::max(firstRow, 0);
+    lastRow = std::min(lastRow, m_depth - 1);
+    if (firstRow > lastRow || m_vertices.empty() || !m_uploadRing.IsInitialized()) return;
+
+    // Tiles are stored back to back, so each tile's rows inside [firstRow, lastRow]
+    // form one contiguous block of m_vb and need a single staged copy.
+    for (Tile& tile : m_tiles) {
+        int rowBegin = std::max(firstRow, tile.z0);
+        int rowEnd = std::min(lastRow, tile.z0 + tile.depth - 1);
+        if (rowBegin > rowEnd) continue;
+
+        UpdateTileBounds(tile); // Heights may have dropped as well as risen, so the whole tile
+        GatherTileRows(tile, rowBegin, rowEnd);
+        size_t firstVertex = tile.baseVertex + static_cast<size_t>(rowBegin - tile.z0) * tile.width;
+        m_uploadRing.Upload(m_vb, sizeof(Vertex) * firstVertex,
+                            m_uploadScratch.data(), sizeof(Vertex) * m_uploadScratch.size());
     }
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-} 
+    m_uploadRing.Submit();
+}
@@ -1,8 +1,15 @@
 #pragma once
 
 #include "Angel.h"
+#include "../Core/StreamingBuffer.h"
+#include "../Core/FrustumCulling.h"
+#include "../Core/IndirectDrawBuffer.h"
+#include "TerrainNormals.h"
 #include <vector>
 #include <array>
+#include <cstdint>
+#include <map>
+#include <utility>
 
 class BaseGrid; // Forward declaration
 
@@ -11,6 +18,12 @@ public:
     // Constants for texture layers - updated to 5 for sand, grass, dirt, rock, snow
     static const int MAX_TEXTURE_LAYERS = 5;
 
+    // The grid is drawn as square tiles of up to TILE_QUADS x TILE_QUADS quads.
+    // A tile has at most 129x129 vertices, so its local indices fit in 16 bits
+    // and never reach PRIMITIVE_RESTART_INDEX.
+    static constexpr int TILE_QUADS = 128;
+    static constexpr GLushort PRIMITIVE_RESTART_INDEX = 0xFFFF;
+
     // Structure for vertices
     struct Vertex {
         vec3 position;
@@ -20,10 +33,10 @@ public:
 
         // InitVertex will now only initialize position and texCoord.
         // Normals will be calculated in a separate step.
-        void InitPosAndTex(const BaseGrid* baseGrid, int x, int z);
+        void InitPosAndTex(float height, int x, int z, float worldScale, const vec2& texStep);
         
         // Initialize splat weights based on height
-        void InitSplatWeights(const BaseGrid* baseGrid, int x, int z, float minHeight, float maxHeight);
+        void InitSplatWeights(float height, float minHeight, float maxHeight);
         
         // Constructor to initialize splat weights to zero
         Vertex() : splatWeights{} { splatWeights.fill(0.0f); }
@@ -33,9 +46,17 @@ public:
     ~GridMesh();
 
     void CreateMesh(int width, int depth, const BaseGrid* baseGrid);
+    // Draws every tile
     void Render();
-    void UpdateVertexBuffer(); // Add method to update vertex buffer
+    // Draws the tiles whose bounds may be inside `frustum`: one multi-draw indirect call
+    // where supported, one draw per visible tile otherwise
+    void Render(const FrustumCulling::Frustum& frustum);
+    // Upload vertex rows [firstRow, lastRow] (all rows by default) through the streaming ring
+    void UpdateVertexBuffer(int firstRow = 0, int lastRow = -1);
+    // Cold path: uses the grid's raw heights when available, BaseGrid::GetHeight otherwise
     void CalculateNormals(const BaseGrid* baseGrid, std::vector<Vertex>& vertices);
+    // Fast path: read a row-major heightmap directly, recomputing only the normals inside `rect`
+    void CalculateNormals(const float* heightMap, float worldScale, const TerrainNormals::Rect& rect);
 
 
     // Access vertex data
@@ -50,9 +71,35 @@ private:
     // Populate buffers with vertices and indices
     void PopulateBuffers(const BaseGrid* baseGrid);
     
-    // Initialize vertices (positions, texCoords) and then calculate normals
-    void InitVertices(const BaseGrid* baseGrid, std::vector<Vertex>& vertices);
-    void InitIndices(std::vector<unsigned int>& indices);
+    // Initialize vertices (positions, texCoords, splat weights) and then calculate normals.
+    // Templated on a grid-access policy from GridAccess.h so height reads inline.
+    template <typename GridAccess>
+    void InitVertices(const GridAccess& grid, float minHeight, float maxHeight, std::vector<Vertex>& vertices);
+    template <typename GridAccess>
+    void BuildNormals(const GridAccess& grid, std::vector<Vertex>& vertices);
+    void InitIndices(std::vector<GLushort>& indices);
+
+    // Split the grid into tiles and build one strip index list per distinct tile size
+    void InitTiles();
+    void InitStripIndices(int tileWidth, int tileDepth, std::vector<GLushort>& indices) const;
+
+    // A tile owns a contiguous block of vertices in m_vb (tile-local, row-major)
+    // and draws with the strip list shared by every tile of the same size.
+    struct Tile {
+        int x0 = 0, z0 = 0;          // First grid vertex covered by the tile
+        int width = 0, depth = 0;    // Vertex counts (neighbouring tiles share an edge)
+        GLint baseVertex = 0;        // Offset of the tile's vertices in m_vb
+        size_t indexOffset = 0;      // Byte offset of the tile's strip list in m_ib
+        GLsizei indexCount = 0;
+        vec3 boundsMin, boundsMax;   // Of the tile's vertex positions, for culling
+    };
+
+    void UpdateTileBounds(Tile& tile);
+    // Draws the tiles flagged in m_visibleTiles
+    void DrawVisibleTiles();
+
+    // Gather a tile's rows [rowBegin, rowEnd] from the row-major m_vertices into m_uploadScratch
+    void GatherTileRows(const Tile& tile, int rowBegin, int rowEnd);
     
     // Grid dimensions
     int m_width = 0;
@@ -65,4 +112,20 @@ private:
 
     // Vertex data
     std::vector<Vertex> m_vertices;
+
+    // Tiling and the shared strip index lists, keyed by tile vertex size
+    std::vector<Tile> m_tiles;
+    std::map<std::pair<int, int>, std::pair<size_t, GLsizei>> m_stripRanges;
+    size_t m_gpuVertexCount = 0;
+    std::vector<Vertex> m_uploadScratch;
+
+    // Per-pass tile culling; m_tileBounds is rebuilt after tiles' bounds change
+    FrustumCulling::BoxList m_tileBounds;
+    bool m_tileBoundsDirty = true;
+    std::vector<uint8_t> m_visibleTiles;
+    IndirectDrawBuffer m_tileCommands;
+
+    // Staging ring for edit-time uploads so glBufferSubData never waits on the shadow/main passes
+    StreamingBuffer m_uploadRing;
+    static constexpr size_t MAX_UPLOAD_SEGMENT_BYTES = 4 * 1024 * 1024;
 };
@@ -1,6 +1,7 @@
 #include "TerrainGrid.h"
 #include "TerrainGenerator.h"
 #include "GridMesh.h"
+#include "TerrainSampling.h"
 #include <fstream>
 #include <cmath>
 #include <cassert>
@@ -9,7 +10,7 @@
 #include <algorithm>  // Added for std::min/max
 
 TerrainGrid::TerrainGrid() : BaseGrid(), m_terrainType(TerrainType::FLAT), m_minHeight(0.0f), m_maxHeight(0.0f),
-    m_flattenTargetHeight(0.0f), m_isFirstFlattenClick(true)
+    m_flattenTargetHeight(0.0f), m_isFirstFlattenClick(true), m_heightEdits{ 0, 0, -1, -1 }, m_hasHeightEdits(false)
 {
     // m_layerInfo will be default constructed, then set in Init
 }
@@ -124,6 +125,35 @@ float TerrainGrid::GetHeightAtWorldPos(float worldX, float worldZ) const {
     return height;
 }
 
+void TerrainGrid::GetHeightsAtWorldPos(const vec2* positions, float* heights, size_t count, vec3* normals) const
+{
+    TerrainSampling::SampleHeights(m_heightMap.data(), m_width, m_depth, m_worldScale,
+                                   positions, heights, normals, count);
+}
+
+float TerrainGrid::GetSplatWeightAtWorldPos(float worldX, float worldZ, int layer) const
+{
+    if (!m_gridMesh || layer < 0 || layer >= GridMesh::MAX_TEXTURE_LAYERS) return 0.0f;
+
+    float gridX = worldX / m_worldScale;
+    float gridZ = worldZ / m_worldScale;
+    int x0 = static_cast<int>(std::floor(gridX));
+    int z0 = static_cast<int>(std::floor(gridZ));
+    if (x0 < 0 || x0 + 1 >= m_width || z0 < 0 || z0 + 1 >= m_depth) return 0.0f;
+
+    const GridMesh& mesh = *m_gridMesh;
+    float fx = gridX - x0;
+    float fz = gridZ - z0;
+    int index = z0 * m_width + x0;
+    float w00 = mesh.GetVertex(index).splatWeights[layer];
+    float w10 = mesh.GetVertex(index + 1).splatWeights[layer];
+    float w01 = mesh.GetVertex(index + m_width).splatWeights[layer];
+    float w11 = mesh.GetVertex(index + m_width + 1).splatWeights[layer];
+    float w0 = w00 * (1.0f - fx) + w10 * fx;
+    float w1 = w01 * (1.0f - fx) + w11 * fx;
+    return w0 * (1.0f - fz) + w1 * fz;
+}
+
 void TerrainGrid::PaintTexture(float worldX, float worldZ, int textureLayer, float brushRadius, float brushStrength)
 {
     // Convert world coordinates to grid coordinates
@@ -174,7 +204,7 @@ void TerrainGrid::PaintTexture(float worldX, float worldZ, int textureLayer, flo
     }
     
     // Update the mesh to reflect changes
-    UpdateMesh();
+    UpdateMesh(centerX - radiusInGrid, centerZ - radiusInGrid, centerX + radiusInGrid, centerZ + radiusInGrid);
 }
 
 std::vector<std::pair<int, int>> TerrainGrid::Flatten(float worldX, float worldZ, float brushRadius, float brushStrength)
@@ -231,7 +261,8 @@ std::vector<std::pair<int, int>> TerrainGrid::Flatten(float worldX, float worldZ
     }
     
     CalculateMinMaxHeights();
-    UpdateMesh();
+    MarkHeightsEdited(centerX - radiusInGrid, centerZ - radiusInGrid, centerX + radiusInGrid, centerZ + radiusInGrid);
+    UpdateMesh(centerX - radiusInGrid, centerZ - radiusInGrid, centerX + radiusInGrid, centerZ + radiusInGrid);
     
     return m_lastFlattenedPoints;
 }
@@ -290,7 +321,8 @@ std::vector<vec3> TerrainGrid::Dig(float worldX, float worldZ, float brushRadius
     CalculateMinMaxHeights();
     
     // Update the mesh to reflect changes
-    UpdateMesh();
+    MarkHeightsEdited(centerX - radiusInGrid, centerZ - radiusInGrid, centerX + radiusInGrid, centerZ + radiusInGrid);
+    UpdateMesh(centerX - radiusInGrid, centerZ - radiusInGrid, centerX + radiusInGrid, centerZ + radiusInGrid);
     
     return dugPoints;
 }
@@ -319,11 +351,18 @@ void TerrainGrid::NormalizeSplatWeights(int x, int z)
     }
 }
 
-void TerrainGrid::UpdateMesh()
+void TerrainGrid::UpdateMesh(int minX, int minZ, int maxX, int maxZ)
 {
+    if (maxX < 0) maxX = m_width - 1;
+    if (maxZ < 0) maxZ = m_depth - 1;
+    minX = std::max(minX, 0);
+    minZ = std::max(minZ, 0);
+    maxX = std::min(maxX, m_width - 1);
+    maxZ = std::min(maxZ, m_depth - 1);
+
     // Update vertex positions based on new heights
-    for (int z = 0; z < m_depth; z++) {
-        for (int x = 0; x < m_width; x++) {
+    for (int z = minZ; z <= maxZ; z++) {
+        for (int x = minX; x <= maxX; x++) {
             int vertexIndex = z * m_width + x;
             auto& vertex = m_gridMesh->GetVertex(vertexIndex);
             
@@ -333,11 +372,12 @@ void TerrainGrid::UpdateMesh()
         }
     }
     
-    // Recalculate normals after height changes
-    m_gridMesh->CalculateNormals(this, m_gridMesh->GetVertices());
+    // Recalculate normals after height changes; the ring of vertices around the
+    // rectangle uses the changed heights in its finite differences too
+    m_gridMesh->CalculateNormals(m_heightMap.data(), m_worldScale, { minX - 1, minZ - 1, maxX + 1, maxZ + 1 });
     
     // Update the vertex buffer on the GPU
-    m_gridMesh->UpdateVertexBuffer();
+    m_gridMesh->UpdateVertexBuffer(minZ - 1, maxZ + 1);
 }
 
 void TerrainGrid::RaiseTerrain(float worldX, float worldZ, float height, float brushRadius, float brushStrength)
@@ -398,7 +438,35 @@ void TerrainGrid::RaiseTerrain(float worldX, float worldZ, float height, float b
     CalculateMinMaxHeights();
     
     // Update the mesh to reflect changes
-    UpdateMesh();
+    MarkHeightsEdited(centerX - radiusInGrid, centerZ - radiusInGrid, centerX + radiusInGrid, centerZ + radiusInGrid);
+    UpdateMesh(centerX - radiusInGrid, centerZ - radiusInGrid, centerX + radiusInGrid, centerZ + radiusInGrid);
+}
+
+void TerrainGrid::MarkHeightsEdited(int minX, int minZ, int maxX, int maxZ)
+{
+    minX = std::max(minX, 0);
+    minZ = std::max(minZ, 0);
+    maxX = std::min(maxX, m_width - 1);
+    maxZ = std::min(maxZ, m_depth - 1);
+    if (minX > maxX || minZ > maxZ) return;
+
+    if (!m_hasHeightEdits) {
+        m_heightEdits = { minX, minZ, maxX, maxZ };
+        m_hasHeightEdits = true;
+    } else {
+        m_heightEdits.minX = std::min(m_heightEdits.minX, minX);
+        m_heightEdits.minZ = std::min(m_heightEdits.minZ, minZ);
+        m_heightEdits.maxX = std::max(m_heightEdits.maxX, maxX);
+        m_heightEdits.maxZ = std::max(m_heightEdits.maxZ, maxZ);
+    }
+}
+
+bool TerrainGrid::TakeHeightEdits(TerrainNormals::Rect& rect)
+{
+    if (!m_hasHeightEdits) return false;
+    rect = m_heightEdits;
+    m_hasHeightEdits = false;
+    return true;
 }
 
 void TerrainGrid::StoreInitHeightMap()
@@ -2,10 +2,11 @@
 
 #include "BaseGrid.h"
 #include "TerrainGenerator.h"
+#include "TerrainNormals.h"
 #include <vector>
 
 // Terrain grid implementation with height mapping
-class TerrainGrid : public BaseGrid {
+class TerrainGrid final : public BaseGrid {
 public:
     // Use TerrainGenerator's TerrainType and TerrainLayerInfo
     using TerrainType = TerrainGenerator::TerrainType;
@@ -26,9 +27,21 @@ public:
     // Implementation of the pure virtual method from BaseGrid
     virtual float GetHeight(int x, int z) const override;
 
+    // Raw row-major heightmap (width * depth values), for kernels that skip GetHeight
+    virtual const float* GetHeightData() const override { return m_heightMap.data(); }
+    virtual void GetHeightRange(float& minHeight, float& maxHeight) const override { minHeight = m_minHeight; maxHeight = m_maxHeight; }
+
     // Get height at world coordinates with interpolation
     float GetHeightAtWorldPos(float worldX, float worldZ) const;
 
+    // Batched GetHeightAtWorldPos: heights[i] for positions[i] = (worldX, worldZ).
+    // If `normals` is given it also receives the surface normal at each sample.
+    void GetHeightsAtWorldPos(const vec2* positions, float* heights, size_t count, vec3* normals = nullptr) const;
+
+    // Bilinear blend weight of texture layer `layer` at world coordinates, 0 outside the grid.
+    // Reads the mesh's vertices, so it is safe to call from several threads between edits.
+    float GetSplatWeightAtWorldPos(float worldX, float worldZ, int layer) const;
+
     // Getters for terrain properties
     TerrainType GetTerrainType() const;
     const TerrainLayerInfo& GetLayerInfo() const;
@@ -45,7 +58,11 @@ public:
     void RaiseTerrain(float worldX, float worldZ, float height, float brushRadius, float brushStrength); // New function to raise terrain
     void StoreInitHeightMap(); // Store initial heightmap for raising limits
     void ResetFlatteningState(); // Reset the flattening state for new operations
-    void UpdateMesh(); // Force mesh update after painting
+    void UpdateMesh(int minX = 0, int minZ = 0, int maxX = -1, int maxZ = -1); // Force mesh update after painting (only vertices in the rectangle changed)
+
+    // Grid vertices whose height Dig, RaiseTerrain or Flatten changed since the last call,
+    // as one bounding rectangle; false if none did. Lets objects on the terrain follow edits.
+    bool TakeHeightEdits(TerrainNormals::Rect& rect);
     
 private:
     // Heightmap data
@@ -61,6 +78,11 @@ private:
     bool m_isFirstFlattenClick;
     std::vector<std::pair<int, int>> m_lastFlattenedPoints;
 
+    // Union of the height edits not yet taken
+    TerrainNormals::Rect m_heightEdits;
+    bool m_hasHeightEdits;
+
     void CalculateMinMaxHeights(); // Helper to calculate and store min/max
     void NormalizeSplatWeights(int x, int z); // Helper to normalize weights after painting
+    void MarkHeightsEdited(int minX, int minZ, int maxX, int maxZ);
 };
@@ -0,0 +1,141 @@
+#include "TerrainNormals.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TERRAIN_NORMALS_SSE 1
+#endif
+
+namespace {
+
+inline vec3& NormalAt(vec3* normals, size_t stride, size_t index)
+{
+    return *reinterpret_cast<vec3*>(reinterpret_cast<unsigned char*>(normals) + index * stride);
+}
+
+// n = normalize(cross(tangentZ, tangentX)) with tangentX = (spanX, dx, 0) and
+// tangentZ = (0, dz, spanZ) expands to (-spanZ * dx, spanZ * spanX, -spanX * dz).
+inline vec3 NormalFromDifferences(float dx, float dz, float spanX, float spanZ)
+{
+    float nx = -spanZ * dx;
+    float ny = spanZ * spanX;
+    float nz = -spanX * dz;
+    float len = std::sqrt(nx * nx + ny * ny + nz * nz);
+    if (len < 0.0001f) {
+        return vec3(0.0f, 1.0f, 0.0f);
+    }
+    return vec3(nx / len, ny / len, nz / len);
+}
+
+// Normals of row z, columns [minX, maxX]
+void ComputeRow(const float* heights, int width, int depth, float worldScale,
+                int z, int minX, int maxX, vec3* normals, size_t stride)
+{
+    // Rows above and below, clamped at the border; spanZ doubles in the interior
+    int zDown = std::max(0, z - 1);
+    int zUp = std::min(depth - 1, z + 1);
+    float spanZ = worldScale * std::max(1, zUp - zDown);
+
+    const float* row = heights + static_cast<size_t>(z) * width;
+    const float* down = heights + static_cast<size_t>(zDown) * width;
+    const float* up = heights + static_cast<size_t>(zUp) * width;
+    size_t rowIndex = static_cast<size_t>(z) * width;
+
+    auto scalarColumn = [&](int x) {
+        int xLeft = std::max(0, x - 1);
+        int xRight = std::min(width - 1, x + 1);
+        float spanX = worldScale * std::max(1, xRight - xLeft);
+        NormalAt(normals, stride, rowIndex + x) =
+            NormalFromDifferences(row[xRight] - row[xLeft], up[x] - down[x], spanX, spanZ);
+    };
+
+    // Border columns take the one-sided difference; everything between is uniform
+    int interiorBegin = std::max(minX, 1);
+    int interiorEnd = std::min(maxX, width - 2); // inclusive
+    if (interiorBegin > interiorEnd) {
+        for (int x = minX; x <= maxX; x++) scalarColumn(x);
+        return;
+    }
+    for (int x = minX; x < interiorBegin; x++) scalarColumn(x);
+
+    int x = interiorBegin;
+#ifdef TERRAIN_NORMALS_SSE
+    const float spanX = 2.0f * worldScale;
+    const __m128 negSpanZ = _mm_set1_ps(-spanZ);
+    const __m128 negSpanX = _mm_set1_ps(-spanX);
+    const __m128 ny = _mm_set1_ps(spanZ * spanX); // constant across the row
+    const __m128 nySquared = _mm_mul_ps(ny, ny);
+    alignas(16) float outX[4], outY[4], outZ[4];
+
+    for (; x + 3 <= interiorEnd; x += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(row + x + 1), _mm_loadu_ps(row + x - 1));
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(up + x), _mm_loadu_ps(down + x));
+        __m128 nx = _mm_mul_ps(negSpanZ, dx);
+        __m128 nz = _mm_mul_ps(negSpanX, dz);
+
+        // ny > 0, so the length never approaches zero and needs no fallback here
+        __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), nySquared), _mm_mul_ps(nz, nz)));
+        _mm_store_ps(outX, _mm_div_ps(nx, len));
+        _mm_store_ps(outY, _mm_div_ps(ny, len));
+        _mm_store_ps(outZ, _mm_div_ps(nz, len));
+
+        for (int lane = 0; lane < 4; lane++) {
+            vec3& n = NormalAt(normals, stride, rowIndex + x + lane);
+            n.x = outX[lane];
+            n.y = outY[lane];
+            n.z = outZ[lane];
+        }
+    }
+#endif
+    for (; x <= interiorEnd; x++) scalarColumn(x);
+    for (x = interiorEnd + 1; x <= maxX; x++) scalarColumn(x);
+}
+
+} // namespace
+
+void TerrainNormals::Compute(const float* heights, int width, int depth, float worldScale,
+                             Rect rect, vec3* normals, size_t stride)
+{
+    if (!heights || !normals || width <= 0 || depth <= 0) return;
+
+    rect.minX = std::max(rect.minX, 0);
+    rect.minZ = std::max(rect.minZ, 0);
+    rect.maxX = std::min(rect.maxX, width - 1);
+    rect.maxZ = std::min(rect.maxZ, depth - 1);
+
+    for (int z = rect.minZ; z <= rect.maxZ; z++) {
+        ComputeRow(heights, width, depth, worldScale, z, rect.minX, rect.maxX, normals, stride);
+    }
+}
+
+void TerrainNormals::ComputeAll(const float* heights, int width, int depth, float worldScale,
+                                vec3* normals, size_t stride)
+{
+    if (!heights || !normals || width <= 0 || depth <= 0) return;
+
+    size_t vertexCount = static_cast<size_t>(width) * depth;
+    int threadCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    threadCount = std::min(threadCount, depth);
+    if (vertexCount < PARALLEL_VERTEX_THRESHOLD || threadCount <= 1) {
+        Compute(heights, width, depth, worldScale, { 0, 0, width - 1, depth - 1 }, normals, stride);
+        return;
+    }
+
+    // Contiguous bands of rows; every band only reads the heightmap and writes its own rows
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount - 1);
+    int rowsPerBand = (depth + threadCount - 1) / threadCount;
+    for (int band = 1; band < threadCount; band++) {
+        int minZ = band * rowsPerBand;
+        if (minZ >= depth) break;
+        Rect rect = { 0, minZ, width - 1, std::min(depth - 1, minZ + rowsPerBand - 1) };
+        workers.emplace_back(Compute, heights, width, depth, worldScale, rect, normals, stride);
+    }
+    Compute(heights, width, depth, worldScale, { 0, 0, width - 1, rowsPerBand - 1 }, normals, stride);
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Angel.h"
+#include <cstddef>
+
+// Finite-difference vertex normals computed straight from a row-major heightmap.
+// Produces the same normals as GridMesh::CalculateNormals (central differences in
+// the interior, one-sided differences on the border) without going through
+// BaseGrid::GetHeight. Interior columns are processed four at a time with SSE.
+namespace TerrainNormals {
+
+    // Inclusive rectangle of grid vertices
+    struct Rect {
+        int minX, minZ, maxX, maxZ;
+    };
+
+    // Grids with at least this many vertices are split across threads by ComputeAll
+    const size_t PARALLEL_VERTEX_THRESHOLD = 256 * 256;
+
+    // Compute the normals of the vertices inside `rect` (clamped to the grid).
+    // The normal of vertex (x, z) is written to the vec3 at byte offset
+    // (z * width + x) * stride from `normals`, so it can fill an interleaved vertex array.
+    void Compute(const float* heights, int width, int depth, float worldScale,
+                 Rect rect, vec3* normals, size_t stride);
+
+    // Compute every normal of the grid, splitting rows across hardware threads
+    // for large grids.
+    void ComputeAll(const float* heights, int width, int depth, float worldScale,
+                    vec3* normals, size_t stride);
+}
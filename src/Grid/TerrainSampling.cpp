@@ -0,0 +1,139 @@
+#include "TerrainSampling.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TERRAIN_SAMPLING_SSE 1
+#endif
+
+namespace {
+
+// One sample, same arithmetic as TerrainGrid::GetHeightAtWorldPos
+inline void SampleOne(const float* heightMap, int width, int depth, float worldScale,
+                      const vec2& position, float& height, vec3* normal)
+{
+    float gridX = position.x / worldScale;
+    float gridZ = position.y / worldScale;
+    int x0 = static_cast<int>(std::floor(gridX));
+    int z0 = static_cast<int>(std::floor(gridZ));
+
+    if (x0 < 0 || x0 + 1 >= width || z0 < 0 || z0 + 1 >= depth) {
+        height = 0.0f;
+        if (normal) *normal = vec3(0.0f, 1.0f, 0.0f);
+        return;
+    }
+
+    float fx = gridX - x0;
+    float fz = gridZ - z0;
+    const float* row0 = heightMap + static_cast<size_t>(z0) * width + x0;
+    const float* row1 = row0 + width;
+    float h00 = row0[0], h10 = row0[1], h01 = row1[0], h11 = row1[1];
+
+    float h0 = h00 * (1.0f - fx) + h10 * fx;
+    float h1 = h01 * (1.0f - fx) + h11 * fx;
+    height = h0 * (1.0f - fz) + h1 * fz;
+
+    if (normal) {
+        // Gradient of the bilinear patch, in world units
+        float dhdx = ((h10 - h00) * (1.0f - fz) + (h11 - h01) * fz) / worldScale;
+        float dhdz = ((h01 - h00) * (1.0f - fx) + (h11 - h10) * fx) / worldScale;
+        float invLen = 1.0f / std::sqrt(dhdx * dhdx + 1.0f + dhdz * dhdz);
+        *normal = vec3(-dhdx * invLen, invLen, -dhdz * invLen);
+    }
+}
+
+#ifdef TERRAIN_SAMPLING_SSE
+inline __m128 FloorPs(__m128 v)
+{
+    // Truncate, then step down where truncation rounded a negative value up
+    __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+    return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, v), _mm_set1_ps(1.0f)));
+}
+#endif
+
+} // namespace
+
+void TerrainSampling::SampleHeights(const float* heightMap, int width, int depth, float worldScale,
+                                    const vec2* positions, float* heights, vec3* normals, size_t count)
+{
+    if (!heightMap || !positions || !heights) return;
+
+    size_t i = 0;
+#ifdef TERRAIN_SAMPLING_SSE
+    if (width >= 2 && depth >= 2) {
+        const __m128 scale = _mm_set1_ps(worldScale);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128i maxX0 = _mm_set1_epi32(width - 2);
+        const __m128i maxZ0 = _mm_set1_epi32(depth - 2);
+        const __m128i minusOne = _mm_set1_epi32(-1);
+        alignas(16) int cellX[4], cellZ[4];
+        alignas(16) float h00[4], h10[4], h01[4], h11[4];
+        alignas(16) float outNx[4], outNy[4], outNz[4];
+
+        for (; i + 4 <= count; i += 4) {
+            // Deinterleave (x, z) pairs: xz = x0 z0 x1 z1 | x2 z2 x3 z3
+            const float* src = &positions[i].x;
+            __m128 a = _mm_loadu_ps(src);
+            __m128 b = _mm_loadu_ps(src + 4);
+            __m128 gridX = _mm_div_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), scale);
+            __m128 gridZ = _mm_div_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)), scale);
+
+            __m128 floorX = FloorPs(gridX);
+            __m128 floorZ = FloorPs(gridZ);
+            __m128i x0 = _mm_cvttps_epi32(floorX);
+            __m128i z0 = _mm_cvttps_epi32(floorZ);
+
+            // Lanes whose cell (x0..x0+1, z0..z0+1) lies inside the grid:
+            // 0 <= x0 <= width - 2 and 0 <= z0 <= depth - 2 (NaN/huge inputs become INT_MIN)
+            __m128i insideMask = _mm_and_si128(
+                _mm_and_si128(_mm_cmpgt_epi32(x0, minusOne), _mm_cmpgt_epi32(_mm_sub_epi32(maxX0, minusOne), x0)),
+                _mm_and_si128(_mm_cmpgt_epi32(z0, minusOne), _mm_cmpgt_epi32(_mm_sub_epi32(maxZ0, minusOne), z0)));
+
+            // Gather the four corners; lanes outside the grid read cell (0, 0) and are masked below
+            _mm_store_si128(reinterpret_cast<__m128i*>(cellX), _mm_and_si128(x0, insideMask));
+            _mm_store_si128(reinterpret_cast<__m128i*>(cellZ), _mm_and_si128(z0, insideMask));
+            for (int lane = 0; lane < 4; lane++) {
+                const float* row0 = heightMap + static_cast<size_t>(cellZ[lane]) * width + cellX[lane];
+                h00[lane] = row0[0];
+                h10[lane] = row0[1];
+                h01[lane] = row0[width];
+                h11[lane] = row0[width + 1];
+            }
+
+            __m128 fx = _mm_sub_ps(gridX, floorX);
+            __m128 fz = _mm_sub_ps(gridZ, floorZ);
+            __m128 gx = _mm_sub_ps(one, fx);
+            __m128 gz = _mm_sub_ps(one, fz);
+            __m128 v00 = _mm_load_ps(h00), v10 = _mm_load_ps(h10);
+            __m128 v01 = _mm_load_ps(h01), v11 = _mm_load_ps(h11);
+
+            __m128 h0 = _mm_add_ps(_mm_mul_ps(v00, gx), _mm_mul_ps(v10, fx));
+            __m128 h1 = _mm_add_ps(_mm_mul_ps(v01, gx), _mm_mul_ps(v11, fx));
+            __m128 h = _mm_add_ps(_mm_mul_ps(h0, gz), _mm_mul_ps(h1, fz));
+            __m128 mask = _mm_castsi128_ps(insideMask);
+            _mm_storeu_ps(heights + i, _mm_and_ps(h, mask));
+
+            if (normals) {
+                __m128 dhdx = _mm_div_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(v10, v00), gz),
+                                                    _mm_mul_ps(_mm_sub_ps(v11, v01), fz)), scale);
+                __m128 dhdz = _mm_div_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(v01, v00), gx),
+                                                    _mm_mul_ps(_mm_sub_ps(v11, v10), fx)), scale);
+                // Outside the grid the gradient is zeroed, which yields (0, 1, 0)
+                dhdx = _mm_and_ps(dhdx, mask);
+                dhdz = _mm_and_ps(dhdz, mask);
+                __m128 invLen = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dhdx, dhdx), one),
+                                                                       _mm_mul_ps(dhdz, dhdz))));
+                _mm_store_ps(outNx, _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(dhdx, invLen)));
+                _mm_store_ps(outNy, invLen);
+                _mm_store_ps(outNz, _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(dhdz, invLen)));
+                for (int lane = 0; lane < 4; lane++) {
+                    normals[i + lane] = vec3(outNx[lane], outNy[lane], outNz[lane]);
+                }
+            }
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        SampleOne(heightMap, width, depth, worldScale, positions[i], heights[i], normals ? &normals[i] : nullptr);
+    }
+}
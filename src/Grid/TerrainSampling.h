@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Angel.h"
+#include <cstddef>
+
+// Batched bilinear height (and optional normal) queries on a row-major heightmap.
+// Each sample matches TerrainGrid::GetHeightAtWorldPos exactly, including the 0.0
+// result for positions whose interpolation cell is outside the grid. Samples are
+// processed four at a time with SSE; the corner heights are gathered with scalar
+// loads since SSE2 has no gather instruction.
+namespace TerrainSampling {
+
+    // positions[i] = (worldX, worldZ). Writes heights[i] and, if `normals` is not
+    // null, the normal of the bilinear patch at that point ((0, 1, 0) outside the grid).
+    void SampleHeights(const float* heightMap, int width, int depth, float worldScale,
+                       const vec2* positions, float* heights, vec3* normals, size_t count);
+}
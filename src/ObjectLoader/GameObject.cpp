@@ -1,15 +1,17 @@
 #include "GameObject.h"
 #include "Angel.h"
+#include <cmath>
 
-GameObject::GameObject(ObjectLoader& objectLoader){
+GameObject::GameObject(ObjectLoader& objectLoader, TransformStore& transforms, size_t transformIndex){
     this->objectLoader = &objectLoader;
-    position = vec4(0,0,0,1);
-    angleY = 0;
-    angleZ = 0;
-    angleX = 0;
-    scale = 1.0f;
-    UpdateModelMatrix();
+    this->transforms = &transforms;
+    this->transformIndex = transformIndex;
+    worldBoundsDirty = true;
+    worldBoundsResident = false;
+    slot = 0;
+    movedObjects = nullptr;
     isInPlacement = true;
+    lodLevel = 0;
 }
 
 GameObject::~GameObject(){
@@ -17,35 +19,33 @@ GameObject::~GameObject(){
 }
 
 vec4 GameObject::GetPosition(){
-    return position;
+    vec3 position = transforms->GetPosition(transformIndex);
+    return vec4(position.x, position.y, position.z, 1.0f);
 }
 
 void GameObject::SetPosition(vec4 newPosition){
-    this->position = newPosition;
-    UpdateModelMatrix();
+    transforms->SetPosition(transformIndex, vec3(newPosition.x, newPosition.y, newPosition.z));
+    MarkMoved();
 }
 
 void GameObject::Move(vec4 deltaPosition){
-
-    this->position += deltaPosition;
-    UpdateModelMatrix();
+    vec3 position = transforms->GetPosition(transformIndex);
+    transforms->SetPosition(transformIndex, position + vec3(deltaPosition.x, deltaPosition.y, deltaPosition.z));
+    MarkMoved();
 }
 
 void GameObject::RotateY(float deltaAngle){
-
-    this->angleY += deltaAngle;
-    UpdateModelMatrix();
+    transforms->SetRotation(transformIndex, transforms->GetRotation(transformIndex) + vec3(0.0f, deltaAngle, 0.0f));
+    MarkMoved();
 }
 
 void GameObject::RotateZ(float deltaAngle){
-
-    this->angleZ += deltaAngle;
-    UpdateModelMatrix();
+    transforms->SetRotation(transformIndex, transforms->GetRotation(transformIndex) + vec3(0.0f, 0.0f, deltaAngle));
+    MarkMoved();
 }
 void GameObject::RotateX(float deltaAngle){
-
-    this->angleX += deltaAngle;
-    UpdateModelMatrix();
+    transforms->SetRotation(transformIndex, transforms->GetRotation(transformIndex) + vec3(deltaAngle, 0.0f, 0.0f));
+    MarkMoved();
 }
 
 void GameObject::Rotate(float deltaAngle){
@@ -54,40 +54,55 @@ void GameObject::Rotate(float deltaAngle){
 }
 
 void GameObject::Scale(float scaleMultiplier){
-
-    this->scale = scaleMultiplier;
-    UpdateModelMatrix();
-}
-
-void GameObject::UpdateModelMatrix(){
-    mat4 translation = Translate(position.x, position.y, position.z);
-    mat4 rotationX = Angel::RotateX(angleX);
-    mat4 rotationY = Angel::RotateY(angleY);
-    mat4 rotationZ = Angel::RotateZ(angleZ);
-    mat4 scaleMatrix = Angel::Scale(scale, scale, scale);
-    
-    mat4 rotation = rotationZ * rotationY * rotationX;
-    
-    objectModelMatrix = translation * rotation * scaleMatrix;
-}
-
-void GameObject::Render(Shader& shader){
-    shader.setUniform("gModelMatrix", objectModelMatrix);
-    objectLoader->render(shader);
+    transforms->SetScale(transformIndex, scaleMultiplier);
+    MarkMoved();
+}
+
+void GameObject::MarkMoved(){
+    // Queue only on the first change since the bounds were last read; later ones are covered
+    if (!worldBoundsDirty && movedObjects) movedObjects->push_back(slot);
+    worldBoundsDirty = true;
+}
+
+bool GameObject::GetWorldBounds(vec3& boundsMin, vec3& boundsMax){
+    bool recompute = worldBoundsDirty || worldBoundsResident != objectLoader->isResident();
+    if (recompute) {
+        // Same box the placeholder cube is stretched over until the model is resident
+        vec3 localMin = objectLoader->GetBoundingBoxMin();
+        vec3 localExtent = objectLoader->GetBoundingBoxSize() * 0.5f;
+        vec3 localCenter = localMin + localExtent;
+
+        // Transform the center, and take the extent along each world axis from |M|.
+        // The stored matrix is transposed, so m[column][row] is M's element (row, column).
+        const mat4& m = GetInstanceMatrix();
+        vec3 center, extent;
+        for (int row = 0; row < 3; ++row) {
+            center[row] = m[0][row] * localCenter.x + m[1][row] * localCenter.y + m[2][row] * localCenter.z + m[3][row];
+            extent[row] = std::fabs(m[0][row]) * localExtent.x + std::fabs(m[1][row]) * localExtent.y
+                        + std::fabs(m[2][row]) * localExtent.z;
+        }
+        worldBoundsMin = center - extent;
+        worldBoundsMax = center + extent;
+        worldBoundsDirty = false;
+        worldBoundsResident = objectLoader->isResident();
+    }
+    boundsMin = worldBoundsMin;
+    boundsMax = worldBoundsMax;
+    return recompute;
 }
 
 vec3 GameObject::GetBoundingBoxSize() const {
-    return objectLoader->GetBoundingBoxSize() * scale;
+    return objectLoader->GetBoundingBoxSize() * transforms->GetScale(transformIndex);
 }
 
 float GameObject::GetWidth() const {
-    return objectLoader->GetBoundingBoxSize().x * scale;
+    return objectLoader->GetBoundingBoxSize().x * transforms->GetScale(transformIndex);
 }
 
 float GameObject::GetDepth() const {
-    return objectLoader->GetBoundingBoxSize().z * scale;
+    return objectLoader->GetBoundingBoxSize().z * transforms->GetScale(transformIndex);
 }
 
 float GameObject::GetHeight() const {
-    return objectLoader->GetBoundingBoxSize().y * scale;
+    return objectLoader->GetBoundingBoxSize().y * transforms->GetScale(transformIndex);
 }
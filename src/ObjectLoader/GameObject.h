@@ -3,11 +3,12 @@
 
 #include "Angel.h"
 #include "ObjectLoader.h"
-#include "../Core/Shader.h" // Include Shader for Render signature
+#include "TransformStore.h"
 
 class GameObject{
 public:
-    GameObject(ObjectLoader &objectLoader);
+    // The transform lives in `transforms` at transformIndex (see GameObjectManager)
+    GameObject(ObjectLoader &objectLoader, TransformStore& transforms, size_t transformIndex);
     ~GameObject();
     void Move(vec4 pos);
     void SetPosition(vec4 pos);
@@ -17,23 +18,41 @@ public:
     void Rotate(float angle); 
     void Scale(float amount);
     vec4 GetPosition();
-    void Render(Shader& shader); 
-    mat4 objectModelMatrix;
+    ObjectLoader* GetObjectLoader() const { return objectLoader; }
+    // Setters only mark the transform dirty; these are current after TransformStore::Update()
+    mat4 GetModelMatrix() const { return transforms->GetModelMatrix(transformIndex); }
+    const mat4& GetInstanceMatrix() const { return transforms->GetInstanceMatrix(transformIndex); } // Column-major
     bool isInPlacement;
+    int lodLevel; // Chosen by GameObjectManager; kept between frames for LOD hysteresis
     
     // Bounding box methods
     vec3 GetBoundingBoxSize() const;
     float GetWidth() const;  // X dimension
     float GetDepth() const;  // Z dimension
     float GetHeight() const; // Y dimension
+
+    // World-space AABB of the model's bounding box, recomputed only after the
+    // transform changes or the model finishes loading (which replaces its default box).
+    // Like GetModelMatrix, only valid once the store has been updated. Returns whether
+    // the box changed since the last call.
+    bool GetWorldBounds(vec3& boundsMin, vec3& boundsMax);
     
 private:
-    vec4 position;
-    float angleY,angleZ,angleX;
-    float scale;
+    friend class GameObjectManager; // Re-points transformIndex when objects are compacted
+
+    void MarkMoved(); // Invalidates the world bounds and queues the object for the spatial index
+
     ObjectLoader* objectLoader;
-    
-    void UpdateModelMatrix();
+    TransformStore* transforms;
+    size_t transformIndex;
+
+    vec3 worldBoundsMin, worldBoundsMax;
+    bool worldBoundsDirty;
+    bool worldBoundsResident; // Whether the cached box came from the loaded model
+
+    // Set by GameObjectManager: the object's handle slot, and where moves are queued
+    uint32_t slot;
+    std::vector<uint32_t>* movedObjects;
 };
 
 #endif // GAME_OBJECT_H
@@ -1,36 +1,329 @@
 #include "GameObjectManager.h"
 #include "GameObject.h"
 #include "ObjectLoader.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
 
-GameObjectManager::GameObjectManager(){
+namespace {
+// Spatial hash cell edge in world units, a few typical building footprints across
+const float SPATIAL_CELL_SIZE = 16.0f;
+// Most height samples taken along each footprint axis when following terrain edits
+const int MAX_FOOTPRINT_SAMPLES = 8;
+// Slot.denseIndex of slots on the free list
+const uint32_t FREE_SLOT = 0xFFFFFFFFu;
+
+float ProjectedSize(const GameObject& go, const ObjectLoader& objectLoader, const vec3& cameraPosition, float pixelsPerUnit) {
+    mat4 m = go.GetModelMatrix();
+    vec3 boxMin = objectLoader.GetBoundingBoxMin();
+    vec3 boxMax = objectLoader.GetBoundingBoxMax();
+    vec4 center = m * vec4((boxMin + boxMax) * 0.5f, 1.0f);
+
+    // Largest axis scale of the model matrix (Angel matrices are row-major)
+    float maxScale = 0.0f;
+    for (int column = 0; column < 3; ++column) {
+        maxScale = std::max(maxScale, length(vec3(m[0][column], m[1][column], m[2][column])));
+    }
+    float radius = 0.5f * length(boxMax - boxMin) * maxScale;
+    float distance = length(vec3(center.x, center.y, center.z) - cameraPosition);
+    return 2.0f * radius * pixelsPerUnit / std::max(distance, radius); // Camera inside: full size
+}
+}
+
+GameObjectManager::GameObjectManager() : spatialIndex(SPATIAL_CELL_SIZE){
 
 }
 
 GameObjectManager::~GameObjectManager(){
-    // Proper cleanup of dynamically allocated GameObjects
-    for(GameObject* go : gameObjects){
-        delete go;
+
+}
+
+GameObjectHandle GameObjectManager::CreateNewObject(ObjectLoader &objectLoader){
+    uint32_t slotIndex;
+    if (!freeSlots.empty()) {
+        slotIndex = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slotIndex = static_cast<uint32_t>(slots.size());
+        slots.push_back({ 0, 0 });
     }
-    gameObjects.clear();
+    uint32_t denseIndex = static_cast<uint32_t>(gameObjects.size());
+    slots[slotIndex].denseIndex = denseIndex;
+    gameObjects.emplace_back(objectLoader, transforms, transforms.Add());
+    denseToSlot.push_back(slotIndex);
+
+    // Starts with dirty bounds, so queue it by hand; later moves queue themselves
+    GameObject& gameObject = gameObjects.back();
+    gameObject.slot = slotIndex;
+    gameObject.movedObjects = &movedObjects;
+    movedObjects.push_back(slotIndex);
+
+    GameObjectHandle handle;
+    handle.slot = slotIndex;
+    handle.generation = slots[slotIndex].generation;
+    return handle;
 }
 
-int GameObjectManager::CreateNewObject(ObjectLoader &objectLoader){
-    GameObject* gameObject = new GameObject(objectLoader);
-    gameObjects.push_back(gameObject);
-    return gameObjects.size()-1;
+bool GameObjectManager::DestroyObject(GameObjectHandle handle){
+    if (!GetGameObject(handle)) return false;
+
+    Slot& slot = slots[handle.slot];
+    uint32_t denseIndex = slot.denseIndex;
+    uint32_t lastIndex = static_cast<uint32_t>(gameObjects.size() - 1);
+    if (denseIndex != lastIndex) {
+        // Keep the array packed by moving the last object (and its transform) into the hole
+        gameObjects[denseIndex] = gameObjects[lastIndex];
+        gameObjects[denseIndex].transformIndex = denseIndex;
+        denseToSlot[denseIndex] = denseToSlot[lastIndex];
+        slots[denseToSlot[denseIndex]].denseIndex = denseIndex;
+    }
+    transforms.Remove(denseIndex);
+    gameObjects.pop_back();
+    denseToSlot.pop_back();
+    spatialIndex.Remove(handle.slot);
+
+    slot.denseIndex = FREE_SLOT;
+    ++slot.generation;
+    freeSlots.push_back(handle.slot);
+    return true;
 }
 
-GameObject* GameObjectManager::GetGameObject(int index){
-    if (index >= 0 && index < gameObjects.size()) {
-        return gameObjects[index];
+GameObject* GameObjectManager::GetGameObject(GameObjectHandle handle){
+    // A free slot's generation is already past every handle issued for it
+    if (handle.slot < slots.size() && slots[handle.slot].generation == handle.generation) {
+        return &gameObjects[slots[handle.slot].denseIndex];
     }
-    
-    std::cout << "Index Out of Bounds for index " << index << std::endl;
     return nullptr;
 }
 
-void GameObjectManager::RenderAll(Shader& shader){
-    for(int i = 0; i < gameObjects.size(); i++){
-        gameObjects[i]->Render(shader);
+void GameObjectManager::Reserve(size_t count){
+    gameObjects.reserve(count);
+    denseToSlot.reserve(count);
+    slots.reserve(count);
+    freeSlots.reserve(count);
+    transforms.Reserve(count);
+    movedObjects.reserve(count);
+}
+
+GameObjectHandle GameObjectManager::HandleOf(uint32_t slotIndex) const{
+    GameObjectHandle handle;
+    handle.slot = slotIndex;
+    handle.generation = slots[slotIndex].generation;
+    return handle;
+}
+
+void GameObjectManager::SyncSpatialIndex(){
+    if (movedObjects.empty()) return;
+    transforms.Update(); // World bounds are read from the rebuilt matrices
+    for(uint32_t slotIndex : movedObjects){
+        uint32_t denseIndex = slots[slotIndex].denseIndex;
+        if (denseIndex == FREE_SLOT) continue; // Destroyed after it moved
+        vec3 boundsMin, boundsMax;
+        gameObjects[denseIndex].GetWorldBounds(boundsMin, boundsMax);
+        spatialIndex.Update(slotIndex, boundsMin, boundsMax);
+    }
+    movedObjects.clear();
+}
+
+void GameObjectManager::QueryRadius(float centerX, float centerZ, float radius, std::vector<GameObjectHandle>& out){
+    SyncSpatialIndex();
+    queryScratch.clear();
+    spatialIndex.QueryRadius(centerX, centerZ, radius, queryScratch);
+    for(uint32_t slotIndex : queryScratch){
+        out.push_back(HandleOf(slotIndex));
+    }
+}
+
+void GameObjectManager::QueryRect(float minX, float minZ, float maxX, float maxZ, std::vector<GameObjectHandle>& out){
+    SyncSpatialIndex();
+    queryScratch.clear();
+    spatialIndex.QueryRect(minX, minZ, maxX, maxZ, queryScratch);
+    for(uint32_t slotIndex : queryScratch){
+        out.push_back(HandleOf(slotIndex));
+    }
+}
+
+GameObjectHandle GameObjectManager::Raycast(const vec3& origin, const vec3& direction, float maxDistance, float* hitDistance){
+    SyncSpatialIndex();
+    rayHitScratch.clear();
+    spatialIndex.Raycast(origin, direction, maxDistance, rayHitScratch);
+    if (rayHitScratch.empty()) return GameObjectHandle();
+    if (hitDistance) *hitDistance = rayHitScratch.front().distance;
+    return HandleOf(rayHitScratch.front().id);
+}
+
+void GameObjectManager::FollowTerrainEdits(const TerrainGrid& terrain, const TerrainNormals::Rect& edited){
+    scatter.FollowTerrainEdits(terrain, edited);
+
+    // Interpolated heights change in the cells around the edited vertices too
+    const float worldScale = terrain.GetWorldScale();
+    affectedObjects.clear();
+    QueryRect((edited.minX - 1) * worldScale, (edited.minZ - 1) * worldScale,
+              (edited.maxX + 1) * worldScale, (edited.maxZ + 1) * worldScale, affectedObjects);
+    if (affectedObjects.empty()) return;
+
+    // A grid of samples over each footprint, about one per terrain cell
+    snappedObjects.clear();
+    footprintEnds.clear();
+    footprintPositions.clear();
+    for(GameObjectHandle handle : affectedObjects){
+        GameObject* go = GetGameObject(handle);
+        if (go->isInPlacement) continue; // Follows the cursor instead
+
+        vec3 boundsMin, boundsMax;
+        go->GetWorldBounds(boundsMin, boundsMax); // Current, QueryRect synced the index
+        vec3 size = boundsMax - boundsMin;
+        int samplesX = std::min(std::max(static_cast<int>(std::ceil(size.x / worldScale)) + 1, 2), MAX_FOOTPRINT_SAMPLES);
+        int samplesZ = std::min(std::max(static_cast<int>(std::ceil(size.z / worldScale)) + 1, 2), MAX_FOOTPRINT_SAMPLES);
+        for(int z = 0; z < samplesZ; ++z){
+            for(int x = 0; x < samplesX; ++x){
+                footprintPositions.push_back(vec2(boundsMin.x + size.x * x / (samplesX - 1),
+                                                  boundsMin.z + size.z * z / (samplesZ - 1)));
+            }
+        }
+        snappedObjects.push_back(go);
+        footprintEnds.push_back(footprintPositions.size());
+    }
+    if (snappedObjects.empty()) return;
+
+    footprintHeights.resize(footprintPositions.size());
+    terrain.GetHeightsAtWorldPos(footprintPositions.data(), footprintHeights.data(), footprintPositions.size());
+
+    size_t first = 0;
+    for(size_t i = 0; i < snappedObjects.size(); ++i){
+        float sum = 0.0f;
+        for(size_t sample = first; sample < footprintEnds[i]; ++sample){
+            sum += footprintHeights[sample];
+        }
+        float groundHeight = sum / static_cast<float>(footprintEnds[i] - first);
+        first = footprintEnds[i];
+
+        // Placement puts the object origin on the ground, so that is what moves
+        vec4 position = snappedObjects[i]->GetPosition();
+        if (position.y != groundHeight) {
+            snappedObjects[i]->SetPosition(vec4(position.x, groundHeight, position.z, 1.0f));
+        }
+    }
+}
+
+void GameObjectManager::UpdateInstances(const mat4& viewProjection, const mat4& lightSpace,
+                                        const vec3& cameraPosition, float pixelsPerUnit){
+    // Groups persist across frames so their matrix vectors keep their capacity
+    for(InstanceGroup& group : instanceGroups){
+        for(auto& lodSets : group.lodMatrices){
+            for(std::vector<mat4>& matrices : lodSets){
+                matrices.clear();
+            }
+        }
+        std::fill(std::begin(group.lodDistances), std::end(group.lodDistances), std::numeric_limits<float>::max());
+    }
+    for(std::vector<mat4>& matrices : placeholderSets){
+        matrices.clear();
+    }
+
+    // Rebuild the matrices of everything moved since last frame in one batch
+    transforms.Update();
+    SyncSpatialIndex();
+
+    // World boxes are cached on the objects; test them all against both volumes in one go
+    worldBounds.Clear();
+    for(size_t i = 0; i < gameObjects.size(); ++i){
+        vec3 boundsMin, boundsMax;
+        if (gameObjects[i].GetWorldBounds(boundsMin, boundsMax)) {
+            // Moves were synced above, so this is a model that just became resident
+            spatialIndex.Update(denseToSlot[i], boundsMin, boundsMax);
+        }
+        worldBounds.Push(boundsMin, boundsMax);
+    }
+    const FrustumCulling::Frustum mainFrustum = FrustumCulling::FromMatrix(viewProjection);
+    const FrustumCulling::Frustum shadowFrustum = FrustumCulling::FromMatrix(lightSpace);
+    size_t mainVisible = FrustumCulling::CullBoxes(mainFrustum, worldBounds, visibleInMain);
+    size_t shadowVisible = FrustumCulling::CullBoxes(shadowFrustum, worldBounds, visibleInShadow);
+    cullingStats.mainSubmitted = static_cast<unsigned int>(mainVisible);
+    cullingStats.mainCulled = static_cast<unsigned int>(gameObjects.size() - mainVisible);
+    cullingStats.shadowSubmitted = static_cast<unsigned int>(shadowVisible);
+    cullingStats.shadowCulled = static_cast<unsigned int>(gameObjects.size() - shadowVisible);
+
+    for(size_t i = 0; i < gameObjects.size(); ++i){
+        const bool inMain = visibleInMain[i] != 0;
+        const bool inShadow = visibleInShadow[i] != 0;
+        if (!inMain && !inShadow) continue;
+        const InstanceSet set = inMain ? (inShadow ? MAIN_AND_SHADOW : MAIN_ONLY) : SHADOW_ONLY;
+
+        GameObject* go = &gameObjects[i];
+        ObjectLoader* objectLoader = go->GetObjectLoader();
+        auto it = instanceGroupIndices.find(objectLoader);
+        if (it == instanceGroupIndices.end()) {
+            it = instanceGroupIndices.emplace(objectLoader, instanceGroups.size()).first;
+            instanceGroups.emplace_back();
+            instanceGroups.back().objectLoader = objectLoader;
+            std::fill(std::begin(instanceGroups.back().lodDistances), std::end(instanceGroups.back().lodDistances),
+                      std::numeric_limits<float>::max());
+        }
+        // The store already keeps matrices column-major, as the instance attributes read them
+        if (objectLoader->isResident()) {
+            // Shadow-only objects keep the LOD they were last seen at
+            if (inMain) {
+                go->lodLevel = ObjectLoader::selectLod(ProjectedSize(*go, *objectLoader, cameraPosition, pixelsPerUnit), go->lodLevel);
+            }
+            InstanceGroup& group = instanceGroups[it->second];
+            group.lodMatrices[go->lodLevel][set].push_back(go->GetInstanceMatrix());
+            float& nearest = group.lodDistances[go->lodLevel];
+            vec4 position = go->GetPosition();
+            nearest = std::min(nearest, length(vec3(position.x, position.y, position.z) - cameraPosition));
+        } else {
+            // Stretch the unit cube over the (default until loaded) bounding box
+            vec3 boxMin = objectLoader->GetBoundingBoxMin();
+            vec3 boxSize = objectLoader->GetBoundingBoxSize();
+            mat4 boxMatrix = Translate(boxMin.x, boxMin.y, boxMin.z) * Angel::Scale(boxSize.x, boxSize.y, boxSize.z);
+            placeholderSets[set].push_back(transpose(boxMatrix) * go->GetInstanceMatrix()); // transpose(model * box)
+        }
+    }
+
+    for(InstanceGroup& group : instanceGroups){
+        group.modelMatrices.clear();
+        for(int lod = 0; lod < MESH_LOD_COUNT; ++lod){
+            const auto& sets = group.lodMatrices[lod];
+            GLsizei first = static_cast<GLsizei>(group.modelMatrices.size());
+            GLsizei mainOnly = static_cast<GLsizei>(sets[MAIN_ONLY].size());
+            GLsizei both = static_cast<GLsizei>(sets[MAIN_AND_SHADOW].size());
+            GLsizei shadowOnly = static_cast<GLsizei>(sets[SHADOW_ONLY].size());
+            group.mainInstances.first[lod] = first;
+            group.mainInstances.count[lod] = mainOnly + both;
+            group.shadowInstances.first[lod] = first + mainOnly;
+            group.shadowInstances.count[lod] = both + shadowOnly;
+            group.mainInstances.distance[lod] = group.shadowInstances.distance[lod] = group.lodDistances[lod];
+            for(const std::vector<mat4>& matrices : sets){
+                group.modelMatrices.insert(group.modelMatrices.end(), matrices.begin(), matrices.end());
+            }
+        }
+        group.objectLoader->updateInstanceBuffer(group.modelMatrices);
+    }
+
+    placeholderMatrices.clear();
+    for(const std::vector<mat4>& matrices : placeholderSets){
+        placeholderMatrices.insert(placeholderMatrices.end(), matrices.begin(), matrices.end());
+    }
+    placeholderMainCount = static_cast<GLsizei>(placeholderSets[MAIN_ONLY].size() + placeholderSets[MAIN_AND_SHADOW].size());
+    placeholderShadowFirst = static_cast<GLsizei>(placeholderSets[MAIN_ONLY].size());
+    placeholderShadowCount = static_cast<GLsizei>(placeholderSets[MAIN_AND_SHADOW].size() + placeholderSets[SHADOW_ONLY].size());
+    placeholderMesh.updateInstanceBuffer(placeholderMatrices);
+
+    scatter.UpdateVisibility(mainFrustum, shadowFrustum, cameraPosition, pixelsPerUnit);
+}
+
+void GameObjectManager::Enqueue(RenderQueue& queue, const Shader& shader, const ObjectRenderUniforms& uniforms,
+                                RenderPass pass, int lodBias){
+    const bool shadowPass = pass == RenderPass::Shadow;
+    const unsigned int keyPass = shadowPass ? RenderQueue::SHADOW_PASS : RenderQueue::MAIN_PASS;
+    for(InstanceGroup& group : instanceGroups){
+        group.objectLoader->enqueue(queue, keyPass, shader, uniforms, shadowPass ? group.shadowInstances : group.mainInstances, lodBias);
+    }
+    if (shadowPass) {
+        placeholderMesh.enqueue(queue, keyPass, shader, uniforms, placeholderShadowFirst, placeholderShadowCount);
+    } else {
+        placeholderMesh.enqueue(queue, keyPass, shader, uniforms, 0, placeholderMainCount);
     }
+    scatter.Enqueue(queue, shader, uniforms, shadowPass, lodBias);
 }
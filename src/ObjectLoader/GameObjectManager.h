@@ -1,21 +1,142 @@
 #ifndef GAME_OBJECT_MANAGER_H
 #define GAME_OBJECT_MANAGER_H
 
+#include <cstdint>
 #include <vector>
 #include <iostream>
+#include <unordered_map>
 #include "GameObject.h"
-#include "../Core/Shader.h" // Include Shader for RenderAll signature
+#include "PlaceholderMesh.h"
+#include "ScatterLayer.h"
+#include "../Core/Shader.h" // Include Shader for Enqueue signature
+#include "../Core/RenderQueue.h"
+#include "../Core/FrustumCulling.h"
+#include "../Core/SpatialHash.h"
+#include "../Grid/TerrainGrid.h"
+
+// Refers to one GameObject for as long as it exists. Once the object is destroyed every
+// copy of the handle goes stale (GetGameObject returns nullptr), even after its slot is reused.
+struct GameObjectHandle {
+    static const uint32_t INVALID_SLOT = 0xFFFFFFFFu;
+    uint32_t slot = INVALID_SLOT;
+    uint32_t generation = 0;
+
+    bool IsValid() const { return slot != INVALID_SLOT; }
+};
 
 class GameObjectManager{
 public:
+    // Which of the two per-frame instance sets Enqueue draws
+    enum class RenderPass { Main, Shadow };
+
+    // Objects culled and drawn in each pass during the last UpdateInstances, for profiling
+    struct CullingStats {
+        unsigned int mainSubmitted = 0;
+        unsigned int mainCulled = 0;
+        unsigned int shadowSubmitted = 0;
+        unsigned int shadowCulled = 0;
+    };
+
     GameObjectManager();
     ~GameObjectManager();
-    int CreateNewObject(ObjectLoader &objectLoader);
-    GameObject* GetGameObject(int index);
-    void RenderAll(Shader& shader); // Modified to accept a shader
+    // O(1); reuses freed slots and storage, so only growth past the high-water mark allocates
+    GameObjectHandle CreateNewObject(ObjectLoader &objectLoader);
+    // O(1): the last object is moved into the freed place. Returns false for stale handles.
+    bool DestroyObject(GameObjectHandle handle);
+    // nullptr if the object was destroyed. The pointer is invalidated by the next create or destroy.
+    GameObject* GetGameObject(GameObjectHandle handle);
+    // Preallocates room for count objects ahead of bulk placement
+    void Reserve(size_t count);
+    size_t GetObjectCount() const { return gameObjects.size(); }
+
+    // Neighbourhood queries over the objects' world AABBs in xz, through a spatial hash that
+    // follows every move. Matching handles are appended to out; cost scales with the result.
+    void QueryRadius(float centerX, float centerZ, float radius, std::vector<GameObjectHandle>& out);
+    void QueryRect(float minX, float minZ, float maxX, float maxZ, std::vector<GameObjectHandle>& out);
+    // Nearest object whose box the ray enters within maxDistance (an invalid handle if none)
+    GameObjectHandle Raycast(const vec3& origin, const vec3& direction, float maxDistance, float* hitDistance = nullptr);
+
+    // Re-seats the placed objects standing on the grid vertices in `edited` (see
+    // TerrainGrid::TakeHeightEdits): each one's base moves to the mean terrain height under
+    // its footprint, sampled for all of them in one batch. Objects elsewhere aren't visited.
+    // Scattered instances in the area are dropped onto the new surface too.
+    void FollowTerrainEdits(const TerrainGrid& terrain, const TerrainNormals::Rect& edited);
+    // Culls every object's world AABB against the camera frustum (viewProjection) and the
+    // shadow volume (lightSpace), then uploads the survivors grouped by ObjectLoader and LOD,
+    // once per frame. LODs are picked from the projected bounding-sphere size; pixelsPerUnit
+    // is the viewport height / (2 tan(fovy / 2)).
+    void UpdateInstances(const mat4& viewProjection, const mat4& lightSpace,
+                         const vec3& cameraPosition, float pixelsPerUnit);
+    // Queues one instanced draw per mesh and LOD of every loaded model visible in the pass,
+    // plus one for all placeholders of models still loading, plus the scattered instances.
+    // lodBias draws every object that many LODs coarser (for the shadow pass). uniforms must
+    // outlive the queue's Submit.
+    void Enqueue(RenderQueue& queue, const Shader& shader, const ObjectRenderUniforms& uniforms, RenderPass pass,
+                 int lodBias = 0);
+    const CullingStats& GetCullingStats() const { return cullingStats; }
+    // Brush-scattered instances, culled and drawn along with the objects
+    ScatterLayer& GetScatterLayer() { return scatter; }
 
 private:
-    std::vector<GameObject*> gameObjects;
+    // Instances visible in both passes sit between the main-only and shadow-only ones,
+    // so each pass draws one contiguous range per LOD and nothing is uploaded twice
+    enum InstanceSet { MAIN_ONLY, MAIN_AND_SHADOW, SHADOW_ONLY, INSTANCE_SET_COUNT };
+
+    // All placed objects that share an ObjectLoader
+    struct InstanceGroup {
+        ObjectLoader* objectLoader;
+        std::vector<mat4> lodMatrices[MESH_LOD_COUNT][INSTANCE_SET_COUNT]; // Transposed for upload as column-major
+        std::vector<mat4> modelMatrices;                                   // lodMatrices back to back, as uploaded
+        float lodDistances[MESH_LOD_COUNT];                                // Nearest instance of each LOD to the camera
+        LodInstanceRanges mainInstances;
+        LodInstanceRanges shadowInstances;
+    };
+
+    // Where a handle's object currently sits in gameObjects
+    struct Slot {
+        uint32_t denseIndex;
+        uint32_t generation; // Bumped on destroy, invalidating outstanding handles
+    };
+
+    std::vector<GameObject> gameObjects; // Packed, in no particular order
+    std::vector<uint32_t> denseToSlot;   // Slot of each entry of gameObjects
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    TransformStore transforms; // Transforms of gameObjects, at the same indices
+
+    // Brings the spatial index up to date with everything moved since the last sync
+    void SyncSpatialIndex();
+    GameObjectHandle HandleOf(uint32_t slotIndex) const;
+
+    SpatialHash spatialIndex;           // Keyed by slot, which stays put when objects are compacted
+    std::vector<uint32_t> movedObjects; // Slots whose world bounds changed, queued by GameObject
+    std::vector<uint32_t> queryScratch;
+    std::vector<SpatialHash::RayHit> rayHitScratch;
+
+    // FollowTerrainEdits scratch: affected objects, their footprint samples back to back
+    std::vector<GameObjectHandle> affectedObjects;
+    std::vector<GameObject*> snappedObjects;
+    std::vector<size_t> footprintEnds; // End of each snapped object's samples
+    std::vector<vec2> footprintPositions;
+    std::vector<float> footprintHeights;
+    std::vector<InstanceGroup> instanceGroups;
+    std::unordered_map<ObjectLoader*, size_t> instanceGroupIndices;
+
+    // Per-frame culling scratch, indexed like gameObjects
+    FrustumCulling::BoxList worldBounds;
+    std::vector<uint8_t> visibleInMain;
+    std::vector<uint8_t> visibleInShadow;
+    CullingStats cullingStats;
+
+    ScatterLayer scatter;
+
+    // Bounding boxes standing in for objects whose model isn't resident yet
+    PlaceholderMesh placeholderMesh;
+    std::vector<mat4> placeholderSets[INSTANCE_SET_COUNT];
+    std::vector<mat4> placeholderMatrices;
+    GLsizei placeholderMainCount = 0;
+    GLsizei placeholderShadowFirst = 0;
+    GLsizei placeholderShadowCount = 0;
 };
 
 
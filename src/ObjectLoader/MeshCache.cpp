@@ -0,0 +1,409 @@
+#include "MeshCache.h"
+#include "../Core/Hash.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char MAGIC[4] = { 'B', 'S', 'M', 'C' };
+const uint32_t FORMAT_VERSION = 3; // Bump whenever the layout or vertex format changes
+const size_t DATA_ALIGNMENT = 16;
+
+// File layout: FileHeader, SubMeshRecord[subMeshCount], texture path bytes,
+// then the vertex and index data, each aligned to DATA_ALIGNMENT
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t sourceHash;
+    uint64_t selectionHash;
+    uint64_t fileSize;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint32_t vertexStride;
+    uint32_t subMeshCount;
+    uint64_t subMeshOffset;
+    uint64_t stringOffset;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    float boundingBoxMin[3];
+    float boundingBoxMax[3];
+    uint32_t boundingBoxCalculated;
+    uint32_t reserved;
+    float quantizationOffset[3];
+    float quantizationScale[3];
+};
+
+struct SubMeshRecord {
+    uint32_t indexCount[MESH_LOD_COUNT];
+    uint32_t firstIndex[MESH_LOD_COUNT];
+    int32_t baseVertex;
+    uint32_t texturePathOffset; // Relative to FileHeader::stringOffset
+    uint32_t texturePathLength;
+    uint32_t reserved;
+};
+
+static_assert(std::is_trivially_copyable<FileHeader>::value, "FileHeader is written as raw bytes");
+static_assert(std::is_trivially_copyable<SubMeshRecord>::value, "SubMeshRecord is written as raw bytes");
+
+bool HashFile(const std::string& path, uint64_t& hash)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    hash = Hash::FNV_OFFSET;
+    std::vector<char> chunk(1 << 16);
+    while (file) {
+        file.read(chunk.data(), chunk.size());
+        hash = Hash::Fnv1a64(chunk.data(), static_cast<size_t>(file.gcount()), hash);
+    }
+    return true;
+}
+
+uint64_t HashSelection(const std::vector<unsigned int>& meshSelection)
+{
+    uint64_t count = meshSelection.size();
+    uint64_t hash = Hash::Fnv1a64(&count, sizeof(count));
+    return Hash::Fnv1a64(meshSelection.data(), meshSelection.size() * sizeof(unsigned int), hash);
+}
+
+bool SourceStamp(const std::string& path, uint64_t& size, int64_t& mtime)
+{
+    std::error_code ec;
+    size = std::filesystem::file_size(path, ec);
+    if (ec) return false;
+    auto writeTime = std::filesystem::last_write_time(path, ec);
+    if (ec) return false;
+    mtime = static_cast<int64_t>(writeTime.time_since_epoch().count());
+    return true;
+}
+
+// Reads the header of cachePath if it was written by this format for meshSelection
+bool ReadHeader(const std::string& cachePath, const std::vector<unsigned int>& meshSelection, FileHeader& header)
+{
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != FORMAT_VERSION) return false;
+    return header.selectionHash == HashSelection(meshSelection);
+}
+
+uint64_t AlignUp(uint64_t offset)
+{
+    return (offset + DATA_ALIGNMENT - 1) & ~static_cast<uint64_t>(DATA_ALIGNMENT - 1);
+}
+
+// Distinguishes the temporary files of concurrent writes, in this process and others
+std::string UniqueTempSuffix()
+{
+    static std::atomic<unsigned int> counter(0);
+#ifdef _WIN32
+    unsigned long processId = GetCurrentProcessId();
+#else
+    unsigned long processId = static_cast<unsigned long>(getpid());
+#endif
+    return "." + std::to_string(processId) + "-" + std::to_string(counter++) + ".tmp";
+}
+
+} // namespace
+
+std::string MeshCache::cachePathFor(const std::string& sourcePath, const std::vector<unsigned int>& meshSelection)
+{
+    char selection[17];
+    std::snprintf(selection, sizeof(selection), "%016llx", static_cast<unsigned long long>(HashSelection(meshSelection)));
+    return sourcePath + "." + selection + ".meshcache";
+}
+
+CookedMeshView CookedMesh::view() const
+{
+    CookedMeshView meshView;
+    meshView.vertices = vertices.data();
+    meshView.vertexCount = vertices.size();
+    meshView.vertexStride = sizeof(PackedVertex);
+    meshView.indices = indices.data();
+    meshView.indexCount = indices.size();
+    meshView.subMeshes = subMeshes;
+    meshView.boundingBoxMin = boundingBoxMin;
+    meshView.boundingBoxMax = boundingBoxMax;
+    meshView.boundingBoxCalculated = boundingBoxCalculated;
+    meshView.quantization = quantization;
+    return meshView;
+}
+
+MeshCache::MeshCache() : data(nullptr), size(0)
+#ifdef _WIN32
+    , fileHandle(nullptr), mappingHandle(nullptr)
+#endif
+{
+}
+
+MeshCache::~MeshCache()
+{
+    close();
+}
+
+void MeshCache::close()
+{
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle && fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+#else
+    if (data) munmap(const_cast<unsigned char*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+    meshView = CookedMeshView();
+}
+
+bool MeshCache::map(const std::string& cachePath)
+{
+#ifdef _WIN32
+    fileHandle = CreateFileA(cachePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                             OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) return false;
+    size = static_cast<size_t>(fileSize.QuadPart);
+
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mappingHandle) return false;
+    data = static_cast<const unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    return data != nullptr;
+#else
+    int fd = ::open(cachePath.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(st.st_size);
+
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps the file alive
+    if (mapped == MAP_FAILED) {
+        size = 0;
+        return false;
+    }
+    data = static_cast<const unsigned char*>(mapped);
+    return true;
+#endif
+}
+
+bool MeshCache::open(const std::string& cachePath, const std::string& sourcePath, const std::vector<unsigned int>& meshSelection)
+{
+    close();
+
+    FileHeader header;
+    if (!ReadHeader(cachePath, meshSelection, header)) return false;
+
+    uint64_t sourceSize = 0;
+    int64_t sourceMtime = 0;
+    if (!SourceStamp(sourcePath, sourceSize, sourceMtime) || sourceSize != header.sourceSize) return false;
+
+    if (sourceMtime != header.sourceMtime) {
+        // Touched or re-checked-out source: only rebuild if the contents really changed
+        uint64_t sourceHash = 0;
+        if (!HashFile(sourcePath, sourceHash) || sourceHash != header.sourceHash) return false;
+
+        std::fstream file(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+        if (file) {
+            file.seekp(offsetof(FileHeader, sourceMtime));
+            file.write(reinterpret_cast<const char*>(&sourceMtime), sizeof(sourceMtime));
+        }
+    }
+
+    if (!map(cachePath)) {
+        close();
+        return false;
+    }
+
+    // Everything below only reads inside the mapping, so a truncated file is rejected here
+    const uint64_t subMeshBytes = uint64_t(header.subMeshCount) * sizeof(SubMeshRecord);
+    const uint64_t vertexBytes = header.vertexCount * header.vertexStride;
+    const uint64_t indexBytes = header.indexCount * sizeof(unsigned int);
+    if (header.fileSize != size ||
+        header.subMeshOffset + subMeshBytes > header.stringOffset ||
+        header.stringOffset > header.vertexOffset ||
+        header.vertexOffset + vertexBytes > header.indexOffset ||
+        header.indexOffset + indexBytes > size) {
+        std::cerr << "Mesh cache '" << cachePath << "' is corrupt, re-importing" << std::endl;
+        close();
+        return false;
+    }
+
+    const SubMeshRecord* records = reinterpret_cast<const SubMeshRecord*>(data + header.subMeshOffset);
+    const char* strings = reinterpret_cast<const char*>(data + header.stringOffset);
+    const uint64_t stringBytes = header.vertexOffset - header.stringOffset;
+    const unsigned int* indices = reinterpret_cast<const unsigned int*>(data + header.indexOffset);
+
+    meshView.subMeshes.reserve(header.subMeshCount);
+    for (uint32_t i = 0; i < header.subMeshCount; ++i) {
+        const SubMeshRecord& record = records[i];
+        bool valid = uint64_t(record.texturePathOffset) + record.texturePathLength <= stringBytes &&
+                     record.baseVertex >= 0 && uint64_t(record.baseVertex) <= header.vertexCount;
+        for (int lod = 0; lod < MESH_LOD_COUNT; ++lod) {
+            valid = valid && uint64_t(record.firstIndex[lod]) + record.indexCount[lod] <= header.indexCount;
+        }
+        // Every index the LODs draw must land on a vertex, or the GPU fetches past the buffer
+        const uint64_t vertexLimit = valid ? header.vertexCount - record.baseVertex : 0;
+        for (int lod = 0; lod < MESH_LOD_COUNT && valid; ++lod) {
+            if (lod > 0 && record.firstIndex[lod] == record.firstIndex[lod - 1] &&
+                record.indexCount[lod] == record.indexCount[lod - 1]) continue; // Repeated range
+            const unsigned int* lodIndices = indices + record.firstIndex[lod];
+            for (uint32_t j = 0; j < record.indexCount[lod]; ++j) {
+                if (lodIndices[j] >= vertexLimit) {
+                    valid = false;
+                    break;
+                }
+            }
+        }
+        if (!valid) {
+            std::cerr << "Mesh cache '" << cachePath << "' is corrupt, re-importing" << std::endl;
+            close();
+            return false;
+        }
+        CookedSubMesh subMesh;
+        for (int lod = 0; lod < MESH_LOD_COUNT; ++lod) {
+            subMesh.lods[lod].indexCount = static_cast<GLsizei>(record.indexCount[lod]);
+            subMesh.lods[lod].firstIndex = record.firstIndex[lod];
+        }
+        subMesh.baseVertex = record.baseVertex;
+        subMesh.texturePath.assign(strings + record.texturePathOffset, record.texturePathLength);
+        meshView.subMeshes.push_back(subMesh);
+    }
+
+    meshView.vertices = data + header.vertexOffset;
+    meshView.vertexCount = static_cast<size_t>(header.vertexCount);
+    meshView.vertexStride = static_cast<GLsizei>(header.vertexStride);
+    meshView.indices = indices;
+    meshView.indexCount = static_cast<size_t>(header.indexCount);
+    meshView.boundingBoxMin = vec3(header.boundingBoxMin[0], header.boundingBoxMin[1], header.boundingBoxMin[2]);
+    meshView.boundingBoxMax = vec3(header.boundingBoxMax[0], header.boundingBoxMax[1], header.boundingBoxMax[2]);
+    meshView.boundingBoxCalculated = header.boundingBoxCalculated != 0;
+    meshView.quantization.offset = vec3(header.quantizationOffset[0], header.quantizationOffset[1], header.quantizationOffset[2]);
+    meshView.quantization.scale = vec3(header.quantizationScale[0], header.quantizationScale[1], header.quantizationScale[2]);
+    return true;
+}
+
+bool MeshCache::readBounds(const std::string& cachePath, const std::string& sourcePath,
+                           const std::vector<unsigned int>& meshSelection, vec3& boundsMin, vec3& boundsMax)
+{
+    FileHeader header;
+    if (!ReadHeader(cachePath, meshSelection, header) || !header.boundingBoxCalculated) return false;
+
+    // Only the stamp: hashing the source would cost as much as the import this runs ahead of
+    uint64_t sourceSize = 0;
+    int64_t sourceMtime = 0;
+    if (!SourceStamp(sourcePath, sourceSize, sourceMtime) || sourceSize != header.sourceSize ||
+        sourceMtime != header.sourceMtime) return false;
+
+    for (int i = 0; i < 3; ++i) {
+        boundsMin[i] = header.boundingBoxMin[i];
+        boundsMax[i] = header.boundingBoxMax[i];
+    }
+    return true;
+}
+
+bool MeshCache::write(const std::string& cachePath, const std::string& sourcePath,
+                      const std::vector<unsigned int>& meshSelection, const CookedMeshView& mesh)
+{
+    FileHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.selectionHash = HashSelection(meshSelection);
+    if (!SourceStamp(sourcePath, header.sourceSize, header.sourceMtime) || !HashFile(sourcePath, header.sourceHash)) {
+        std::cerr << "Mesh cache: cannot read source '" << sourcePath << "'" << std::endl;
+        return false;
+    }
+
+    // Texture paths go into one string table referenced by offset
+    std::string strings;
+    std::vector<SubMeshRecord> records;
+    records.reserve(mesh.subMeshes.size());
+    for (const CookedSubMesh& subMesh : mesh.subMeshes) {
+        SubMeshRecord record = {};
+        for (int lod = 0; lod < MESH_LOD_COUNT; ++lod) {
+            record.indexCount[lod] = static_cast<uint32_t>(subMesh.lods[lod].indexCount);
+            record.firstIndex[lod] = subMesh.lods[lod].firstIndex;
+        }
+        record.baseVertex = subMesh.baseVertex;
+        record.texturePathOffset = static_cast<uint32_t>(strings.size());
+        record.texturePathLength = static_cast<uint32_t>(subMesh.texturePath.size());
+        strings += subMesh.texturePath;
+        records.push_back(record);
+    }
+
+    header.vertexCount = mesh.vertexCount;
+    header.indexCount = mesh.indexCount;
+    header.vertexStride = static_cast<uint32_t>(mesh.vertexStride);
+    header.subMeshCount = static_cast<uint32_t>(records.size());
+    header.subMeshOffset = sizeof(FileHeader);
+    header.stringOffset = header.subMeshOffset + records.size() * sizeof(SubMeshRecord);
+    header.vertexOffset = AlignUp(header.stringOffset + strings.size());
+    header.indexOffset = AlignUp(header.vertexOffset + header.vertexCount * header.vertexStride);
+    header.fileSize = header.indexOffset + header.indexCount * sizeof(unsigned int);
+    for (int i = 0; i < 3; ++i) {
+        header.boundingBoxMin[i] = mesh.boundingBoxMin[i];
+        header.boundingBoxMax[i] = mesh.boundingBoxMax[i];
+        header.quantizationOffset[i] = mesh.quantization.offset[i];
+        header.quantizationScale[i] = mesh.quantization.scale[i];
+    }
+    header.boundingBoxCalculated = mesh.boundingBoxCalculated ? 1 : 0;
+
+    // Write to a temporary file and rename, so a crash never leaves a half-written cache.
+    // Each write has its own temporary file: two loads of one model may write at once.
+    const std::string tempPath = cachePath + UniqueTempSuffix();
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "Mesh cache: cannot write '" << tempPath << "'" << std::endl;
+            return false;
+        }
+        const char padding[DATA_ALIGNMENT] = {};
+        auto padTo = [&](uint64_t offset) {
+            file.write(padding, static_cast<std::streamsize>(offset - static_cast<uint64_t>(file.tellp())));
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(SubMeshRecord));
+        file.write(strings.data(), strings.size());
+        padTo(header.vertexOffset);
+        file.write(static_cast<const char*>(mesh.vertices), header.vertexCount * header.vertexStride);
+        padTo(header.indexOffset);
+        file.write(reinterpret_cast<const char*>(mesh.indices), header.indexCount * sizeof(unsigned int));
+        if (!file) {
+            std::cerr << "Mesh cache: failed writing '" << tempPath << "'" << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, cachePath, ec);
+    if (ec) {
+        std::cerr << "Mesh cache: cannot replace '" << cachePath << "': " << ec.message() << std::endl;
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,94 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "Angel.h"
+#include "PackedVertex.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Levels of detail cooked per mesh; LOD 0 is the full-detail mesh
+const int MESH_LOD_COUNT = 4;
+
+// Index range of one LOD; all LODs of a mesh share its vertices
+struct CookedLod {
+    GLsizei indexCount;
+    GLuint firstIndex;          // Into the model's index buffer
+};
+
+// One aiMesh inside a cooked model
+struct CookedSubMesh {
+    CookedLod lods[MESH_LOD_COUNT]; // A LOD that couldn't be reduced further repeats the previous range
+    GLint baseVertex;           // Into the model's vertex buffer
+    std::string texturePath;    // Diffuse texture as referenced by the material ("" for none)
+};
+
+// Interleaved vertices and indices ready for glBufferData, pointing either into
+// a freshly imported CookedMesh or straight into a mapped cache file
+struct CookedMeshView {
+    const void* vertices = nullptr;
+    size_t vertexCount = 0;
+    GLsizei vertexStride = 0;   // Bytes per vertex
+    const unsigned int* indices = nullptr;
+    size_t indexCount = 0;
+    std::vector<CookedSubMesh> subMeshes;
+    vec3 boundingBoxMin;
+    vec3 boundingBoxMax;
+    bool boundingBoxCalculated = false;
+    VertexQuantization quantization; // Decodes PackedVertex positions
+};
+
+// Model data produced by the Assimp import
+struct CookedMesh {
+    std::vector<PackedVertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<CookedSubMesh> subMeshes;
+    vec3 boundingBoxMin;
+    vec3 boundingBoxMax;
+    bool boundingBoxCalculated = false;
+    VertexQuantization quantization;
+
+    CookedMeshView view() const;
+};
+
+// Binary cache of cooked models so warm starts skip Assimp.
+// A cache file is only used if it was written for the same source file (same size and
+// mtime, or same content hash if only the mtime changed) and the same mesh selection.
+// Valid files are memory-mapped and their vertex/index data handed to GL as is.
+class MeshCache {
+public:
+    MeshCache();
+    ~MeshCache();
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+
+    // Maps cachePath if it is up to date; returns false (and maps nothing) otherwise
+    bool open(const std::string& cachePath, const std::string& sourcePath, const std::vector<unsigned int>& meshSelection);
+    void close();
+    const CookedMeshView& view() const { return meshView; }
+
+    // Just the bounding box of an up-to-date cache file, from its header (without mapping
+    // it or hashing the source): enough to size a placeholder before the model loads
+    static bool readBounds(const std::string& cachePath, const std::string& sourcePath,
+                           const std::vector<unsigned int>& meshSelection, vec3& boundsMin, vec3& boundsMax);
+
+    static bool write(const std::string& cachePath, const std::string& sourcePath,
+                      const std::vector<unsigned int>& meshSelection, const CookedMeshView& mesh);
+
+    // Cache files live next to their source model, one per mesh selection, so configs
+    // picking different meshes of one file don't overwrite each other's cache
+    static std::string cachePathFor(const std::string& sourcePath, const std::vector<unsigned int>& meshSelection);
+
+private:
+    bool map(const std::string& cachePath);
+
+    const unsigned char* data;
+    size_t size;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+    CookedMeshView meshView;
+};
+
+#endif // MESH_CACHE_H
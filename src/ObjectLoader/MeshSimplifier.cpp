@@ -0,0 +1,219 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+namespace {
+
+// Symmetric 4x4 matrix of the plane equations around a vertex; evaluate(p) is the
+// (area-weighted) sum of squared distances from p to those planes
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0;
+    double b2 = 0, bc = 0, bd = 0;
+    double c2 = 0, cd = 0;
+    double d2 = 0;
+
+    static Quadric fromPlane(double a, double b, double c, double d, double weight) {
+        Quadric q;
+        q.a2 = weight * a * a; q.ab = weight * a * b; q.ac = weight * a * c; q.ad = weight * a * d;
+        q.b2 = weight * b * b; q.bc = weight * b * c; q.bd = weight * b * d;
+        q.c2 = weight * c * c; q.cd = weight * c * d;
+        q.d2 = weight * d * d;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& o) {
+        a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+        b2 += o.b2; bc += o.bc; bd += o.bd;
+        c2 += o.c2; cd += o.cd;
+        d2 += o.d2;
+        return *this;
+    }
+
+    double evaluate(const vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+             + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+             + c2 * z * z + 2 * cd * z
+             + d2;
+    }
+};
+
+struct Collapse {
+    double cost;
+    unsigned int from;
+    unsigned int to;
+};
+
+uint64_t edgeKey(unsigned int a, unsigned int b) {
+    if (a > b) std::swap(a, b);
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+vec3 triangleNormal(const vec3& p0, const vec3& p1, const vec3& p2) {
+    return cross(p1 - p0, p2 - p0); // Unnormalized: length is twice the area
+}
+
+} // namespace
+
+std::vector<unsigned int> simplifyMesh(const std::vector<vec3>& positions,
+                                       const std::vector<unsigned int>& indices,
+                                       size_t targetIndexCount) {
+    std::vector<unsigned int> result = indices;
+    const size_t vertexCount = positions.size();
+    if (result.size() <= targetIndexCount || vertexCount == 0) return result;
+
+    // Quadrics come from the original surface and accumulate as vertices merge
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i + 2 < result.size(); i += 3) {
+        const vec3& p0 = positions[result[i]];
+        const vec3& p1 = positions[result[i + 1]];
+        const vec3& p2 = positions[result[i + 2]];
+        vec3 n = triangleNormal(p0, p1, p2);
+        double area2 = std::sqrt(double(n.x) * n.x + double(n.y) * n.y + double(n.z) * n.z);
+        if (area2 <= 0.0) continue;
+        double a = n.x / area2, b = n.y / area2, c = n.z / area2;
+        double d = -(a * p0.x + b * p0.y + c * p0.z);
+        Quadric q = Quadric::fromPlane(a, b, c, d, area2 * 0.5);
+        for (int k = 0; k < 3; ++k) quadrics[result[i + k]] += q;
+    }
+
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<unsigned int> triangleOffsets(vertexCount + 1);
+    std::vector<unsigned int> vertexTriangles;
+    std::vector<char> locked(vertexCount);
+    std::vector<char> touched(vertexCount);
+    std::unordered_map<uint64_t, unsigned int> edgeUses;
+    std::vector<Collapse> collapses;
+    std::vector<unsigned int> fromNeighbours, toNeighbours;
+
+    // Each pass collapses a batch of independent edges in cost order, then compacts
+    const int MAX_PASSES = 64;
+    for (int pass = 0; pass < MAX_PASSES && result.size() > targetIndexCount; ++pass) {
+        const size_t triangleCount = result.size() / 3;
+
+        // Vertex -> triangle adjacency
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0u);
+        for (unsigned int index : result) ++triangleOffsets[index + 1];
+        for (size_t v = 0; v < vertexCount; ++v) triangleOffsets[v + 1] += triangleOffsets[v];
+        vertexTriangles.resize(result.size());
+        {
+            std::vector<unsigned int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); ++i) vertexTriangles[fill[result[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        // Edges used by one triangle are borders (or seams), more than two are non-manifold:
+        // vertices on either stay put
+        edgeUses.clear();
+        edgeUses.reserve(result.size());
+        for (size_t t = 0; t < triangleCount; ++t) {
+            for (int k = 0; k < 3; ++k) {
+                ++edgeUses[edgeKey(result[t * 3 + k], result[t * 3 + (k + 1) % 3])];
+            }
+        }
+        std::fill(locked.begin(), locked.end(), 0);
+        for (const auto& edge : edgeUses) {
+            if (edge.second != 2) {
+                locked[edge.first >> 32] = 1;
+                locked[edge.first & 0xFFFFFFFFu] = 1;
+            }
+        }
+
+        // Cheapest direction of every collapsible edge
+        collapses.clear();
+        for (const auto& edge : edgeUses) {
+            unsigned int a = static_cast<unsigned int>(edge.first >> 32);
+            unsigned int b = static_cast<unsigned int>(edge.first & 0xFFFFFFFFu);
+            if (locked[a] && locked[b]) continue;
+            Quadric q = quadrics[a];
+            q += quadrics[b];
+            double costAB = locked[a] ? HUGE_VAL : q.evaluate(positions[b]);
+            double costBA = locked[b] ? HUGE_VAL : q.evaluate(positions[a]);
+            if (costAB <= costBA) collapses.push_back({ costAB, a, b });
+            else collapses.push_back({ costBA, b, a });
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+        auto collectNeighbours = [&](unsigned int v, std::vector<unsigned int>& out) {
+            out.clear();
+            for (unsigned int i = triangleOffsets[v]; i < triangleOffsets[v + 1]; ++i) {
+                unsigned int t = vertexTriangles[i];
+                for (int k = 0; k < 3; ++k) {
+                    if (result[t * 3 + k] != v) out.push_back(result[t * 3 + k]);
+                }
+            }
+            std::sort(out.begin(), out.end());
+            out.erase(std::unique(out.begin(), out.end()), out.end());
+        };
+
+        for (size_t v = 0; v < vertexCount; ++v) remap[v] = static_cast<unsigned int>(v);
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t remainingTriangles = triangleCount;
+        bool collapsedAny = false;
+
+        for (const Collapse& collapse : collapses) {
+            if (remainingTriangles * 3 <= targetIndexCount) break;
+            const unsigned int from = collapse.from;
+            const unsigned int to = collapse.to;
+            if (touched[from] || touched[to]) continue;
+
+            // Link condition: an interior edge may only share its two opposite vertices,
+            // otherwise the collapse pinches the surface
+            collectNeighbours(from, fromNeighbours);
+            collectNeighbours(to, toNeighbours);
+            size_t shared = 0;
+            for (unsigned int n : fromNeighbours) {
+                if (std::binary_search(toNeighbours.begin(), toNeighbours.end(), n)) ++shared;
+            }
+            if (shared != 2) continue;
+
+            // Reject if any triangle that survives the collapse would flip
+            bool flips = false;
+            size_t removed = 0;
+            for (unsigned int i = triangleOffsets[from]; i < triangleOffsets[from + 1] && !flips; ++i) {
+                const unsigned int* tri = &result[vertexTriangles[i] * 3];
+                if (tri[0] == to || tri[1] == to || tri[2] == to) {
+                    ++removed;
+                    continue;
+                }
+                vec3 before[3], after[3];
+                for (int k = 0; k < 3; ++k) {
+                    before[k] = positions[tri[k]];
+                    after[k] = tri[k] == from ? positions[to] : positions[tri[k]];
+                }
+                vec3 n0 = triangleNormal(before[0], before[1], before[2]);
+                vec3 n1 = triangleNormal(after[0], after[1], after[2]);
+                // Also refuse turns past ~75 degrees: slivers that don't flip yet tend to later
+                float d = dot(n0, n1);
+                flips = d <= 0.0f || d * d < 0.0625f * dot(n0, n0) * dot(n1, n1);
+            }
+            if (flips) continue;
+
+            remap[from] = to;
+            quadrics[to] += quadrics[from];
+            // Triangles around both ends changed; leave their vertices for the next pass
+            touched[from] = touched[to] = 1;
+            for (unsigned int n : fromNeighbours) touched[n] = 1;
+            remainingTriangles -= removed;
+            collapsedAny = true;
+        }
+        if (!collapsedAny) break;
+
+        // Apply the collapses and drop the triangles that became degenerate
+        size_t write = 0;
+        for (size_t t = 0; t < triangleCount; ++t) {
+            unsigned int i0 = remap[result[t * 3]];
+            unsigned int i1 = remap[result[t * 3 + 1]];
+            unsigned int i2 = remap[result[t * 3 + 2]];
+            if (i0 == i1 || i1 == i2 || i0 == i2) continue;
+            result[write++] = i0;
+            result[write++] = i1;
+            result[write++] = i2;
+        }
+        result.resize(write);
+    }
+
+    return result;
+}
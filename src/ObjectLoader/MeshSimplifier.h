@@ -0,0 +1,18 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include "Angel.h"
+#include <vector>
+
+// Quadric error metric edge collapse (Garland & Heckbert) for building LODs at import time.
+// Vertices are only ever collapsed onto a neighbour, never moved, so every LOD is a new
+// index list over the original vertex buffer. Vertices on open borders and UV/normal
+// seams (which are borders once identical vertices are joined) are kept in place.
+//
+// Returns at most targetIndexCount indices if the mesh can be reduced that far without
+// folding triangles over or making edges non-manifold; otherwise as few as it could.
+std::vector<unsigned int> simplifyMesh(const std::vector<vec3>& positions,
+                                       const std::vector<unsigned int>& indices,
+                                       size_t targetIndexCount);
+
+#endif // MESH_SIMPLIFIER_H
@@ -1,12 +1,71 @@
 #include "ObjectLoader.h"
-#include "../../include/stb/stb_image.h"
 #include <iostream>
 #include <algorithm>
+#include <unordered_map>
 #include "../Core/Shader.h"
+#include "MeshCache.h"
+#include "MeshSimplifier.h"
+#include "../Core/TextureCache.h"
+#include "../Core/AssetLoader.h"
+#include "../Core/GLStateCache.h"
+
+namespace {
+// Share of LOD 0's triangles each LOD aims for
+const float LOD_TRIANGLE_RATIOS[MESH_LOD_COUNT] = { 1.0f, 0.5f, 0.25f, 0.125f };
+// Meshes smaller than this are cheap enough to draw at full detail everywhere
+const size_t MIN_LOD_TRIANGLES = 64;
+// Projected bounding-sphere diameter (pixels) below which LOD i hands over to LOD i + 1
+const float LOD_SCREEN_SIZES[MESH_LOD_COUNT - 1] = { 240.0f, 100.0f, 40.0f };
+// Margin around each threshold so objects sitting on one don't switch every frame
+const float LOD_HYSTERESIS = 0.15f;
+}
+
+ObjectRenderUniforms::ObjectRenderUniforms(const Shader& shader) {
+    instanced = shader.getUniformHandle<bool>("u_instanced");
+    isTerrain = shader.getUniformHandle<bool>("u_isTerrain");
+    objectTexture = shader.getUniformHandle<int>("objectTexture");
+    packedVertex = shader.getUniformHandle<bool>("u_packedVertex");
+    positionOffset = shader.getUniformHandle<vec3>("u_positionOffset");
+    positionScale = shader.getUniformHandle<vec3>("u_positionScale");
+    scatter = shader.getUniformHandle<bool>("u_scatter");
+    scatterMaxScale = shader.getUniformHandle<float>("u_scatterMaxScale");
+    modelMatrix = shader.getUniformHandle<mat4>("gModelMatrix");
+    textureArray = shader.getUniformHandle<bool>("u_textureArray");
+    objectTextureArray = shader.getUniformHandle<int>("objectTextureArray");
+}
+
+void ObjectRenderUniforms::setObjectState(const Shader& program, const VertexQuantization& quantization,
+                                          bool scatterInstances, bool arrayTextures) const {
+    program.setUniform(isTerrain, false);
+    program.setUniform(instanced, true);
+    program.setUniform(packedVertex, true);
+    program.setUniform(scatter, scatterInstances);
+    program.setUniform(positionOffset, quantization.offset);
+    program.setUniform(positionScale, quantization.scale);
+    program.setUniform(objectTexture, static_cast<int>(RenderQueue::MATERIAL_TEXTURE_UNIT));
+    program.setUniform(textureArray, arrayTextures);
+    program.setUniform(objectTextureArray, static_cast<int>(RenderQueue::MATERIAL_ARRAY_UNIT));
+}
+
+int ObjectLoader::selectLod(float screenSize, int currentLod) {
+    int lod = std::min(std::max(currentLod, 0), MESH_LOD_COUNT - 1);
+    while (lod > 0 && screenSize > LOD_SCREEN_SIZES[lod - 1] * (1.0f + LOD_HYSTERESIS)) --lod;
+    while (lod < MESH_LOD_COUNT - 1 && screenSize < LOD_SCREEN_SIZES[lod] * (1.0f - LOD_HYSTERESIS)) ++lod;
+    return lod;
+}
 
 // Constructor
 ObjectLoader::ObjectLoader(Shader& shaderProgram) {
     createDefaultWhiteTexture();
+    vao = vbo = ebo = 0;
+    instanceVBO = 0;
+    instanceCount = 0;
+    instanceCapacity = 0;
+    instanceAttributeBase = 0;
+    scatterAttributes = false;
+    useTextureArrays = false;
+    texturesInArrays = false;
+    loadState = LoadState::Unloaded;
     boundingBoxCalculated = false;
     boundingBoxMin = vec3(0.0f);
     boundingBoxMax = vec3(0.0f);
@@ -15,41 +74,142 @@ ObjectLoader::ObjectLoader(Shader& shaderProgram) {
 // Destructor
 ObjectLoader::~ObjectLoader() {
     cleanup();
+    GLStateCache::GetInstance().DeleteTexture(defaultWhiteTextureID);
 }
 
 void ObjectLoader::cleanup() {
-    for (GLuint vao : vaos) glDeleteVertexArrays(1, &vao);
-    for (GLuint vbo : vbos) glDeleteBuffers(1, &vbo);
-    for (GLuint ebo : ebos) glDeleteBuffers(1, &ebo);
-    for (GLuint texID : meshTextureIDs) glDeleteTextures(1, &texID);
-    if (defaultWhiteTextureID != 0) glDeleteTextures(1, &defaultWhiteTextureID);
-
-    vaos.clear();
-    vbos.clear();
-    ebos.clear();
-    indexCounts.clear();
-    meshTextureIDs.clear();
+    // The default white texture outlives reloads; only per-model resources go here
+    GLStateCache::GetInstance().DeleteVertexArray(vao);
+    if (vbo != 0) glDeleteBuffers(1, &vbo);
+    if (ebo != 0) glDeleteBuffers(1, &ebo);
+    if (instanceVBO != 0) glDeleteBuffers(1, &instanceVBO);
+
+    vao = vbo = ebo = 0;
+    subMeshes.clear();
+    textures.clear(); // The cache frees textures no other model or UI element uses
+    textureLayers.clear();
+    texturesInArrays = false;
+    instanceVBO = 0;
+    instanceCount = 0;
+    instanceCapacity = 0;
 }
 
 void ObjectLoader::createDefaultWhiteTexture() {
     glGenTextures(1, &defaultWhiteTextureID);
-    glBindTexture(GL_TEXTURE_2D, defaultWhiteTextureID);
+    GLStateCache::GetInstance().BindTexture(GL_TEXTURE_2D, defaultWhiteTextureID);
     unsigned char whitePixel[] = {255, 255, 255, 255}; // RGBA
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, whitePixel);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glBindTexture(GL_TEXTURE_2D, 0); // Unbind after configuration
-    
+
     std::cout << "Created default white texture with ID: " << defaultWhiteTextureID << std::endl;
 }
 
+struct ObjectLoader::PendingLoad {
+    std::string filename;
+    MeshCache cache;            // Mapped cache file when it was up to date
+    CookedMesh cooked;          // Fresh import otherwise
+    CookedMeshView meshView;    // Points into one of the two above
+    std::unordered_map<std::string, TextureCache::Prepared> textures; // By texture path as referenced by the material
+    bool textureArrays = false;  // Whether the textures went to arrayTextures instead
+    std::unordered_map<std::string, TextureArrayCache::Prepared> arrayTextures;
+};
+
 bool ObjectLoader::load(const std::string& filename, const std::vector<unsigned int>& specificMeshesToLoad) {
+    bool loaded = prepareLoad(filename, specificMeshesToLoad) && finishLoad();
+    loadState = loaded ? LoadState::Resident : LoadState::Failed;
+    return loaded;
+}
+
+void ObjectLoader::loadAsync(AssetLoader& loader, const std::string& filename, const std::vector<unsigned int>& specificMeshesToLoad) {
+    if (loadState != LoadState::Unloaded) return;
+    loadState = LoadState::Loading;
+
+    // A model cooked on an earlier run has its box in the cache header, so its placeholder
+    // gets the right size right away instead of the 1x1x1 default
+    if (!boundingBoxCalculated &&
+        MeshCache::readBounds(MeshCache::cachePathFor(filename, specificMeshesToLoad), filename,
+                              specificMeshesToLoad, boundingBoxMin, boundingBoxMax)) {
+        boundingBoxCalculated = true;
+    }
+
+    // The loader must be drained or destroyed before this ObjectLoader is deleted
+    loader.Submit([this, filename, specificMeshesToLoad]() -> AssetLoader::GLTask {
+        bool prepared = prepareLoad(filename, specificMeshesToLoad);
+        return [this, prepared, filename]() {
+            loadState = (prepared && finishLoad()) ? LoadState::Resident : LoadState::Failed;
+            if (loadState == LoadState::Failed) {
+                std::cerr << "Failed to load model '" << filename << "'" << std::endl;
+            }
+        };
+    });
+}
+
+bool ObjectLoader::prepareLoad(const std::string& filename, const std::vector<unsigned int>& specificMeshesToLoad) {
+    auto pending = std::make_unique<PendingLoad>();
+    pending->filename = filename;
+
+    // Warm start: map the cooked model so finishLoad hands its buffers straight to GL
+    const std::string cachePath = MeshCache::cachePathFor(filename, specificMeshesToLoad);
+    if (pending->cache.open(cachePath, filename, specificMeshesToLoad) &&
+        pending->cache.view().vertexStride == static_cast<GLsizei>(sizeof(PackedVertex))) {
+        std::cout << "Loaded '" << filename << "' from mesh cache" << std::endl;
+        pending->meshView = pending->cache.view();
+    } else {
+        pending->cache.close();
+        if (!importMesh(filename, specificMeshesToLoad, pending->cooked)) {
+            return false;
+        }
+        pending->meshView = pending->cooked.view();
+        if (!MeshCache::write(cachePath, filename, specificMeshesToLoad, pending->meshView)) {
+            std::cerr << "Could not write mesh cache for '" << filename << "', next start will re-import" << std::endl;
+        }
+    }
+
+    std::string modelDir = "";
+    size_t lastSlash = filename.find_last_of("/");
+    if (lastSlash != std::string::npos) {
+        modelDir = filename.substr(0, lastSlash + 1);
+    }
+
+    // Look up or decode each referenced texture once; failures fall back to white
+    pending->textureArrays = useTextureArrays;
+    for (const CookedSubMesh& subMesh : pending->meshView.subMeshes) {
+        if (subMesh.texturePath.empty() || pending->textures.count(subMesh.texturePath) ||
+            pending->arrayTextures.count(subMesh.texturePath)) continue;
+
+        std::string fullTexPath = modelDir + subMesh.texturePath;
+        std::cout <<  "reading texture from" << fullTexPath << std::endl;
+        if (pending->textureArrays) {
+            // Resampled into its size class here, off the context thread
+            pending->arrayTextures[subMesh.texturePath] = TextureArrayCache::getInstance().prepare(fullTexPath);
+        } else {
+            pending->textures[subMesh.texturePath] = TextureCache::getInstance().prepare(fullTexPath, true);
+        }
+    }
+
+    pendingLoad = std::move(pending);
+    return true;
+}
+
+bool ObjectLoader::finishLoad() {
+    if (!pendingLoad) {
+        return false;
+    }
     cleanup();
+    uploadMesh(*pendingLoad);
+    pendingLoad.reset(); // Unmaps the cache file and frees the decoded pixels
+    return true;
+}
+
+bool ObjectLoader::importMesh(const std::string& filename, const std::vector<unsigned int>& specificMeshesToLoad, CookedMesh& cooked) {
     Assimp::Importer importer;
+    // Joining identical vertices gives the LOD simplifier connected topology to collapse;
+    // formats like OBJ otherwise come in as one vertex per face corner
     const aiScene* scene = importer.ReadFile(filename,
-        aiProcess_Triangulate | aiProcess_GenNormals);
+        aiProcess_Triangulate | aiProcess_GenNormals | aiProcess_JoinIdenticalVertices);
 
     if (!scene || !scene->HasMeshes()) {
         std::cerr << "Assimp load error for '" << filename << "': " << importer.GetErrorString() << std::endl;
@@ -63,163 +223,361 @@ bool ObjectLoader::load(const std::string& filename, const std::vector<unsigned
         }
     }
 
+    // Group meshes by material so those sharing a texture sit together in the buffers
+    std::stable_sort(meshesToLoadIndices.begin(), meshesToLoadIndices.end(),
+        [scene](unsigned int a, unsigned int b) {
+            if (a >= scene->mNumMeshes || b >= scene->mNumMeshes) return a < b;
+            return scene->mMeshes[a]->mMaterialIndex < scene->mMeshes[b]->mMaterialIndex;
+        });
+
+    // Positions are quantized against the box of everything that gets packed, so
+    // it has to be known before the vertices are written
+    calculateBoundingBox(scene, meshesToLoadIndices, cooked);
+    if (cooked.boundingBoxCalculated) {
+        cooked.quantization = VertexQuantization::fromBounds(cooked.boundingBoxMin, cooked.boundingBoxMax);
+    }
+
+    // All meshes are packed into one vertex and one index buffer; each keeps its
+    // own 0-based indices and is drawn with its base vertex
+    std::vector<PackedVertex>& vertices = cooked.vertices;
+    std::vector<unsigned int>& indices = cooked.indices;
+
     for (unsigned int targetMeshIdx : meshesToLoadIndices) {
         if (targetMeshIdx >= scene->mNumMeshes) continue;
         
         aiMesh* mesh = scene->mMeshes[targetMeshIdx];
-        std::vector<vec4> positions;
-        std::vector<vec3> normals;
-        std::vector<vec2> texCoords;
-        std::vector<unsigned int> indices;
-        GLuint currentMeshTextureID = 0; // Start with 0, will use defaultWhiteTextureID if no texture is loaded
-
-        if (scene->HasMaterials() && mesh->mMaterialIndex >= 0) {
-            aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+
+        CookedSubMesh subMesh;
+        subMesh.baseVertex = static_cast<GLint>(vertices.size());
+
+        // Texture paths are stored as the material references them and resolved at upload
+        if (scene->HasMaterials() && mesh->mMaterialIndex < scene->mNumMaterials) {
             aiString texturePath;
-            if (material->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == AI_SUCCESS) {
-                std::string modelDir = "";
-                size_t lastSlash = filename.find_last_of("/");
-                if (lastSlash != std::string::npos) {
-                    modelDir = filename.substr(0, lastSlash + 1);
-                }
-                std::string fullTexPath = modelDir + texturePath.C_Str();
-                std::cout <<  "reading texture from" << fullTexPath << std::endl;
-
-                int texWidth, texHeight, texChannels;
-                unsigned char *data = stbi_load(fullTexPath.c_str(), &texWidth, &texHeight, &texChannels, 0);
-                if (data) {
-                    GLuint textureID;
-                    glGenTextures(1, &textureID);
-                    glBindTexture(GL_TEXTURE_2D, textureID);
-                    GLenum format = (texChannels == 4) ? GL_RGBA : GL_RGB;
-                    glTexImage2D(GL_TEXTURE_2D, 0, format, texWidth, texHeight, 0, format, GL_UNSIGNED_BYTE, data);
-                    glGenerateMipmap(GL_TEXTURE_2D);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                    stbi_image_free(data);
-                    glBindTexture(GL_TEXTURE_2D, 0);
-                    currentMeshTextureID = textureID;
-                } else {
-                    std::cerr << "Failed to load texture: " << fullTexPath << " - " << stbi_failure_reason() << std::endl;
-                }
+            if (scene->mMaterials[mesh->mMaterialIndex]->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == AI_SUCCESS) {
+                subMesh.texturePath = texturePath.C_Str();
             }
         }
 
-        // Vertex data
+        // Vertex data (the old constant white vertex color is gone: no shader read it)
+        vertices.reserve(vertices.size() + mesh->mNumVertices);
+        std::vector<vec3> positions(mesh->mNumVertices);
         for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
             aiVector3D p = mesh->mVertices[i];
-            positions.push_back(vec4(p.x, p.y, p.z,1.0f));
+            positions[i] = vec3(p.x, p.y, p.z);
             aiVector3D n = mesh->HasNormals() ? mesh->mNormals[i] : aiVector3D(0, 1, 0);
-            normals.push_back(vec3(n.x, n.y, n.z));
-            texCoords.push_back(mesh->HasTextureCoords(0) ? vec2(mesh->mTextureCoords[0][i].x, 
-                mesh->mTextureCoords[0][i].y) : vec2(0.0f, 0.0f));
+            vec2 uv = mesh->HasTextureCoords(0) ? vec2(mesh->mTextureCoords[0][i].x,
+                mesh->mTextureCoords[0][i].y) : vec2(0.0f, 0.0f);
+            vertices.push_back(packVertex(positions[i], vec3(n.x, n.y, n.z), uv, cooked.quantization));
         }
 
-        // Indices
+        // Indices (LOD 0)
+        subMesh.lods[0].firstIndex = static_cast<GLuint>(indices.size());
+        std::vector<unsigned int> triangles;
         for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
             for (unsigned int j = 0; j < mesh->mFaces[i].mNumIndices; ++j)
                 indices.push_back(mesh->mFaces[i].mIndices[j]);
+            if (mesh->mFaces[i].mNumIndices == 3) {
+                triangles.insert(triangles.end(), mesh->mFaces[i].mIndices, mesh->mFaces[i].mIndices + 3);
+            }
         }
+        subMesh.lods[0].indexCount = static_cast<GLsizei>(indices.size() - subMesh.lods[0].firstIndex);
+
+        // Coarser LODs, each simplified from the full mesh so errors don't compound
+        for (int lod = 1; lod < MESH_LOD_COUNT; ++lod) {
+            const CookedLod& previous = subMesh.lods[lod - 1];
+            subMesh.lods[lod] = previous;
+            if (triangles.size() / 3 < MIN_LOD_TRIANGLES) continue;
 
-        std::vector<float> interleaved;
-        for (size_t i = 0; i < positions.size(); ++i) {
-            interleaved.insert(interleaved.end(), {
-                positions[i].x, positions[i].y, positions[i].z, 1.0f,
-                texCoords[i].x, texCoords[i].y,
-                normals[i].x, normals[i].y, normals[i].z,
-                1.0f, 1.0f, 1.0f, 1.0f // Default white color
-            });
+            size_t targetIndexCount = static_cast<size_t>(triangles.size() / 3 * LOD_TRIANGLE_RATIOS[lod]) * 3;
+            std::vector<unsigned int> lodIndices = simplifyMesh(positions, triangles, targetIndexCount);
+            // Only worth a level if it is clearly cheaper than the previous one
+            if (lodIndices.empty() || lodIndices.size() * 10 > static_cast<size_t>(previous.indexCount) * 9) continue;
+
+            subMesh.lods[lod].firstIndex = static_cast<GLuint>(indices.size());
+            subMesh.lods[lod].indexCount = static_cast<GLsizei>(lodIndices.size());
+            indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
         }
 
-        GLuint vao, vbo, ebo;
-        glGenVertexArrays(1, &vao);
-        glGenBuffers(1, &vbo);
-        glGenBuffers(1, &ebo);
+        if (subMesh.lods[0].indexCount > 0) {
+            cooked.subMeshes.push_back(subMesh);
+        }
+    }
 
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, interleaved.size() * sizeof(float), interleaved.data(), GL_STATIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    return true;
+}
 
-        GLsizei stride = sizeof(float) * (4 + 2 + 3 + 4);
+void ObjectLoader::uploadMesh(PendingLoad& pending) {
+    const CookedMeshView& meshView = pending.meshView;
 
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (void*)0);
-        
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 4));
-        
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 6));
-        
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 9));
+    // Textures were prepared by prepareLoad; ones other models already use are shared
+    std::unordered_map<std::string, GLuint> texturesByPath;
+    for (auto& texture : pending.textures) {
+        std::shared_ptr<Texture> acquired = TextureCache::getInstance().acquire(texture.second);
+        if (!acquired) {
+            std::cerr << "Failed to load texture: " << texture.second.canonicalPath << std::endl;
+            texturesByPath[texture.first] = 0;
+            continue;
+        }
+        texturesByPath[texture.first] = acquired->GetTextureID();
+        textures.push_back(acquired);
+    }
 
-        glBindVertexArray(0);
+    // Or layers of the texture arrays, with a white layer standing in for missing textures.
+    // Without even that one (its class is at GL's layer limit) the model is drawn plain white.
+    std::unordered_map<std::string, std::shared_ptr<TextureArrayCache::Layer>> layersByPath;
+    std::shared_ptr<TextureArrayCache::Layer> whiteLayer;
+    if (pending.textureArrays) {
+        whiteLayer = TextureArrayCache::getInstance().acquireWhite();
+        for (auto& texture : pending.arrayTextures) {
+            std::shared_ptr<TextureArrayCache::Layer> layer = TextureArrayCache::getInstance().acquire(texture.second);
+            if (!layer) {
+                std::cerr << "Failed to load texture: " << texture.second.canonicalPath << std::endl;
+                continue;
+            }
+            layersByPath[texture.first] = layer;
+        }
+    }
+    texturesInArrays = whiteLayer != nullptr;
+    if (texturesInArrays) {
+        for (auto& layer : layersByPath) textureLayers.push_back(layer.second);
+        textureLayers.push_back(whiteLayer);
+    }
+    std::vector<GLint> layerIndices; // Per sub-mesh, written into its vertices below
 
-        vaos.push_back(vao);
-        vbos.push_back(vbo);
-        ebos.push_back(ebo);
-        indexCounts.push_back(indices.size());
-        
+    for (const CookedSubMesh& cookedSubMesh : meshView.subMeshes) {
+        auto texIt = texturesByPath.find(cookedSubMesh.texturePath);
+        GLuint textureID = texIt != texturesByPath.end() ? texIt->second : 0;
+
+        SubMesh subMesh;
+        for (int lod = 0; lod < MESH_LOD_COUNT; ++lod) {
+            subMesh.indexCount[lod] = cookedSubMesh.lods[lod].indexCount;
+            subMesh.indexOffset[lod] = cookedSubMesh.lods[lod].firstIndex * sizeof(unsigned int);
+        }
+        subMesh.baseVertex = cookedSubMesh.baseVertex;
         // Use defaultWhiteTextureID if no texture was loaded for this mesh
-        if (currentMeshTextureID == 0) {
-            currentMeshTextureID = defaultWhiteTextureID;
+        subMesh.textureID = textureID != 0 ? textureID : defaultWhiteTextureID;
+        subMesh.arrayClass = -1;
+        if (texturesInArrays) {
+            auto layerIt = layersByPath.find(cookedSubMesh.texturePath);
+            const TextureArrayCache::Layer& layer = layerIt != layersByPath.end() ? *layerIt->second : *whiteLayer;
+            subMesh.textureID = 0;
+            subMesh.arrayClass = layer.getSizeClass();
+            layerIndices.push_back(layer.getIndex());
         }
-        meshTextureIDs.push_back(currentMeshTextureID);
+        subMeshes.push_back(subMesh);
     }
+
+    // With arrays, each vertex carries its sub-mesh's layer in the PackedVertex padding, so
+    // sub-meshes of different textures can be one indirect draw. The cached vertices are
+    // layer-free (layers differ from run to run), hence the copy.
+    const void* vertexData = meshView.vertices;
+    std::vector<PackedVertex> layeredVertices;
+    if (texturesInArrays) {
+        const PackedVertex* cachedVertices = static_cast<const PackedVertex*>(meshView.vertices);
+        layeredVertices.assign(cachedVertices, cachedVertices + meshView.vertexCount);
+        // Sub-meshes are stored in vertex order, each up to where the next begins
+        for (size_t i = 0; i < meshView.subMeshes.size(); ++i) {
+            size_t end = i + 1 < meshView.subMeshes.size() ? meshView.subMeshes[i + 1].baseVertex : meshView.vertexCount;
+            for (size_t v = meshView.subMeshes[i].baseVertex; v < end; ++v) {
+                layeredVertices[v].position[3] = static_cast<int16_t>(layerIndices[i]);
+            }
+        }
+        vertexData = layeredVertices.data();
+    }
+
+    boundingBoxMin = meshView.boundingBoxMin;
+    boundingBoxMax = meshView.boundingBoxMax;
+    boundingBoxCalculated = meshView.boundingBoxCalculated;
+    quantization = meshView.quantization;
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    // Shared by all meshes of this model; filled by updateInstanceBuffer every frame
+    glGenBuffers(1, &instanceVBO);
+
+    GLStateCache::GetInstance().BindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, meshView.vertexCount * meshView.vertexStride, vertexData, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, meshView.indexCount * sizeof(unsigned int), meshView.indices, GL_STATIC_DRAW);
+
+    // Position, UV and normal of PackedVertex; location 3 stays free for the terrain's splat weights
+    setPackedVertexAttributes();
+
+    // Instance model matrices
+    enableInstanceMatrixAttributes();
+    instanceAttributeBase = -1;
+    setInstanceAttributeBase(0);
+    // ScatterInstance attributes; enabled instead of the matrix ones for scatter draws
+    glVertexAttribDivisor(9, 1);
+    glVertexAttribDivisor(10, 1);
+    scatterAttributes = false;
+
+    GLStateCache::GetInstance().BindVertexArray(0);
     
-    calculateBoundingBox(scene, meshesToLoadIndices);
-    return true; 
+    std::cout << "Packed " << subMeshes.size() << " meshes (" << meshView.vertexCount
+              << " vertices, " << meshView.indexCount << " indices) from '" << pending.filename << "', LOD triangles:";
+    for (int lod = 0; lod < MESH_LOD_COUNT; ++lod) {
+        size_t lodIndices = 0;
+        for (const SubMesh& subMesh : subMeshes) lodIndices += subMesh.indexCount[lod];
+        std::cout << " " << lodIndices / 3;
+    }
+    std::cout << std::endl;
 }
 
-void ObjectLoader::render(Shader& program) {
-    GLint isTerrainLoc = glGetUniformLocation(program.getProgramID(), "u_isTerrain");
-    if (isTerrainLoc != -1) {
-        glUniform1i(isTerrainLoc, 0);
+void ObjectLoader::updateInstanceBuffer(const std::vector<mat4>& modelMatrices) {
+    instanceCount = static_cast<GLsizei>(modelMatrices.size());
+    if (instanceVBO == 0 || modelMatrices.empty()) return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if (modelMatrices.size() > instanceCapacity) {
+        // Grow geometrically so placing objects one by one doesn't reallocate every frame
+        instanceCapacity = std::max(modelMatrices.size(), instanceCapacity * 2);
     }
-    
-    // Save current active texture unit
-    GLint currentActiveTexture;
-    glGetIntegerv(GL_ACTIVE_TEXTURE, &currentActiveTexture);
-    
-    // Activate texture unit 4 for object textures
-    glActiveTexture(GL_TEXTURE4);
-    
-    for (size_t i = 0; i < vaos.size(); ++i) {
-        GLint objectTexLoc = glGetUniformLocation(program.getProgramID(), "objectTexture");
-        if (objectTexLoc != -1) {
-            GLuint textureToUseFromMeshVector = meshTextureIDs[i];
-            
-            // Bind the appropriate texture to unit 4
-            if (textureToUseFromMeshVector == 0) {
-                glBindTexture(GL_TEXTURE_2D, defaultWhiteTextureID);
-                //std::cout << "Mesh " << i << " USING defaultWhiteTextureID: " << defaultWhiteTextureID << std::endl;
-            } else {
-                glBindTexture(GL_TEXTURE_2D, textureToUseFromMeshVector);
-                //std::cout << "Mesh " << i << " USING loaded texture ID: " << textureToUseFromMeshVector << std::endl;
-            }
-            glUniform1i(objectTexLoc, 4); // Tell shader to use texture unit 4
+    // Orphan last frame's storage so the upload doesn't wait on draws still using it
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(mat4), nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, modelMatrices.size() * sizeof(mat4), modelMatrices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ObjectLoader::setInstanceAttributeBase(GLsizei firstInstance) {
+    if (firstInstance == instanceAttributeBase) return;
+
+    // Expects the VAO to be bound
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    setInstanceMatrixAttributes(firstInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    instanceAttributeBase = firstInstance;
+}
+
+void ObjectLoader::useScatterAttributes(bool scatter) {
+    if (scatter == scatterAttributes) return;
+
+    // Expects the VAO to be bound. The disabled set is never read by the shaders.
+    for (GLuint location = 5; location <= 8; ++location) {
+        if (scatter) glDisableVertexAttribArray(location);
+        else glEnableVertexAttribArray(location);
+    }
+    for (GLuint location = 9; location <= 10; ++location) {
+        if (scatter) glEnableVertexAttribArray(location);
+        else glDisableVertexAttribArray(location);
+    }
+    scatterAttributes = scatter;
+}
+
+void ObjectLoader::enqueueSubMeshes(RenderQueue& queue, unsigned int pass, const Shader& program, bool textured,
+                                    const void* context, DrawKind kind, int meshLod, GLsizei firstInstance,
+                                    GLsizei count, float distance) {
+    RenderPacket packet;
+    packet.shader = &program;
+    packet.vertexArray = vao;
+    packet.source = this;
+    packet.context = context;
+    packet.textureTarget = texturesInArrays ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    packet.args[1] = static_cast<uint32_t>(firstInstance);
+    packet.args[2] = static_cast<uint32_t>(count);
+    for (size_t i = 0; i < subMeshes.size(); ++i) {
+        // The shadow program samples no texture, so its packets only sort by VAO and depth.
+        // Array packets are keyed by their class's array: models sharing it sort together.
+        if (!textured) {
+            packet.texture = 0;
+        } else if (texturesInArrays) {
+            packet.texture = TextureArrayCache::getInstance().getArrayTexture(subMeshes[i].arrayClass);
+        } else {
+            packet.texture = subMeshes[i].textureID;
         }
+        packet.key = RenderQueue::MakeKey(pass, program.getProgramID(), packet.texture, vao, distance);
+        packet.args[0] = kind | static_cast<uint32_t>(meshLod) << 8 | static_cast<uint32_t>(i) << 16;
+        queue.Add(packet);
+    }
+}
 
-        glBindVertexArray(vaos[i]);
-        glDrawElements(GL_TRIANGLES, indexCounts[i], GL_UNSIGNED_INT, 0);
+void ObjectLoader::enqueue(RenderQueue& queue, unsigned int pass, const Shader& program,
+                           const ObjectRenderUniforms& uniforms, const LodInstanceRanges& instances, int lodBias) {
+    if (vao == 0) return;
+
+    const bool textured = uniforms.objectTexture.isValid();
+    for (int lod = 0; lod < MESH_LOD_COUNT; ++lod) {
+        if (instances.count[lod] == 0) continue;
+        const int meshLod = std::min(lod + std::max(lodBias, 0), MESH_LOD_COUNT - 1);
+        enqueueSubMeshes(queue, pass, program, textured, &uniforms, DRAW_MATRICES, meshLod,
+                         instances.first[lod], instances.count[lod], instances.distance[lod]);
     }
-    
-    // Restore previous active texture unit to avoid disrupting other systems
-    glActiveTexture(currentActiveTexture);
-    glBindVertexArray(0); // Unbind VAO
 }
 
-void ObjectLoader::calculateBoundingBox(const aiScene* scene, const std::vector<unsigned int>& meshesToLoadIndices) {
+void ObjectLoader::enqueueScatter(RenderQueue& queue, unsigned int pass, const Shader& program,
+                                  const ScatterDrawContext& context, GLsizei firstInstance, GLsizei count,
+                                  int lod, float distance) {
+    if (count == 0 || vao == 0) return;
+
+    const bool textured = context.uniforms->objectTexture.isValid();
+    enqueueSubMeshes(queue, pass, program, textured, &context, DRAW_SCATTER,
+                     std::min(std::max(lod, 0), MESH_LOD_COUNT - 1), firstInstance, count, distance);
+}
+
+void ObjectLoader::prepareDraw(const RenderPacket& packet, bool continuing, GLsizei firstInstance) {
+    const Shader& program = *packet.shader;
+    if ((packet.args[0] & 0xFF) == DRAW_SCATTER) {
+        const ScatterDrawContext& context = *static_cast<const ScatterDrawContext*>(packet.context);
+        if (!continuing) {
+            context.uniforms->setObjectState(program, quantization, true, texturesInArrays);
+            program.setUniform(context.uniforms->scatterMaxScale, context.maxScale);
+            program.setUniform(context.uniforms->modelMatrix, context.baseTransform);
+        }
+        useScatterAttributes(true);
+        glBindBuffer(GL_ARRAY_BUFFER, context.instanceBuffer);
+        setScatterInstanceAttributes(firstInstance);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    } else {
+        if (!continuing) {
+            static_cast<const ObjectRenderUniforms*>(packet.context)->setObjectState(program, quantization, false,
+                                                                                     texturesInArrays);
+        }
+        useScatterAttributes(false);
+        setInstanceAttributeBase(firstInstance);
+    }
+}
+
+void ObjectLoader::Draw(const RenderPacket& packet, bool continuing) {
+    // The queue has bound the program, this model's VAO and the sub-mesh's texture.
+    // Without base-instance draws the instance attributes are re-pointed at the range instead.
+    const int meshLod = (packet.args[0] >> 8) & 0xFF;
+    const SubMesh& subMesh = subMeshes[packet.args[0] >> 16];
+    prepareDraw(packet, continuing, static_cast<GLsizei>(packet.args[1]));
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, subMesh.indexCount[meshLod], GL_UNSIGNED_INT,
+                                      (void*)subMesh.indexOffset[meshLod], static_cast<GLsizei>(packet.args[2]),
+                                      subMesh.baseVertex);
+}
+
+bool ObjectLoader::WriteCommand(const RenderPacket& packet, DrawElementsIndirectCommand& command) const {
+    const int meshLod = (packet.args[0] >> 8) & 0xFF;
+    const SubMesh& subMesh = subMeshes[packet.args[0] >> 16];
+    command.count = static_cast<GLuint>(subMesh.indexCount[meshLod]);
+    command.instanceCount = packet.args[2];
+    command.firstIndex = static_cast<GLuint>(subMesh.indexOffset[meshLod] / sizeof(unsigned int));
+    command.baseVertex = subMesh.baseVertex;
+    command.baseInstance = packet.args[1];
+    return true;
+}
+
+bool ObjectLoader::DrawIndirect(const RenderPacket& packet, bool continuing, const IndirectDrawBuffer& commands,
+                                GLsizei first, GLsizei count) {
+    // Each command's baseInstance offsets the instance attributes, so they point at the start
+    prepareDraw(packet, continuing, 0);
+    commands.Draw(GL_TRIANGLES, GL_UNSIGNED_INT, first, count);
+    return true;
+}
+
+void ObjectLoader::calculateBoundingBox(const aiScene* scene, const std::vector<unsigned int>& meshesToLoadIndices, CookedMesh& cooked) {
+    // Writes into the cooked mesh rather than the members: this runs on loader threads
     if (!scene || meshesToLoadIndices.empty()) {
-        boundingBoxCalculated = false;
+        cooked.boundingBoxCalculated = false;
         return;
     }
     
+    vec3& boundingBoxMin = cooked.boundingBoxMin;
+    vec3& boundingBoxMax = cooked.boundingBoxMax;
     bool firstVertex = true;
     
     for (unsigned int targetMeshIdx : meshesToLoadIndices) {
@@ -247,8 +605,8 @@ void ObjectLoader::calculateBoundingBox(const aiScene* scene, const std::vector<
         }
     }
     
-    boundingBoxCalculated = true;
-    vec3 size = GetBoundingBoxSize();
+    cooked.boundingBoxCalculated = true;
+    vec3 size = boundingBoxMax - boundingBoxMin;
     std::cout << "Calculated bounding box: Min(" << boundingBoxMin.x << ", " << boundingBoxMin.y << ", " << boundingBoxMin.z << ") "
               << "Max(" << boundingBoxMax.x << ", " << boundingBoxMax.y << ", " << boundingBoxMax.z << ") "
               << "Size(" << size.x << ", " << size.y << ", " << size.z << ")" << std::endl;
@@ -7,16 +7,105 @@
 #include <assimp/postprocess.h>
 #include <vector>
 #include <string>
+#include <memory>
 #include <iostream>
 #include "../Core/Shader.h" //For error messages
+#include "../Core/RenderQueue.h"
+#include "../Core/TextureArrayCache.h"
+#include "PackedVertex.h"
+#include "ScatterInstance.h"
+#include "MeshCache.h"
 
-class ObjectLoader {
+class Texture;
+class AssetLoader;
+
+// Uniforms the object path sets while drawing, resolved once per shader program
+struct ObjectRenderUniforms {
+    UniformHandle<bool> instanced;
+    UniformHandle<bool> isTerrain;
+    UniformHandle<int> objectTexture;
+    UniformHandle<bool> packedVertex;       // Vertices are PackedVertex rather than floats
+    UniformHandle<vec3> positionOffset;     // Per-model PackedVertex position dequantization
+    UniformHandle<vec3> positionScale;
+    UniformHandle<bool> scatter;            // Instances are ScatterInstances rather than matrices
+    UniformHandle<float> scatterMaxScale;
+    UniformHandle<mat4> modelMatrix;        // Base transform of scattered instances
+    UniformHandle<bool> textureArray;       // Textures are TextureArrayCache layers, picked per vertex
+    UniformHandle<int> objectTextureArray;
+
+    ObjectRenderUniforms() = default;
+    explicit ObjectRenderUniforms(const Shader& shader);
+
+    // Sets every uniform an instanced object draw depends on; draws from the queue can
+    // follow the terrain or another kind of object, so nothing is assumed left over
+    void setObjectState(const Shader& program, const VertexQuantization& quantization, bool scatterInstances,
+                        bool arrayTextures) const;
+};
+
+// Where one render pass finds its instances of each LOD in the instance buffer
+struct LodInstanceRanges {
+    GLsizei first[MESH_LOD_COUNT] = {};
+    GLsizei count[MESH_LOD_COUNT] = {};
+    float distance[MESH_LOD_COUNT] = {}; // From the camera to the nearest instance, for the sort key
+};
+
+// What the draws of one scattered asset share in a pass; must outlive the queue's Submit
+struct ScatterDrawContext {
+    const ObjectRenderUniforms* uniforms = nullptr;
+    GLuint instanceBuffer = 0; // Of ScatterInstances
+    mat4 baseTransform;
+    float maxScale = 1.0f;     // Of the ScatterInstance scale encoding
+};
+
+class ObjectLoader : public RenderSource {
 public:
     ObjectLoader(Shader& shaderProgram);
     ~ObjectLoader();
 
     bool load(const std::string& filename, const std::vector<unsigned int>& meshesToLoadIndices = {});
-    void render(Shader& program); // Modified to accept a shader
+
+    // load() split for AssetLoader: prepareLoad does the file I/O, import and texture
+    // decoding without touching GL (safe on a worker thread); finishLoad creates the
+    // GL objects from the prepared data and must run on the context thread
+    bool prepareLoad(const std::string& filename, const std::vector<unsigned int>& meshesToLoadIndices = {});
+    bool finishLoad();
+
+    // Import option: resample the model's diffuse textures into TextureArrayCache's size
+    // classes instead of loading them as 2D textures. Its sub-meshes then differ only by
+    // a per-vertex layer, so they share texture state with each other and with every other
+    // model imported this way. Takes effect from the next load.
+    void setUseTextureArrays(bool enabled) { useTextureArrays = enabled; }
+
+    // On-demand loading: prepareLoad on the loader's workers, finishLoad from its
+    // completion queue. Until the state is Resident, enqueue() draws nothing and the
+    // bounding box is the one in the model's mesh cache header, or the 1x1x1 default
+    // if it has not been cooked yet. loadAsync only starts a load from Unloaded: calls
+    // while Loading or Resident are no-ops, and a Failed model is not retried.
+    enum class LoadState { Unloaded, Loading, Resident, Failed };
+    void loadAsync(AssetLoader& loader, const std::string& filename, const std::vector<unsigned int>& meshesToLoadIndices = {});
+    LoadState getLoadState() const { return loadState; }
+    bool isResident() const { return loadState == LoadState::Resident; }
+    // Instanced rendering: every placed copy of this model is drawn with one call per mesh and LOD.
+    // Matrices must already be column-major (transposed Angel matrices), one per instance.
+    void updateInstanceBuffer(const std::vector<mat4>& modelMatrices);
+    // Queues the given ranges of the last updateInstanceBuffer call, lodBias levels coarser
+    // than selected: one packet per mesh and LOD, keyed by its material texture
+    void enqueue(RenderQueue& queue, unsigned int pass, const Shader& program, const ObjectRenderUniforms& uniforms,
+                 const LodInstanceRanges& instances, int lodBias = 0);
+    GLsizei getInstanceCount() const { return instanceCount; }
+    // Queues count ScatterInstances starting at firstInstance of context.instanceBuffer with one LOD
+    void enqueueScatter(RenderQueue& queue, unsigned int pass, const Shader& program, const ScatterDrawContext& context,
+                        GLsizei firstInstance, GLsizei count, int lod, float distance);
+    void Draw(const RenderPacket& packet, bool continuing) override;
+    // With base instances, every mesh and LOD range of a model sharing a texture (or, with
+    // texture arrays, a size class) is one call
+    bool WriteCommand(const RenderPacket& packet, DrawElementsIndirectCommand& command) const override;
+    bool DrawIndirect(const RenderPacket& packet, bool continuing, const IndirectDrawBuffer& commands,
+                      GLsizei first, GLsizei count) override;
+
+    // LOD to draw an object at given its projected size in pixels. The previous LOD
+    // only changes once the size is clearly past a threshold, so objects don't flicker.
+    static int selectLod(float screenSize, int currentLod);
     
     // Bounding box methods
     vec3 GetBoundingBoxSize() const;
@@ -26,14 +115,52 @@ public:
 private:
     void createDefaultWhiteTexture();
     void cleanup(); // Helper for destructor and potential re-load
-    void calculateBoundingBox(const aiScene* scene, const std::vector<unsigned int>& meshesToLoadIndices);
+    void calculateBoundingBox(const aiScene* scene, const std::vector<unsigned int>& meshesToLoadIndices, CookedMesh& cooked);
 
-    std::vector<GLuint> vaos, vbos, ebos;
-    std::vector<int> indexCounts;
-    std::vector<GLuint> meshTextureIDs;
+    struct PendingLoad; // CPU-side results of prepareLoad waiting for finishLoad
+    bool importMesh(const std::string& filename, const std::vector<unsigned int>& meshesToLoadIndices, CookedMesh& cooked);
+    void uploadMesh(PendingLoad& pending);
+    void setInstanceAttributeBase(GLsizei firstInstance);
+    // Switches the VAO between matrix (5-8) and ScatterInstance (9-10) instance attributes
+    void useScatterAttributes(bool scatter);
+    // Packet args[0]: what to draw, with the LOD in bits 8-15 and the sub-mesh from bit 16
+    enum DrawKind : uint32_t { DRAW_MATRICES, DRAW_SCATTER };
+    void enqueueSubMeshes(RenderQueue& queue, unsigned int pass, const Shader& program, bool textured, const void* context,
+                          DrawKind kind, int meshLod, GLsizei firstInstance, GLsizei count, float distance);
+    // Sets the packet's uniforms unless continuing, and switches to its kind of instance
+    // attributes, pointed at firstInstance
+    void prepareDraw(const RenderPacket& packet, bool continuing, GLsizei firstInstance);
+
+    // One aiMesh inside the shared buffers, drawn with glDrawElementsInstancedBaseVertex
+    struct SubMesh {
+        GLsizei indexCount[MESH_LOD_COUNT];
+        size_t indexOffset[MESH_LOD_COUNT]; // Byte offset into ebo
+        GLint baseVertex;     // First vertex of this mesh in vbo
+        GLuint textureID;     // 2D texture, unless the model's textures are in arrays...
+        int arrayClass;       // ...then the TextureArrayCache size class; the layer is in the vertices
+    };
+
+    // All meshes of the model share one VAO, vertex buffer and index buffer
+    GLuint vao, vbo, ebo;
+    std::vector<SubMesh> subMeshes; // Sorted by material
+    VertexQuantization quantization; // Decodes the PackedVertex positions in vbo
+    std::vector<std::shared_ptr<Texture>> textures; // Keeps this model's TextureCache entries alive
+    std::vector<std::shared_ptr<TextureArrayCache::Layer>> textureLayers; // Or its TextureArrayCache layers
+    bool useTextureArrays;  // Import option for the next load
+    bool texturesInArrays;  // How the loaded model's textures were imported
+
+    // Per-instance model matrices, attached to every mesh VAO at locations 5-8
+    GLuint instanceVBO;
+    GLsizei instanceCount;
+    size_t instanceCapacity;
+    GLsizei instanceAttributeBase; // First instance the VAO's instance attributes point at
+    bool scatterAttributes;        // Which instance attributes the VAO has enabled
     
     GLuint defaultWhiteTextureID;
     
+    std::unique_ptr<PendingLoad> pendingLoad;
+    LoadState loadState; // Only changed on the context thread
+    
     // Bounding box data
     vec3 boundingBoxMin;
     vec3 boundingBoxMax;
@@ -0,0 +1,375 @@
+#include "ObjectPopulation.h"
+#include "../Core/Hash.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <thread>
+
+namespace {
+
+// World units per tile side (a power of two, so tile lookups are exact)
+const float TILE_SIZE = 128.0f;
+// Spacing range. Up to a quarter tile, every conflict lies within adjacent tiles and two
+// cells of the sampling grid; at 1 unit a 4096x4096 world already holds millions of points.
+const float MIN_SPACING = 1.0f;
+const float MAX_SPACING = TILE_SIZE / 4.0f;
+// Blue-noise tiles made per rule. Each world tile uses one of them, mirrored, transposed
+// and shifted, which hides the repetition at a fraction of the cost of sampling every tile.
+const int PATTERN_VARIANTS = 4;
+// Bridson's k, with candidates just past the minimum distance as in ScatterLayer
+const int CANDIDATES_PER_SAMPLE = 24;
+const float CANDIDATE_DISTANCE = 1.0001f;
+
+struct Placed {
+    float x, z;
+    float radius; // Half the spacing of its rule
+};
+
+struct Tile {
+    int x, z;
+    std::vector<Placed> placed;
+    std::vector<int> cellHead; // Per rejection cell: the last placed index in it, or -1...
+    std::vector<int> next;     // ...chained through the earlier ones
+    std::vector<std::vector<ScatterInstance>> instances; // Per rule
+};
+
+// A rule's tests in the units the sampler compares against
+struct RuleLimits {
+    float spacing;
+    float minSlopeCos, maxSlopeCos; // Bounds on normal.y: steeper ground has a smaller one
+    float minHeight, maxHeight;     // World units
+    float minScale, maxScale;
+};
+
+// Per-thread scratch, reused from tile to tile
+struct Sampler {
+    std::vector<vec2> points;
+    std::vector<float> heights;
+    std::vector<vec3> normals;
+};
+
+struct World {
+    const TerrainGrid* terrain;
+    const std::vector<PopulationRule>* rules;
+    std::vector<RuleLimits> limits;
+    uint32_t seed;
+    float sizeX, sizeZ; // Extent covered by the heightmap
+    int tilesX, tilesZ;
+    int cellsPerTile;   // Rejection cells per tile side, each at least as wide as the largest spacing
+    float cellSize;
+    std::vector<std::vector<vec2>> patterns; // PATTERN_VARIANTS per rule, in [0, TILE_SIZE)^2
+    std::vector<Tile> tiles;
+};
+
+// std::mt19937's sequence is fixed by the standard but its distributions are not, so
+// floats are made directly from it to keep a seed's world the same across compilers
+float unitFloat(std::mt19937& random) {
+    return static_cast<float>(random() >> 8) * (1.0f / 16777216.0f);
+}
+
+// Independent stream for one (x, z, rule) of the world seed
+uint32_t deriveSeed(uint32_t seed, int x, int z, size_t rule) {
+    const uint32_t key[4] = { seed, static_cast<uint32_t>(x), static_cast<uint32_t>(z), static_cast<uint32_t>(rule) };
+    uint64_t hash = Hash::Fnv1a64(key, sizeof(key));
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+const std::array<vec2, CANDIDATES_PER_SAMPLE>& candidateDirections() {
+    static const std::array<vec2, CANDIDATES_PER_SAMPLE> directions = [] {
+        std::array<vec2, CANDIDATES_PER_SAMPLE> table;
+        for (int i = 0; i < CANDIDATES_PER_SAMPLE; ++i) {
+            float angle = 2.0f * static_cast<float>(M_PI) * i / CANDIDATES_PER_SAMPLE;
+            table[i] = vec2(std::cos(angle), std::sin(angle));
+        }
+        return table;
+    }();
+    return directions;
+}
+
+// Rejection cell of a world coordinate along one axis. The cell is found within the
+// coordinate's tile, so a point is always filed under the tile it was sampled in.
+int cellCoord(const World& world, float coordinate, int tileCount) {
+    int tile = std::min(std::max(static_cast<int>(std::floor(coordinate / TILE_SIZE)), 0), tileCount - 1);
+    int local = static_cast<int>((coordinate - tile * TILE_SIZE) / world.cellSize);
+    return tile * world.cellsPerTile + std::min(std::max(local, 0), world.cellsPerTile - 1);
+}
+
+// Whether p keeps its distance from everything placed so far. Only reads the tiles around
+// p, none of which is being written while p's tile is processed.
+bool isClear(const World& world, const vec2& p, float radius) {
+    const int cellX = cellCoord(world, p.x, world.tilesX);
+    const int cellZ = cellCoord(world, p.y, world.tilesZ);
+    const int lastCellX = world.tilesX * world.cellsPerTile - 1;
+    const int lastCellZ = world.tilesZ * world.cellsPerTile - 1;
+    for (int z = std::max(cellZ - 1, 0); z <= std::min(cellZ + 1, lastCellZ); ++z) {
+        for (int x = std::max(cellX - 1, 0); x <= std::min(cellX + 1, lastCellX); ++x) {
+            const Tile& tile = world.tiles[(z / world.cellsPerTile) * world.tilesX + x / world.cellsPerTile];
+            int cell = (z % world.cellsPerTile) * world.cellsPerTile + x % world.cellsPerTile;
+            for (int i = tile.cellHead[cell]; i >= 0; i = tile.next[i]) {
+                const Placed& other = tile.placed[i];
+                float dx = other.x - p.x, dz = other.z - p.y;
+                float reach = radius + other.radius;
+                if (dx * dx + dz * dz < reach * reach) return false;
+            }
+        }
+    }
+    return true;
+}
+
+void place(const World& world, Tile& tile, const vec2& p, float radius) {
+    int x = cellCoord(world, p.x, world.tilesX) - tile.x * world.cellsPerTile;
+    int z = cellCoord(world, p.y, world.tilesZ) - tile.z * world.cellsPerTile;
+    int cell = z * world.cellsPerTile + x;
+    tile.next.push_back(tile.cellHead[cell]);
+    tile.cellHead[cell] = static_cast<int>(tile.placed.size());
+    tile.placed.push_back({ p.x, p.y, radius });
+}
+
+// Bridson's Poisson-disk sampling of a TILE_SIZE square that wraps around at its edges,
+// so copies laid side by side (mirrored or shifted) keep the spacing across the seams
+void generatePattern(float spacing, uint32_t seed, std::vector<vec2>& points) {
+    // Cells of at most spacing / sqrt(2) hold one sample each; with spacing capped at a
+    // quarter tile they are also at least spacing / 2 wide, so conflicts lie within two cells
+    const int gridSize = static_cast<int>(std::ceil(TILE_SIZE * std::sqrt(2.0f) / spacing));
+    const float cellSize = TILE_SIZE / gridSize;
+    const float spacingSquared = spacing * spacing;
+    const float halfTile = 0.5f * TILE_SIZE;
+    std::vector<int> cells(static_cast<size_t>(gridSize) * gridSize, -1);
+    std::vector<size_t> active;
+    std::mt19937 random(seed);
+    points.clear();
+
+    auto wrap = [](float v) {
+        if (v < 0.0f) v += TILE_SIZE;
+        else if (v >= TILE_SIZE) v -= TILE_SIZE;
+        return v < TILE_SIZE ? v : 0.0f;
+    };
+    auto cellOf = [&](float v) { return std::min(static_cast<int>(v / cellSize), gridSize - 1); };
+    auto fits = [&](const vec2& p) {
+        int cellX = cellOf(p.x), cellZ = cellOf(p.y);
+        for (int dz = -2; dz <= 2; ++dz) {
+            int z = (cellZ + dz + gridSize) % gridSize;
+            for (int dx = -2; dx <= 2; ++dx) {
+                int sample = cells[z * gridSize + (cellX + dx + gridSize) % gridSize];
+                if (sample < 0) continue;
+                // Distance to the nearest copy of the sample
+                vec2 d = points[sample] - p;
+                if (d.x > halfTile) d.x -= TILE_SIZE; else if (d.x < -halfTile) d.x += TILE_SIZE;
+                if (d.y > halfTile) d.y -= TILE_SIZE; else if (d.y < -halfTile) d.y += TILE_SIZE;
+                if (dot(d, d) < spacingSquared) return false;
+            }
+        }
+        return true;
+    };
+    auto accept = [&](const vec2& p) {
+        cells[cellOf(p.y) * gridSize + cellOf(p.x)] = static_cast<int>(points.size());
+        active.push_back(points.size());
+        points.push_back(p);
+    };
+
+    // The square has no edges, so growth from one seed reaches all of it
+    accept(vec2(unitFloat(random) * TILE_SIZE, unitFloat(random) * TILE_SIZE));
+    const std::array<vec2, CANDIDATES_PER_SAMPLE>& directions = candidateDirections();
+    const float turn = 2.0f * static_cast<float>(M_PI);
+    while (!active.empty()) {
+        size_t index = std::min(static_cast<size_t>(unitFloat(random) * active.size()), active.size() - 1);
+        vec2 around = points[active[index]];
+        float start = unitFloat(random) * turn;
+        float startCos = std::cos(start) * spacing * CANDIDATE_DISTANCE;
+        float startSin = std::sin(start) * spacing * CANDIDATE_DISTANCE;
+        bool found = false;
+        for (int attempt = 0; attempt < CANDIDATES_PER_SAMPLE && !found; ++attempt) {
+            const vec2& direction = directions[attempt];
+            vec2 candidate(wrap(around.x + startCos * direction.x - startSin * direction.y),
+                           wrap(around.y + startSin * direction.x + startCos * direction.y));
+            if (fits(candidate)) {
+                accept(candidate);
+                found = true;
+            }
+        }
+        if (!found) {
+            active[index] = active.back();
+            active.pop_back();
+        }
+    }
+}
+
+// One of the rule's patterns over the tile, transposed, mirrored and shifted (with wrap-around)
+// at random: the eight symmetries of the square keep the pattern's spacing
+void layPattern(const World& world, const Tile& tile, size_t ruleIndex, std::mt19937& random, std::vector<vec2>& points) {
+    const std::vector<vec2>& pattern = world.patterns[ruleIndex * PATTERN_VARIANTS + random() % PATTERN_VARIANTS];
+    const uint32_t symmetry = random();
+    const float offsetX = unitFloat(random) * TILE_SIZE;
+    const float offsetZ = unitFloat(random) * TILE_SIZE;
+    const float originX = tile.x * TILE_SIZE;
+    const float originZ = tile.z * TILE_SIZE;
+
+    points.clear();
+    for (const vec2& sample : pattern) {
+        float u = sample.x, v = sample.y;
+        if (symmetry & 1) std::swap(u, v);
+        if (symmetry & 2) u = TILE_SIZE - u;
+        if (symmetry & 4) v = TILE_SIZE - v;
+        u += offsetX;
+        v += offsetZ;
+        if (u >= TILE_SIZE) u -= TILE_SIZE;
+        if (v >= TILE_SIZE) v -= TILE_SIZE;
+        vec2 p(originX + u, originZ + v);
+        if (p.x < world.sizeX && p.y < world.sizeZ) points.push_back(p);
+    }
+}
+
+// Calls work(index, sampler) for every index below count, spread over the hardware threads
+template <typename Work>
+void runParallel(size_t count, Work work) {
+    std::atomic<size_t> next(0);
+    auto run = [&]() {
+        Sampler sampler;
+        for (size_t i = next++; i < count; i = next++) {
+            work(i, sampler);
+        }
+    };
+    int threadCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    threadCount = static_cast<int>(std::min<size_t>(threadCount, count));
+    std::vector<std::thread> workers;
+    for (int worker = 1; worker < threadCount; ++worker) {
+        workers.emplace_back(run);
+    }
+    run();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void populateTile(World& world, Tile& tile, Sampler& sampler) {
+    const std::vector<PopulationRule>& rules = *world.rules;
+    const float turn = 2.0f * static_cast<float>(M_PI);
+    tile.instances.resize(rules.size());
+
+    // Earlier rules claim the ground first
+    for (size_t ruleIndex = 0; ruleIndex < rules.size(); ++ruleIndex) {
+        const PopulationRule& rule = rules[ruleIndex];
+        const RuleLimits& limits = world.limits[ruleIndex];
+        const float radius = 0.5f * limits.spacing;
+        std::mt19937 random(deriveSeed(world.seed, tile.x, tile.z, ruleIndex));
+
+        layPattern(world, tile, ruleIndex, random, sampler.points);
+        const size_t count = sampler.points.size();
+        sampler.heights.resize(count);
+        sampler.normals.resize(count);
+        world.terrain->GetHeightsAtWorldPos(sampler.points.data(), sampler.heights.data(), count, sampler.normals.data());
+
+        for (size_t i = 0; i < count; ++i) {
+            const vec2& p = sampler.points[i];
+            float height = sampler.heights[i];
+            float normalY = sampler.normals[i].y;
+            if (height < limits.minHeight || height > limits.maxHeight) continue;
+            if (normalY > limits.minSlopeCos || normalY < limits.maxSlopeCos) continue;
+            if (rule.splatLayer >= 0 &&
+                world.terrain->GetSplatWeightAtWorldPos(p.x, p.y, rule.splatLayer) < rule.minSplatWeight) continue;
+            if (rule.density < 1.0f && unitFloat(random) >= rule.density) continue;
+            if (!isClear(world, p, radius)) continue;
+
+            place(world, tile, p, radius);
+            float yaw = unitFloat(random) * turn;
+            float scale = limits.minScale + (limits.maxScale - limits.minScale) * unitFloat(random);
+            tile.instances[ruleIndex].push_back(packScatterInstance(vec3(p.x, height, p.y), yaw, scale));
+        }
+    }
+}
+
+} // namespace
+
+void generatePopulation(const TerrainGrid& terrain, const std::vector<PopulationRule>& rules, uint32_t seed,
+                        std::vector<std::vector<ScatterInstance>>& instances) {
+    instances.assign(rules.size(), std::vector<ScatterInstance>());
+
+    World world;
+    world.terrain = &terrain;
+    world.rules = &rules;
+    world.seed = seed;
+    world.sizeX = (terrain.GetWidth() - 1) * terrain.GetWorldScale();
+    world.sizeZ = (terrain.GetDepth() - 1) * terrain.GetWorldScale();
+    if (rules.empty() || world.sizeX <= 0.0f || world.sizeZ <= 0.0f) return;
+
+    const float minTerrainHeight = terrain.GetMinHeight();
+    float heightRange = terrain.GetMaxHeight() - minTerrainHeight;
+    if (heightRange <= 1e-5f) {
+        heightRange = 1.0f;
+    }
+    float largestSpacing = 0.0f;
+    for (const PopulationRule& rule : rules) {
+        RuleLimits limits;
+        limits.spacing = std::min(std::max(rule.spacing, MIN_SPACING), MAX_SPACING);
+        limits.minSlopeCos = std::cos(std::min(std::max(rule.minSlope, 0.0f), 90.0f) * DegreesToRadians);
+        limits.maxSlopeCos = std::cos(std::min(std::max(rule.maxSlope, 0.0f), 90.0f) * DegreesToRadians);
+        limits.minHeight = minTerrainHeight + heightRange * rule.minHeight;
+        limits.maxHeight = minTerrainHeight + heightRange * rule.maxHeight;
+        limits.minScale = std::min(std::max(rule.minScale, 0.0f), SCATTER_MAX_SCALE);
+        limits.maxScale = std::min(std::max(rule.maxScale, limits.minScale), SCATTER_MAX_SCALE);
+        world.limits.push_back(limits);
+        largestSpacing = std::max(largestSpacing, limits.spacing);
+    }
+    world.cellsPerTile = std::max(1, static_cast<int>(TILE_SIZE / largestSpacing));
+    world.cellSize = TILE_SIZE / world.cellsPerTile;
+
+    world.tilesX = static_cast<int>(std::ceil(world.sizeX / TILE_SIZE));
+    world.tilesZ = static_cast<int>(std::ceil(world.sizeZ / TILE_SIZE));
+    world.tiles.resize(static_cast<size_t>(world.tilesX) * world.tilesZ);
+    for (int z = 0; z < world.tilesZ; ++z) {
+        for (int x = 0; x < world.tilesX; ++x) {
+            Tile& tile = world.tiles[z * world.tilesX + x];
+            tile.x = x;
+            tile.z = z;
+            tile.cellHead.assign(world.cellsPerTile * world.cellsPerTile, -1);
+        }
+    }
+
+    // Patterns are seeded apart from every tile (tile coordinates are never negative)
+    world.patterns.resize(rules.size() * PATTERN_VARIANTS);
+    runParallel(world.patterns.size(), [&](size_t pattern, Sampler&) {
+        size_t ruleIndex = pattern / PATTERN_VARIANTS;
+        generatePattern(world.limits[ruleIndex].spacing, deriveSeed(seed, -1, static_cast<int>(pattern % PATTERN_VARIANTS), ruleIndex),
+                        world.patterns[pattern]);
+    });
+
+    // Tiles of one phase never touch, so each only reads neighbours that finished in an
+    // earlier phase (or haven't started) while it writes its own hash cells
+    std::vector<Tile*> phaseTiles;
+    for (int phase = 0; phase < 4; ++phase) {
+        phaseTiles.clear();
+        for (Tile& tile : world.tiles) {
+            if (((tile.x & 1) | ((tile.z & 1) << 1)) == phase) phaseTiles.push_back(&tile);
+        }
+        runParallel(phaseTiles.size(), [&](size_t i, Sampler& sampler) {
+            populateTile(world, *phaseTiles[i], sampler);
+        });
+    }
+
+    for (size_t ruleIndex = 0; ruleIndex < rules.size(); ++ruleIndex) {
+        size_t total = 0;
+        for (const Tile& tile : world.tiles) total += tile.instances[ruleIndex].size();
+        instances[ruleIndex].reserve(total);
+        for (const Tile& tile : world.tiles) {
+            instances[ruleIndex].insert(instances[ruleIndex].end(),
+                                        tile.instances[ruleIndex].begin(), tile.instances[ruleIndex].end());
+        }
+    }
+}
+
+size_t populateObjects(const TerrainGrid& terrain, const std::vector<PopulationRule>& rules, uint32_t seed,
+                       ScatterLayer& layer) {
+    std::vector<std::vector<ScatterInstance>> instances;
+    generatePopulation(terrain, rules, seed, instances);
+
+    size_t added = 0;
+    for (size_t ruleIndex = 0; ruleIndex < rules.size(); ++ruleIndex) {
+        if (!rules[ruleIndex].asset) continue;
+        layer.Add(*rules[ruleIndex].asset, rules[ruleIndex].baseTransform,
+                  instances[ruleIndex].data(), instances[ruleIndex].size());
+        added += instances[ruleIndex].size();
+    }
+    return added;
+}
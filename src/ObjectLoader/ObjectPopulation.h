@@ -0,0 +1,44 @@
+#ifndef OBJECT_POPULATION_H
+#define OBJECT_POPULATION_H
+
+#include "Angel.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ObjectLoader.h"
+#include "ScatterInstance.h"
+#include "ScatterLayer.h"
+#include "../Grid/TerrainGrid.h"
+
+// Where one asset grows when the world is populated after terrain generation.
+// A point is kept only if the ground there passes every test.
+struct PopulationRule {
+    ObjectLoader* asset = nullptr;
+    mat4 baseTransform;          // Orientation and size of the model, as for the scatter brush
+    int splatLayer = -1;         // Terrain texture layer it grows on (GridMesh order), -1 for any...
+    float minSplatWeight = 0.5f; // ...and how much of that layer the ground must show
+    float minSlope = 0.0f;       // Ground slope range, in degrees
+    float maxSlope = 90.0f;
+    float minHeight = 0.0f;      // Height range, as fractions of the terrain's min..max
+    float maxHeight = 1.0f;
+    float spacing = 8.0f;        // Between its own instances (1 to 32 units); against another rule's, the mean of both spacings
+    float density = 1.0f;        // Fraction of the points passing the tests that are kept
+    float minScale = 0.8f;       // Random scale range, on top of baseTransform
+    float maxScale = 1.2f;
+};
+
+// Covers the terrain with blue noise per rule (a few wrap-around Poisson-disk tiles, laid
+// mirrored and shifted) and keeps the points whose ground passes the rule and that keep
+// their distance from everything placed so far, found through a per-tile hash grid.
+// The world is split into square tiles populated in parallel, each from a seed derived
+// from `seed` and its coordinates. Tiles run in four phases of non-adjacent tiles, so the
+// result is the same for any number of threads. instances[r] receives rule r's instances.
+void generatePopulation(const TerrainGrid& terrain, const std::vector<PopulationRule>& rules, uint32_t seed,
+                        std::vector<std::vector<ScatterInstance>>& instances);
+
+// generatePopulation, then adds each rule's instances to `layer` (rules without an asset
+// are sampled but not added). Returns the number of instances added.
+size_t populateObjects(const TerrainGrid& terrain, const std::vector<PopulationRule>& rules, uint32_t seed,
+                       ScatterLayer& layer);
+
+#endif // OBJECT_POPULATION_H
@@ -0,0 +1,115 @@
+#include "PackedVertex.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+
+int16_t toSnorm16(float value) {
+    value = std::max(-1.0f, std::min(1.0f, value));
+    return static_cast<int16_t>(std::lround(value * 32767.0f));
+}
+
+// IEEE 754 binary16, rounded to nearest even
+uint16_t toHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t floatExponent = (bits >> 23) & 0xFFu;
+    uint32_t mantissa = bits & 0x7FFFFFu;
+
+    if (floatExponent == 0xFFu) {
+        return static_cast<uint16_t>(sign | 0x7C00u | (mantissa ? 0x200u : 0u)); // Inf / NaN
+    }
+    const int exponent = static_cast<int>(floatExponent) - 127 + 15;
+    if (exponent >= 31) {
+        return static_cast<uint16_t>(sign | 0x7C00u); // Too large: infinity
+    }
+    if (exponent <= 0) {
+        if (exponent < -10) return static_cast<uint16_t>(sign); // Too small: signed zero
+        // Subnormal half: shift the mantissa (with its implicit 1) into place
+        mantissa |= 0x800000u;
+        const uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1u);
+        const uint32_t halfway = 1u << (shift - 1u);
+        if (remainder > halfway || (remainder == halfway && (half & 1u))) ++half;
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    const uint32_t remainder = mantissa & 0x1FFFu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) ++half; // Carry may round up to infinity
+    return static_cast<uint16_t>(sign | half);
+}
+
+float signNotZero(float value) {
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+} // namespace
+
+VertexQuantization VertexQuantization::fromBounds(const vec3& boundsMin, const vec3& boundsMax) {
+    VertexQuantization quantization;
+    quantization.offset = (boundsMin + boundsMax) * 0.5f;
+    for (int i = 0; i < 3; ++i) {
+        // Flat axes still need a non-zero scale to divide by
+        quantization.scale[i] = std::max((boundsMax[i] - boundsMin[i]) * 0.5f, 1e-6f);
+    }
+    return quantization;
+}
+
+PackedVertex packVertex(const vec3& position, const vec3& normal, const vec2& texCoord,
+                        const VertexQuantization& quantization) {
+    PackedVertex vertex;
+    for (int i = 0; i < 3; ++i) {
+        vertex.position[i] = toSnorm16((position[i] - quantization.offset[i]) / quantization.scale[i]);
+    }
+    vertex.position[3] = 0;
+
+    // Octahedral mapping: project onto |x|+|y|+|z| = 1 and fold the lower half over the diagonals
+    float l1 = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    vec3 n = l1 > 0.0f ? normal / l1 : vec3(0.0f, 0.0f, 1.0f);
+    float ex = n.x;
+    float ey = n.y;
+    if (n.z < 0.0f) {
+        ex = (1.0f - std::fabs(n.y)) * signNotZero(n.x);
+        ey = (1.0f - std::fabs(n.x)) * signNotZero(n.y);
+    }
+    vertex.normal[0] = toSnorm16(ex);
+    vertex.normal[1] = toSnorm16(ey);
+
+    vertex.texCoord[0] = toHalf(texCoord.x);
+    vertex.texCoord[1] = toHalf(texCoord.y);
+    return vertex;
+}
+
+void setPackedVertexAttributes() {
+    const GLsizei stride = sizeof(PackedVertex);
+
+    // Same locations as the float layout: the shaders only switch how they decode them
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, position));
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, texCoord));
+
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, normal));
+}
+
+void enableInstanceMatrixAttributes() {
+    // One column per attribute location, advanced once per instance
+    for (GLuint column = 0; column < 4; ++column) {
+        glEnableVertexAttribArray(5 + column);
+        glVertexAttribDivisor(5 + column, 1);
+    }
+}
+
+void setInstanceMatrixAttributes(GLsizei firstInstance) {
+    for (GLuint column = 0; column < 4; ++column) {
+        size_t offset = sizeof(mat4) * firstInstance + sizeof(vec4) * column;
+        glVertexAttribPointer(5 + column, 4, GL_FLOAT, GL_FALSE, sizeof(mat4), (void*)offset);
+    }
+}
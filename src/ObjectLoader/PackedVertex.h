@@ -0,0 +1,36 @@
+#ifndef PACKED_VERTEX_H
+#define PACKED_VERTEX_H
+
+#include "Angel.h"
+#include <cstdint>
+
+// Object vertex as stored in GL and in the mesh cache: 16 bytes instead of
+// 13 floats. vshader.glsl / shadow_vshader.glsl decode it when u_packedVertex is set.
+struct PackedVertex {
+    int16_t position[4];   // snorm16 inside the model's quantization box; w holds the texture array layer, if any
+    int16_t normal[2];     // Octahedral-encoded unit normal, snorm16
+    uint16_t texCoord[2];  // Half floats, so tiling UVs outside [0,1] survive
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay tightly packed");
+
+// Model-space position = offset + decoded snorm * scale (uploaded as u_positionOffset/u_positionScale)
+struct VertexQuantization {
+    vec3 offset = vec3(0.0f);
+    vec3 scale = vec3(1.0f);
+
+    static VertexQuantization fromBounds(const vec3& boundsMin, const vec3& boundsMax);
+};
+
+PackedVertex packVertex(const vec3& position, const vec3& normal, const vec2& texCoord,
+                        const VertexQuantization& quantization);
+
+// Points attributes 0-2 of the bound VAO at the bound GL_ARRAY_BUFFER of PackedVertex
+void setPackedVertexAttributes();
+
+// Per-instance model matrices (column-major mat4s) at attributes 5-8, for every mesh drawn
+// by the object shaders: enable them on the bound VAO, then point them at instance
+// firstInstance of the bound GL_ARRAY_BUFFER
+void enableInstanceMatrixAttributes();
+void setInstanceMatrixAttributes(GLsizei firstInstance);
+
+#endif // PACKED_VERTEX_H
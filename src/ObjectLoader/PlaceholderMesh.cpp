@@ -0,0 +1,126 @@
+#include "PlaceholderMesh.h"
+#include <algorithm>
+#include "../Core/GLStateCache.h"
+
+PlaceholderMesh::PlaceholderMesh() {
+    vao = vbo = ebo = instanceVBO = 0;
+    textureID = 0;
+    indexCount = 0;
+    instanceCount = 0;
+    instanceCapacity = 0;
+    instanceAttributeBase = 0;
+}
+
+PlaceholderMesh::~PlaceholderMesh() {
+    GLStateCache::GetInstance().DeleteVertexArray(vao);
+    if (vbo != 0) glDeleteBuffers(1, &vbo);
+    if (ebo != 0) glDeleteBuffers(1, &ebo);
+    if (instanceVBO != 0) glDeleteBuffers(1, &instanceVBO);
+    GLStateCache::GetInstance().DeleteTexture(textureID);
+}
+
+void PlaceholderMesh::create() {
+    // Cube from (0,0,0) to (1,1,1), 4 vertices per face for flat normals,
+    // in the same PackedVertex layout as ObjectLoader so the object shaders apply
+    // Each face is spanned by u and v = n x u, so (u, v) is counter-clockwise seen from outside
+    const vec3 faceNormals[6] = {
+        vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1)
+    };
+    const vec3 faceTangents[6] = {
+        vec3(0, 1, 0), vec3(0, 1, 0), vec3(0, 0, 1), vec3(0, 0, 1), vec3(1, 0, 0), vec3(1, 0, 0)
+    };
+    quantization = VertexQuantization::fromBounds(vec3(0.0f), vec3(1.0f));
+    std::vector<PackedVertex> vertices;
+    std::vector<unsigned int> indices;
+    for (int face = 0; face < 6; ++face) {
+        vec3 n = faceNormals[face];
+        vec3 u = faceTangents[face];
+        vec3 v = cross(n, u);
+        vec3 center = vec3(0.5f, 0.5f, 0.5f) + n * 0.5f;
+        unsigned int base = static_cast<unsigned int>(vertices.size());
+        const float corners[4][2] = { {-1, -1}, {1, -1}, {1, 1}, {-1, 1} };
+        for (const auto& c : corners) {
+            vec3 p = center + u * (0.5f * c[0]) + v * (0.5f * c[1]);
+            vec2 uv((c[0] + 1) * 0.5f, (c[1] + 1) * 0.5f);
+            vertices.push_back(packVertex(p, n, uv, quantization));
+        }
+        indices.insert(indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+    }
+    indexCount = static_cast<GLsizei>(indices.size());
+
+    glGenTextures(1, &textureID);
+    GLStateCache::GetInstance().BindTexture(GL_TEXTURE_2D, textureID);
+    unsigned char greyPixel[] = {160, 160, 160, 255};
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, greyPixel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    glGenBuffers(1, &instanceVBO);
+
+    GLStateCache::GetInstance().BindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(PackedVertex), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+    setPackedVertexAttributes();
+
+    enableInstanceMatrixAttributes();
+    instanceAttributeBase = -1;
+    setInstanceAttributeBase(0);
+
+    GLStateCache::GetInstance().BindVertexArray(0);
+}
+
+void PlaceholderMesh::updateInstanceBuffer(const std::vector<mat4>& modelMatrices) {
+    instanceCount = static_cast<GLsizei>(modelMatrices.size());
+    if (modelMatrices.empty()) return;
+    if (vao == 0) create();
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if (modelMatrices.size() > instanceCapacity) {
+        instanceCapacity = std::max(modelMatrices.size(), instanceCapacity * 2);
+    }
+    // Orphan last frame's storage so the upload doesn't wait on draws still using it
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(mat4), nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, modelMatrices.size() * sizeof(mat4), modelMatrices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void PlaceholderMesh::setInstanceAttributeBase(GLsizei firstInstance) {
+    if (firstInstance == instanceAttributeBase) return;
+
+    // No base-instance draws here, so offset the attributes instead
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    setInstanceMatrixAttributes(firstInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    instanceAttributeBase = firstInstance;
+}
+
+void PlaceholderMesh::enqueue(RenderQueue& queue, unsigned int pass, const Shader& program,
+                              const ObjectRenderUniforms& uniforms, GLsizei firstInstance, GLsizei count) {
+    if (count == 0 || vao == 0) return;
+
+    RenderPacket packet;
+    packet.shader = &program;
+    packet.vertexArray = vao;
+    packet.texture = uniforms.objectTexture.isValid() ? textureID : 0;
+    packet.source = this;
+    packet.context = &uniforms;
+    packet.args[0] = 0;
+    packet.args[1] = static_cast<uint32_t>(firstInstance);
+    packet.args[2] = static_cast<uint32_t>(count);
+    packet.key = RenderQueue::MakeKey(pass, program.getProgramID(), packet.texture, vao, 0.0f);
+    queue.Add(packet);
+}
+
+void PlaceholderMesh::Draw(const RenderPacket& packet, bool continuing) {
+    if (!continuing) {
+        static_cast<const ObjectRenderUniforms*>(packet.context)->setObjectState(*packet.shader, quantization, false, false);
+    }
+    setInstanceAttributeBase(static_cast<GLsizei>(packet.args[1]));
+    glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0, static_cast<GLsizei>(packet.args[2]));
+}
@@ -0,0 +1,35 @@
+#ifndef PLACEHOLDER_MESH_H
+#define PLACEHOLDER_MESH_H
+
+#include "Angel.h"
+#include <vector>
+#include "ObjectLoader.h"
+
+// Unit cube drawn in place of objects whose model is still loading. Each instance
+// matrix maps the cube onto the object's bounding box. GL objects are created on first use.
+class PlaceholderMesh : public RenderSource {
+public:
+    PlaceholderMesh();
+    ~PlaceholderMesh();
+
+    // Same contract as ObjectLoader::updateInstanceBuffer: column-major matrices
+    void updateInstanceBuffer(const std::vector<mat4>& modelMatrices);
+    // Queues one packet drawing count instances from firstInstance
+    void enqueue(RenderQueue& queue, unsigned int pass, const Shader& program, const ObjectRenderUniforms& uniforms,
+                 GLsizei firstInstance, GLsizei count);
+    void Draw(const RenderPacket& packet, bool continuing) override;
+
+private:
+    void create();
+    void setInstanceAttributeBase(GLsizei firstInstance);
+
+    GLuint vao, vbo, ebo, instanceVBO;
+    GLuint textureID; // Flat grey so placeholders read as such
+    VertexQuantization quantization;
+    GLsizei indexCount;
+    GLsizei instanceCount;
+    size_t instanceCapacity;
+    GLsizei instanceAttributeBase; // First instance the VAO's instance attributes point at
+};
+
+#endif // PLACEHOLDER_MESH_H
@@ -0,0 +1,40 @@
+#include "ScatterInstance.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+
+uint16_t toUnorm16(float value) {
+    value = std::max(0.0f, std::min(1.0f, value));
+    return static_cast<uint16_t>(std::lround(value * 65535.0f));
+}
+
+}
+
+ScatterInstance packScatterInstance(const vec3& position, float yawRadians, float scale) {
+    const float turn = 2.0f * static_cast<float>(M_PI);
+    float yawTurns = std::fmod(yawRadians, turn) / turn;
+    if (yawTurns < 0.0f) yawTurns += 1.0f;
+
+    ScatterInstance instance;
+    instance.position[0] = position.x;
+    instance.position[1] = position.y;
+    instance.position[2] = position.z;
+    instance.yaw = toUnorm16(yawTurns);
+    instance.scale = toUnorm16(scale / SCATTER_MAX_SCALE);
+    return instance;
+}
+
+float scatterInstanceScale(const ScatterInstance& instance) {
+    return instance.scale * (SCATTER_MAX_SCALE / 65535.0f);
+}
+
+void setScatterInstanceAttributes(GLsizei firstInstance) {
+    const GLsizei stride = sizeof(ScatterInstance);
+    const size_t base = static_cast<size_t>(firstInstance) * stride;
+
+    glVertexAttribPointer(9, 3, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(ScatterInstance, position)));
+    // Yaw and scale share one normalized vec2
+    glVertexAttribPointer(10, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)(base + offsetof(ScatterInstance, yaw)));
+}
@@ -0,0 +1,26 @@
+#ifndef SCATTER_INSTANCE_H
+#define SCATTER_INSTANCE_H
+
+#include "Angel.h"
+#include <cstdint>
+
+// Largest per-instance scale a ScatterInstance can store (on top of the asset's base transform)
+const float SCATTER_MAX_SCALE = 4.0f;
+
+// One brush-scattered copy of a model: 16 bytes instead of a 64-byte matrix.
+// vshader.glsl / shadow_vshader.glsl rebuild Translate * RotateY(yaw) * Scale from it
+// when u_scatter is set, reading it at attribute locations 9-10.
+struct ScatterInstance {
+    float position[3];  // World space, base on the terrain
+    uint16_t yaw;       // unorm16 fraction of a full turn
+    uint16_t scale;     // unorm16 fraction of SCATTER_MAX_SCALE
+};
+static_assert(sizeof(ScatterInstance) == 16, "ScatterInstance must stay tightly packed");
+
+ScatterInstance packScatterInstance(const vec3& position, float yawRadians, float scale);
+float scatterInstanceScale(const ScatterInstance& instance);
+
+// Points attributes 9-10 of the bound VAO at instance firstInstance of the bound GL_ARRAY_BUFFER
+void setScatterInstanceAttributes(GLsizei firstInstance);
+
+#endif // SCATTER_INSTANCE_H
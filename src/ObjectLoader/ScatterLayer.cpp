@@ -0,0 +1,534 @@
+#include "ScatterLayer.h"
+#include <algorithm>
+#include <array>
+
+namespace {
+// Candidates tried around each active sample before it is retired (Bridson's k)
+const int CANDIDATES_PER_SAMPLE = 24;
+// Candidates sit just past the minimum distance, which packs tighter in fewer tries
+// than Bridson's random annulus (Roberts' variant)
+const float CANDIDATE_DISTANCE = 1.0001f;
+// Consecutive random seeds that must fail before the brush counts as full
+const int SEED_ATTEMPTS = 64;
+// Largest side of the per-stroke sampling grid; wider brushes get a coarser spacing
+const int MAX_SAMPLING_GRID = 2048;
+// Fills the cells of the sampling grid without a sample: far enough from any point to pass
+// the distance tests, yet its squared distance still fits in a float
+const vec2 EMPTY_SAMPLE(-1e18f, -1e18f);
+}
+
+ScatterLayer::ScatterLayer() : instanceCount(0), random(0x5CA77E2u) {
+
+}
+
+ScatterLayer::~ScatterLayer() {
+    for (Asset& asset : assets) {
+        if (asset.instanceBuffer != 0) glDeleteBuffers(1, &asset.instanceBuffer);
+    }
+}
+
+uint64_t ScatterLayer::ChunkKey(int x, int z) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z);
+}
+
+ScatterLayer::Chunk& ScatterLayer::ChunkAt(int x, int z) {
+    auto it = chunkIndices.find(ChunkKey(x, z));
+    if (it != chunkIndices.end()) return chunks[it->second];
+
+    chunkIndices.emplace(ChunkKey(x, z), chunks.size());
+    chunks.emplace_back();
+    Chunk& chunk = chunks.back();
+    chunk.x = x;
+    chunk.z = z;
+    chunk.instances.resize(assets.size());
+    chunk.first.assign(assets.size(), 0);
+    chunk.lods.assign(assets.size(), 0);
+    chunk.maxScale = 0.0f;
+    chunk.instanceTotal = 0;
+    chunk.boundsDirty = true;
+    chunk.distance = 0.0f;
+    chunk.inMain = chunk.inShadow = false;
+    return chunk;
+}
+
+size_t ScatterLayer::AssetIndex(ObjectLoader& objectLoader, const mat4& baseTransform) {
+    for (size_t i = 0; i < assets.size(); ++i) {
+        if (assets[i].objectLoader == &objectLoader) return i;
+    }
+
+    Asset asset;
+    asset.objectLoader = &objectLoader;
+    asset.baseTransform = baseTransform;
+    asset.instanceBuffer = 0;
+    asset.bufferCapacity = 0;
+    asset.dirty = false;
+    UpdateReach(asset);
+    assets.push_back(asset);
+    for (Chunk& chunk : chunks) {
+        chunk.instances.emplace_back();
+        chunk.first.push_back(0);
+        chunk.lods.push_back(0);
+    }
+    return assets.size() - 1;
+}
+
+void ScatterLayer::UpdateReach(Asset& asset) {
+    // The default box until the model is resident, like GameObject::GetWorldBounds
+    vec3 boxMin = asset.objectLoader->GetBoundingBoxMin();
+    vec3 boxMax = boxMin + asset.objectLoader->GetBoundingBoxSize();
+
+    float radius = 0.0f;
+    float minY = 0.0f, maxY = 0.0f;
+    for (int corner = 0; corner < 8; ++corner) {
+        vec4 p = asset.baseTransform * vec4(corner & 1 ? boxMax.x : boxMin.x,
+                                            corner & 2 ? boxMax.y : boxMin.y,
+                                            corner & 4 ? boxMax.z : boxMin.z, 1.0f);
+        radius = std::max(radius, std::sqrt(p.x * p.x + p.z * p.z));
+        minY = corner == 0 ? p.y : std::min(minY, p.y);
+        maxY = corner == 0 ? p.y : std::max(maxY, p.y);
+    }
+    // Yaw spins the box about the instance origin, so only a circle in xz bounds it
+    asset.reachMin = vec3(-radius, minY, -radius);
+    asset.reachMax = vec3(radius, maxY, radius);
+    asset.resident = asset.objectLoader->isResident();
+}
+
+size_t ScatterLayer::Scatter(ObjectLoader& objectLoader, const mat4& baseTransform, const TerrainGrid& terrain,
+                             float centerX, float centerZ, float radius, const BrushSettings& brush) {
+    const size_t assetIndex = AssetIndex(objectLoader, baseTransform);
+
+    // Bridson's Poisson-disk sampling. New samples go in a grid of cells with diagonal
+    // `spacing`, so a cell holds at most one and every sample within twice the spacing of
+    // a point lies in the 7x7 cells around it. The grid reaches three cells past the brush
+    // circle, which keeps those lookups in bounds without clamping.
+    const float spacing = std::max({ brush.spacing, 0.01f, std::sqrt(2.0f) * 2.0f * radius / (MAX_SAMPLING_GRID - 8) });
+    const float spacingSquared = spacing * spacing;
+    const float sampleCellSize = spacing / std::sqrt(2.0f);
+    const float inverseSampleCellSize = 1.0f / sampleCellSize;
+    const float sampleOriginX = centerX - radius - 3.0f * sampleCellSize;
+    const float sampleOriginZ = centerZ - radius - 3.0f * sampleCellSize;
+    const int sampleGridSize = static_cast<int>(std::ceil(2.0f * radius / sampleCellSize)) + 7;
+    sampleGrid.assign(static_cast<size_t>(sampleGridSize) * sampleGridSize, EMPTY_SAMPLE);
+    auto sampleCellOf = [&](const vec2& p) {
+        return static_cast<int>((p.y - sampleOriginZ) * inverseSampleCellSize) * sampleGridSize +
+               static_cast<int>((p.x - sampleOriginX) * inverseSampleCellSize);
+    };
+
+    // Instances already around the brush (of any asset) block their neighbourhood.
+    // Earlier strokes may have used a smaller spacing, so they are bucketed, without a
+    // cap, by cells of side `spacing` and looked up in the 3x3 around a candidate.
+    const float originX = centerX - radius - spacing;
+    const float originZ = centerZ - radius - spacing;
+    const int gridSize = static_cast<int>(std::ceil((2.0f * (radius + spacing)) / spacing));
+    auto cellOf = [&](const vec2& p, int& cellX, int& cellZ) {
+        cellX = std::min(std::max(static_cast<int>((p.x - originX) / spacing), 0), gridSize - 1);
+        cellZ = std::min(std::max(static_cast<int>((p.y - originZ) / spacing), 0), gridSize - 1);
+    };
+    blockers.clear();
+    const float gridEndX = originX + gridSize * spacing;
+    const float gridEndZ = originZ + gridSize * spacing;
+    for (int chunkZ = ChunkCoord(originZ); chunkZ <= ChunkCoord(gridEndZ); ++chunkZ) {
+        for (int chunkX = ChunkCoord(originX); chunkX <= ChunkCoord(gridEndX); ++chunkX) {
+            auto it = chunkIndices.find(ChunkKey(chunkX, chunkZ));
+            if (it == chunkIndices.end()) continue;
+            for (const std::vector<ScatterInstance>& instances : chunks[it->second].instances) {
+                for (const ScatterInstance& instance : instances) {
+                    vec2 p(instance.position[0], instance.position[2]);
+                    if (p.x >= originX && p.x < gridEndX && p.y >= originZ && p.y < gridEndZ) {
+                        blockers.push_back(p);
+                    }
+                }
+            }
+        }
+    }
+    // Counting sort: cell totals, their running sums (each cell's end), then every
+    // blocker placed just below its cell's end, which leaves each cell's start
+    const size_t cellCount = blockers.empty() ? 0 : static_cast<size_t>(gridSize) * gridSize;
+    blockerCellStart.assign(cellCount + 1, 0);
+    for (const vec2& p : blockers) {
+        int cellX, cellZ;
+        cellOf(p, cellX, cellZ);
+        ++blockerCellStart[cellZ * gridSize + cellX];
+    }
+    for (size_t cell = 0; cell < cellCount; ++cell) {
+        blockerCellStart[cell + 1] += blockerCellStart[cell];
+    }
+    blockersByCell.resize(blockers.size());
+    for (const vec2& p : blockers) {
+        int cellX, cellZ;
+        cellOf(p, cellX, cellZ);
+        blockersByCell[--blockerCellStart[cellZ * gridSize + cellX]] = p;
+    }
+
+    const float terrainMaxX = (terrain.GetWidth() - 1) * terrain.GetWorldScale();
+    const float terrainMaxZ = (terrain.GetDepth() - 1) * terrain.GetWorldScale();
+    auto outside = [&](float x, float z) {
+        float dx = x - centerX, dz = z - centerZ;
+        return (dx * dx + dz * dz > radius * radius) | (x < 0.0f) | (z < 0.0f) | (x > terrainMaxX) | (z > terrainMaxZ);
+    };
+    auto blocked = [&](const vec2& p) {
+        if (blockers.empty()) return false;
+        int cellX, cellZ;
+        cellOf(p, cellX, cellZ);
+        for (int z = std::max(cellZ - 1, 0); z <= std::min(cellZ + 1, gridSize - 1); ++z) {
+            for (int x = std::max(cellX - 1, 0); x <= std::min(cellX + 1, gridSize - 1); ++x) {
+                int cell = z * gridSize + x;
+                for (int b = blockerCellStart[cell]; b < blockerCellStart[cell + 1]; ++b) {
+                    vec2 d = blockersByCell[b] - p;
+                    if (dot(d, d) < spacingSquared) return true;
+                }
+            }
+        }
+        return false;
+    };
+    auto fits = [&](const vec2& p) {
+        if (outside(p.x, p.y)) return false;
+        const vec2* cell = &sampleGrid[sampleCellOf(p)];
+        for (int z = -2; z <= 2; ++z) {
+            for (int x = -2; x <= 2; ++x) {
+                // Empty cells hold a point far enough away to pass
+                vec2 d = cell[z * sampleGridSize + x] - p;
+                if (dot(d, d) < spacingSquared) return false;
+            }
+        }
+        return !blocked(p);
+    };
+    auto accept = [&](const vec2& p) {
+        sampleGrid[sampleCellOf(p)] = p;
+        activeSamples.push_back(candidates.size());
+        candidates.push_back(p);
+    };
+
+    candidates.clear();
+    activeSamples.clear();
+    const float turn = 2.0f * static_cast<float>(M_PI);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::array<vec2, CANDIDATES_PER_SAMPLE> candidateDirections;
+    for (int i = 0; i < CANDIDATES_PER_SAMPLE; ++i) {
+        float angle = turn * i / CANDIDATES_PER_SAMPLE;
+        candidateDirections[i] = vec2(std::cos(angle), std::sin(angle));
+    }
+    // A sample's candidates are tested together. Candidate i sits at around + offset_i,
+    // with |offset_i| = candidateDistance, and is too close to a sample q exactly when
+    //   2 offset_i . (q - around) > |q - around|^2 + candidateDistance^2 - spacing^2,
+    // so each sample near `around` costs one dot product per candidate, in loops the
+    // compiler vectorizes. Retiring a sample then takes one pass instead of k lookups.
+    const float candidateDistance = spacing * CANDIDATE_DISTANCE;
+    const float conflictBias = candidateDistance * candidateDistance - spacingSquared;
+    std::array<float, CANDIDATES_PER_SAMPLE> offsetX, offsetZ;
+    std::array<int, CANDIDATES_PER_SAMPLE> rejected;
+    std::array<float, 49> nearbyX, nearbyZ;
+    // Seed anywhere in the brush, grow from there, and reseed for regions the growth
+    // couldn't reach (gaps between earlier strokes)
+    for (int failures = 0; failures < SEED_ATTEMPTS; ) {
+        float seedAngle = unit(random) * turn;
+        float seedDistance = radius * std::sqrt(unit(random));
+        vec2 seed(centerX + std::cos(seedAngle) * seedDistance, centerZ + std::sin(seedAngle) * seedDistance);
+        if (!fits(seed)) {
+            ++failures;
+            continue;
+        }
+        failures = 0;
+        accept(seed);
+
+        while (!activeSamples.empty()) {
+            size_t active = static_cast<size_t>(unit(random) * activeSamples.size()) % activeSamples.size();
+            const vec2 around = candidates[activeSamples[active]];
+            // Evenly spaced directions from a random start, rotated out of the fixed table
+            float start = unit(random) * turn;
+            float startCos = std::cos(start) * candidateDistance;
+            float startSin = std::sin(start) * candidateDistance;
+            for (int i = 0; i < CANDIDATES_PER_SAMPLE; ++i) {
+                offsetX[i] = startCos * candidateDirections[i].x - startSin * candidateDirections[i].y;
+                offsetZ[i] = startSin * candidateDirections[i].x + startCos * candidateDirections[i].y;
+                rejected[i] = outside(around.x + offsetX[i], around.y + offsetZ[i]);
+            }
+            // The new samples in the 7x7 cells around `around`: all that are within reach of a
+            // candidate, with room to spare for rounding
+            int nearbyCount = 0;
+            const vec2* cell = &sampleGrid[sampleCellOf(around)];
+            for (int z = -3; z <= 3; ++z) {
+                for (int x = -3; x <= 3; ++x) {
+                    const vec2& sample = cell[z * sampleGridSize + x];
+                    nearbyX[nearbyCount] = sample.x;
+                    nearbyZ[nearbyCount] = sample.y;
+                    nearbyCount += sample.x != EMPTY_SAMPLE.x;
+                }
+            }
+            for (int n = 0; n < nearbyCount; ++n) {
+                float wx = nearbyX[n] - around.x, wz = nearbyZ[n] - around.y;
+                float limit = 0.5f * (wx * wx + wz * wz + conflictBias);
+                for (int i = 0; i < CANDIDATES_PER_SAMPLE; ++i) {
+                    rejected[i] |= offsetX[i] * wx + offsetZ[i] * wz > limit;
+                }
+            }
+            // The first candidate left, as trying them in turn would find. It is tested once
+            // more as stored, since rounding its position can move it by a float ulp (which
+            // can bring it under the spacing even from `around`).
+            bool found = false;
+            for (int i = 0; i < CANDIDATES_PER_SAMPLE && !found; ++i) {
+                if (rejected[i]) continue;
+                vec2 candidate(around.x + offsetX[i], around.y + offsetZ[i]);
+                bool tooClose = false;
+                for (int n = 0; n < nearbyCount; ++n) {
+                    float dx = nearbyX[n] - candidate.x, dz = nearbyZ[n] - candidate.y;
+                    tooClose |= dx * dx + dz * dz < spacingSquared;
+                }
+                if (!tooClose && !blocked(candidate)) {
+                    accept(candidate);
+                    found = true;
+                }
+            }
+            if (!found) {
+                activeSamples[active] = activeSamples.back();
+                activeSamples.pop_back();
+            }
+        }
+    }
+    if (candidates.empty()) return 0;
+
+    // Ground heights for the whole stroke in one batch
+    heights.resize(candidates.size());
+    terrain.GetHeightsAtWorldPos(candidates.data(), heights.data(), candidates.size());
+
+    const float minScale = std::min(std::max(brush.minScale, 0.0f), SCATTER_MAX_SCALE);
+    const float maxScale = std::min(std::max(brush.maxScale, minScale), SCATTER_MAX_SCALE);
+    Chunk* chunk = nullptr; // Samples grow outwards, so neighbours in the list mostly share a chunk
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        const vec2& p = candidates[i];
+        float yaw = unit(random) * turn;
+        float scale = minScale + (maxScale - minScale) * unit(random);
+        int chunkX = ChunkCoord(p.x), chunkZ = ChunkCoord(p.y);
+        if (!chunk || chunk->x != chunkX || chunk->z != chunkZ) chunk = &ChunkAt(chunkX, chunkZ);
+        chunk->instances[assetIndex].push_back(packScatterInstance(vec3(p.x, heights[i], p.y), yaw, scale));
+        chunk->boundsDirty = true;
+    }
+    assets[assetIndex].dirty = true;
+    instanceCount += candidates.size();
+    return candidates.size();
+}
+
+void ScatterLayer::Add(ObjectLoader& objectLoader, const mat4& baseTransform,
+                       const ScatterInstance* instances, size_t count) {
+    if (count == 0) return;
+    const size_t assetIndex = AssetIndex(objectLoader, baseTransform);
+    for (size_t i = 0; i < count; ++i) {
+        const ScatterInstance& instance = instances[i];
+        Chunk& chunk = ChunkAt(ChunkCoord(instance.position[0]), ChunkCoord(instance.position[2]));
+        chunk.instances[assetIndex].push_back(instance);
+        chunk.boundsDirty = true;
+    }
+    assets[assetIndex].dirty = true;
+    instanceCount += count;
+}
+
+size_t ScatterLayer::Erase(float centerX, float centerZ, float radius, const ObjectLoader* objectLoader) {
+    const float radiusSquared = radius * radius;
+    size_t erased = 0;
+    for (int chunkZ = ChunkCoord(centerZ - radius); chunkZ <= ChunkCoord(centerZ + radius); ++chunkZ) {
+        for (int chunkX = ChunkCoord(centerX - radius); chunkX <= ChunkCoord(centerX + radius); ++chunkX) {
+            auto it = chunkIndices.find(ChunkKey(chunkX, chunkZ));
+            if (it == chunkIndices.end()) continue;
+            Chunk& chunk = chunks[it->second];
+            for (size_t assetIndex = 0; assetIndex < assets.size(); ++assetIndex) {
+                if (objectLoader && assets[assetIndex].objectLoader != objectLoader) continue;
+                std::vector<ScatterInstance>& instances = chunk.instances[assetIndex];
+                size_t before = instances.size();
+                instances.erase(std::remove_if(instances.begin(), instances.end(), [&](const ScatterInstance& instance) {
+                    float dx = instance.position[0] - centerX, dz = instance.position[2] - centerZ;
+                    return dx * dx + dz * dz <= radiusSquared;
+                }), instances.end());
+                if (instances.size() != before) {
+                    erased += before - instances.size();
+                    assets[assetIndex].dirty = true;
+                    chunk.boundsDirty = true;
+                }
+            }
+        }
+    }
+    instanceCount -= erased;
+    return erased;
+}
+
+void ScatterLayer::FollowTerrainEdits(const TerrainGrid& terrain, const TerrainNormals::Rect& edited) {
+    // Interpolated heights change in the cells around the edited vertices too
+    const float worldScale = terrain.GetWorldScale();
+    const float minX = (edited.minX - 1) * worldScale, maxX = (edited.maxX + 1) * worldScale;
+    const float minZ = (edited.minZ - 1) * worldScale, maxZ = (edited.maxZ + 1) * worldScale;
+
+    followed.clear();
+    candidates.clear();
+    for (int chunkZ = ChunkCoord(minZ); chunkZ <= ChunkCoord(maxZ); ++chunkZ) {
+        for (int chunkX = ChunkCoord(minX); chunkX <= ChunkCoord(maxX); ++chunkX) {
+            auto it = chunkIndices.find(ChunkKey(chunkX, chunkZ));
+            if (it == chunkIndices.end()) continue;
+            Chunk& chunk = chunks[it->second];
+            for (size_t assetIndex = 0; assetIndex < assets.size(); ++assetIndex) {
+                bool moved = false;
+                for (ScatterInstance& instance : chunk.instances[assetIndex]) {
+                    if (instance.position[0] < minX || instance.position[0] > maxX ||
+                        instance.position[2] < minZ || instance.position[2] > maxZ) continue;
+                    followed.push_back(&instance);
+                    candidates.push_back(vec2(instance.position[0], instance.position[2]));
+                    moved = true;
+                }
+                if (moved) {
+                    assets[assetIndex].dirty = true;
+                    chunk.boundsDirty = true;
+                }
+            }
+        }
+    }
+    if (followed.empty()) return;
+
+    heights.resize(candidates.size());
+    terrain.GetHeightsAtWorldPos(candidates.data(), heights.data(), candidates.size());
+    for (size_t i = 0; i < followed.size(); ++i) {
+        followed[i]->position[1] = heights[i];
+    }
+}
+
+void ScatterLayer::UpdateBounds(Chunk& chunk) {
+    chunk.instanceTotal = 0;
+    chunk.maxScale = 0.0f;
+    bool first = true;
+    for (size_t assetIndex = 0; assetIndex < assets.size(); ++assetIndex) {
+        const Asset& asset = assets[assetIndex];
+        for (const ScatterInstance& instance : chunk.instances[assetIndex]) {
+            float scale = scatterInstanceScale(instance);
+            vec3 position(instance.position[0], instance.position[1], instance.position[2]);
+            vec3 boundsMin = position + asset.reachMin * scale;
+            vec3 boundsMax = position + asset.reachMax * scale;
+            if (first) {
+                chunk.boundsMin = boundsMin;
+                chunk.boundsMax = boundsMax;
+                first = false;
+            } else {
+                for (int axis = 0; axis < 3; ++axis) {
+                    chunk.boundsMin[axis] = std::min(chunk.boundsMin[axis], boundsMin[axis]);
+                    chunk.boundsMax[axis] = std::max(chunk.boundsMax[axis], boundsMax[axis]);
+                }
+            }
+            chunk.maxScale = std::max(chunk.maxScale, scale);
+        }
+        chunk.instanceTotal += chunk.instances[assetIndex].size();
+    }
+    if (first) {
+        chunk.boundsMin = chunk.boundsMax = vec3(0.0f);
+    }
+    chunk.boundsDirty = false;
+}
+
+void ScatterLayer::Upload(size_t assetIndex) {
+    Asset& asset = assets[assetIndex];
+    asset.dirty = false;
+
+    // Chunks back to back, in chunk order, so each is one contiguous range
+    uploadScratch.clear();
+    for (Chunk& chunk : chunks) {
+        chunk.first[assetIndex] = static_cast<GLsizei>(uploadScratch.size());
+        uploadScratch.insert(uploadScratch.end(), chunk.instances[assetIndex].begin(), chunk.instances[assetIndex].end());
+    }
+    if (uploadScratch.empty()) return;
+
+    if (asset.instanceBuffer == 0) glGenBuffers(1, &asset.instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, asset.instanceBuffer);
+    if (uploadScratch.size() > asset.bufferCapacity) {
+        // Grow geometrically so a long stroke doesn't reallocate at every dab
+        asset.bufferCapacity = std::max(uploadScratch.size(), asset.bufferCapacity * 2);
+    }
+    // Orphan the old storage so the upload doesn't wait on draws still using it
+    glBufferData(GL_ARRAY_BUFFER, asset.bufferCapacity * sizeof(ScatterInstance), nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, uploadScratch.size() * sizeof(ScatterInstance), uploadScratch.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ScatterLayer::UpdateVisibility(const FrustumCulling::Frustum& mainFrustum, const FrustumCulling::Frustum& shadowFrustum,
+                                   const vec3& cameraPosition, float pixelsPerUnit) {
+    for (size_t assetIndex = 0; assetIndex < assets.size(); ++assetIndex) {
+        Asset& asset = assets[assetIndex];
+        if (asset.resident != asset.objectLoader->isResident()) {
+            // The loaded model replaces the default box every chunk was bounded with
+            UpdateReach(asset);
+            for (Chunk& chunk : chunks) chunk.boundsDirty = true;
+        }
+        if (asset.dirty) Upload(assetIndex);
+    }
+
+    chunkBounds.Clear();
+    for (Chunk& chunk : chunks) {
+        if (chunk.boundsDirty) UpdateBounds(chunk);
+        chunkBounds.Push(chunk.boundsMin, chunk.boundsMax);
+    }
+    FrustumCulling::CullBoxes(mainFrustum, chunkBounds, visibleInMain);
+    FrustumCulling::CullBoxes(shadowFrustum, chunkBounds, visibleInShadow);
+
+    stats = Stats();
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        Chunk& chunk = chunks[i];
+        chunk.inMain = chunk.instanceTotal > 0 && visibleInMain[i] != 0;
+        chunk.inShadow = chunk.instanceTotal > 0 && visibleInShadow[i] != 0;
+        if (chunk.instanceTotal == 0) continue;
+        if (!chunk.inMain) {
+            ++stats.chunksCulled;
+            continue;
+        }
+        ++stats.chunksSubmitted;
+        stats.instances += static_cast<unsigned int>(chunk.instanceTotal);
+
+        // The chunk's nearest point decides, so no instance in it is drawn too coarse
+        vec3 nearest;
+        for (int axis = 0; axis < 3; ++axis) {
+            nearest[axis] = std::min(std::max(cameraPosition[axis], chunk.boundsMin[axis]), chunk.boundsMax[axis]);
+        }
+        float distance = length(nearest - cameraPosition);
+        chunk.distance = distance;
+        for (size_t assetIndex = 0; assetIndex < assets.size(); ++assetIndex) {
+            if (chunk.instances[assetIndex].empty()) continue;
+            const Asset& asset = assets[assetIndex];
+            float radius = 0.5f * length(asset.reachMax - asset.reachMin) * chunk.maxScale;
+            float screenSize = 2.0f * radius * pixelsPerUnit / std::max(distance, radius);
+            chunk.lods[assetIndex] = ObjectLoader::selectLod(screenSize, chunk.lods[assetIndex]);
+        }
+    }
+}
+
+void ScatterLayer::Enqueue(RenderQueue& queue, const Shader& shader, const ObjectRenderUniforms& uniforms,
+                           bool shadowPass, int lodBias) {
+    if (instanceCount == 0) return;
+
+    const unsigned int pass = shadowPass ? RenderQueue::SHADOW_PASS : RenderQueue::MAIN_PASS;
+    for (size_t assetIndex = 0; assetIndex < assets.size(); ++assetIndex) {
+        Asset& asset = assets[assetIndex];
+        if (!asset.objectLoader->isResident() || asset.instanceBuffer == 0) continue;
+        ScatterDrawContext& context = asset.drawContexts[shadowPass ? 1 : 0];
+        context.uniforms = &uniforms;
+        context.instanceBuffer = asset.instanceBuffer;
+        context.baseTransform = asset.baseTransform;
+        context.maxScale = SCATTER_MAX_SCALE;
+
+        // Adjacent visible chunks at the same LOD are adjacent in the buffer too: one draw
+        GLsizei runFirst = 0, runCount = 0;
+        int runLod = 0;
+        float runDistance = 0.0f;
+        for (const Chunk& chunk : chunks) {
+            const GLsizei count = static_cast<GLsizei>(chunk.instances[assetIndex].size());
+            const bool visible = (shadowPass ? chunk.inShadow : chunk.inMain) && count > 0;
+            const int lod = std::min(chunk.lods[assetIndex] + std::max(lodBias, 0), MESH_LOD_COUNT - 1);
+            if (visible && runCount > 0 && lod == runLod && chunk.first[assetIndex] == runFirst + runCount) {
+                runCount += count;
+                runDistance = std::min(runDistance, chunk.distance);
+                continue;
+            }
+            asset.objectLoader->enqueueScatter(queue, pass, shader, context, runFirst, runCount, runLod, runDistance);
+            runCount = 0;
+            if (visible) {
+                runFirst = chunk.first[assetIndex];
+                runCount = count;
+                runLod = lod;
+                runDistance = chunk.distance;
+            }
+        }
+        asset.objectLoader->enqueueScatter(queue, pass, shader, context, runFirst, runCount, runLod, runDistance);
+    }
+}
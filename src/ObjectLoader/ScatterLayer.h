@@ -0,0 +1,121 @@
+#ifndef SCATTER_LAYER_H
+#define SCATTER_LAYER_H
+
+#include "Angel.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include "ObjectLoader.h"
+#include "ScatterInstance.h"
+#include "../Core/FrustumCulling.h"
+#include "../Grid/TerrainGrid.h"
+
+// Trees, rocks and props painted with a scatter brush rather than placed one by one.
+// Instances are Poisson-disk distributed, stored as 16-byte ScatterInstances in square
+// world chunks, and drawn instanced straight from one GL buffer per asset in which every
+// chunk is a contiguous range. Chunks are culled and given a LOD as a whole.
+class ScatterLayer {
+public:
+    struct BrushSettings {
+        float spacing = 6.0f;  // Minimum distance between any two scattered instances
+        float minScale = 0.8f; // Random scale range, on top of the asset's base transform
+        float maxScale = 1.2f;
+    };
+
+    // Scattered instances drawn by the main pass, and its chunks drawn and culled, during the last UpdateVisibility
+    struct Stats {
+        unsigned int instances = 0;
+        unsigned int chunksSubmitted = 0;
+        unsigned int chunksCulled = 0;
+    };
+
+    ScatterLayer();
+    ~ScatterLayer();
+    ScatterLayer(const ScatterLayer&) = delete;
+    ScatterLayer& operator=(const ScatterLayer&) = delete;
+
+    // Fills the brush circle with instances of `asset` until no more fit at `brush.spacing`
+    // from each other and from instances already there. baseTransform orients and sizes the
+    // model (like a GameObject's rotation and scale); the first one given for an asset sticks.
+    // Returns the number added.
+    size_t Scatter(ObjectLoader& asset, const mat4& baseTransform, const TerrainGrid& terrain,
+                   float centerX, float centerZ, float radius, const BrushSettings& brush);
+    // Adds already generated instances of `asset`, e.g. from a population pass
+    void Add(ObjectLoader& asset, const mat4& baseTransform, const ScatterInstance* instances, size_t count);
+    // Removes the instances inside the circle, of every asset or just `asset`
+    size_t Erase(float centerX, float centerZ, float radius, const ObjectLoader* asset = nullptr);
+    // Drops the instances on grid vertices `edited` back onto the terrain
+    void FollowTerrainEdits(const TerrainGrid& terrain, const TerrainNormals::Rect& edited);
+
+    // Re-uploads edited assets, then culls every chunk against both volumes and picks its LOD
+    void UpdateVisibility(const FrustumCulling::Frustum& mainFrustum, const FrustumCulling::Frustum& shadowFrustum,
+                          const vec3& cameraPosition, float pixelsPerUnit);
+    // Queues one instanced draw per mesh and run of adjacent visible chunks with the same LOD
+    void Enqueue(RenderQueue& queue, const Shader& shader, const ObjectRenderUniforms& uniforms, bool shadowPass,
+                 int lodBias = 0);
+
+    size_t GetInstanceCount() const { return instanceCount; }
+    const Stats& GetStats() const { return stats; }
+
+private:
+    // World units per chunk side: large enough to keep draws per asset low, small enough to cull well
+    static constexpr float CHUNK_SIZE = 64.0f;
+
+    struct Asset {
+        ObjectLoader* objectLoader;
+        mat4 baseTransform;
+        vec3 reachMin, reachMax; // Model box after baseTransform, widened to cover any yaw
+        bool resident;           // Whether reach came from the loaded model
+        GLuint instanceBuffer;
+        size_t bufferCapacity;   // In instances
+        bool dirty;              // Instances changed since the last upload
+        ScatterDrawContext drawContexts[2]; // Main and shadow pass, rebuilt by Enqueue
+    };
+
+    struct Chunk {
+        int x, z;
+        std::vector<std::vector<ScatterInstance>> instances; // Per asset
+        std::vector<GLsizei> first;                          // Per asset, into its instance buffer
+        std::vector<int> lods;                               // Per asset, kept for hysteresis
+        vec3 boundsMin, boundsMax; // Of every instance's model, when boundsDirty is false
+        float maxScale;            // Largest instance scale, for LOD selection
+        float distance;            // From the camera to the nearest point, when last in the main view
+        size_t instanceTotal;      // Over all assets
+        bool boundsDirty;
+        bool inMain, inShadow;
+    };
+
+    size_t AssetIndex(ObjectLoader& asset, const mat4& baseTransform);
+    void UpdateReach(Asset& asset);
+    Chunk& ChunkAt(int x, int z);
+    int ChunkCoord(float world) const { return static_cast<int>(std::floor(world / CHUNK_SIZE)); }
+    static uint64_t ChunkKey(int x, int z);
+    void UpdateBounds(Chunk& chunk);
+    void Upload(size_t assetIndex);
+
+    std::vector<Asset> assets;
+    std::vector<Chunk> chunks;
+    std::unordered_map<uint64_t, size_t> chunkIndices;
+    size_t instanceCount;
+    std::mt19937 random;
+
+    // Scratch kept between strokes so scattering doesn't allocate once warmed up
+    std::vector<vec2> candidates;
+    std::vector<vec2> blockers;          // Existing instances near the brush...
+    std::vector<int> blockerCellStart;   // ...bucketed by cells of side spacing
+    std::vector<vec2> blockersByCell;
+    std::vector<vec2> sampleGrid;        // The new sample in each cell of the sampling grid, if any
+    std::vector<size_t> activeSamples;
+    std::vector<float> heights;
+    std::vector<ScatterInstance*> followed;
+    std::vector<ScatterInstance> uploadScratch;
+    FrustumCulling::BoxList chunkBounds;
+    std::vector<uint8_t> visibleInMain;
+    std::vector<uint8_t> visibleInShadow;
+    Stats stats;
+};
+
+#endif // SCATTER_LAYER_H
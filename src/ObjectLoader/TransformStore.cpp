@@ -0,0 +1,212 @@
+#include "TransformStore.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <xmmintrin.h>
+#define TRANSFORM_STORE_SSE 1
+#endif
+
+TransformStore::TransformStore() {
+    count = 0;
+    dirtyCount = 0;
+}
+
+size_t TransformStore::Add() {
+    size_t index = count++;
+    size_t padded = (count + 3) & ~size_t(3);
+    if (positionX.size() < padded) {
+        // Grow every array by a whole SSE group of identity transforms
+        for (std::vector<float>* component : { &positionX, &positionY, &positionZ, &angleX, &angleY, &angleZ,
+                                               &sinX, &sinY, &sinZ }) {
+            component->resize(padded, 0.0f);
+        }
+        for (std::vector<float>* component : { &cosX, &cosY, &cosZ, &scale }) {
+            component->resize(padded, 1.0f);
+        }
+        instanceMatrices.resize(padded, mat4(1.0f));
+        dirtyBits.resize((padded + 63) / 64, 0);
+    } else {
+        // The slot may still hold a removed transform
+        positionX[index] = positionY[index] = positionZ[index] = 0.0f;
+        angleX[index] = angleY[index] = angleZ[index] = 0.0f;
+        sinX[index] = sinY[index] = sinZ[index] = 0.0f;
+        cosX[index] = cosY[index] = cosZ[index] = 1.0f;
+        scale[index] = 1.0f;
+    }
+    MarkDirty(index);
+    return index;
+}
+
+void TransformStore::Reserve(size_t capacity) {
+    size_t padded = (capacity + 3) & ~size_t(3);
+    for (std::vector<float>* component : { &positionX, &positionY, &positionZ, &angleX, &angleY, &angleZ,
+                                           &sinX, &cosX, &sinY, &cosY, &sinZ, &cosZ, &scale }) {
+        component->reserve(padded);
+    }
+    instanceMatrices.reserve(padded);
+    dirtyBits.reserve((padded + 63) / 64);
+}
+
+void TransformStore::Remove(size_t index) {
+    size_t last = --count;
+    uint64_t lastBit = uint64_t(1) << (last % 64);
+    bool lastDirty = (dirtyBits[last / 64] & lastBit) != 0;
+    if (index != last) {
+        for (std::vector<float>* component : { &positionX, &positionY, &positionZ, &angleX, &angleY, &angleZ,
+                                               &sinX, &cosX, &sinY, &cosY, &sinZ, &cosZ, &scale }) {
+            (*component)[index] = (*component)[last];
+        }
+        instanceMatrices[index] = instanceMatrices[last];
+        if (lastDirty) MarkDirty(index);
+    }
+    // The vacated slot stays allocated as padding for the next Add
+    if (lastDirty) {
+        dirtyBits[last / 64] &= ~lastBit;
+        --dirtyCount;
+    }
+}
+
+void TransformStore::MarkDirty(size_t index) {
+    uint64_t bit = uint64_t(1) << (index % 64);
+    uint64_t& word = dirtyBits[index / 64];
+    if (!(word & bit)) {
+        word |= bit;
+        ++dirtyCount;
+    }
+}
+
+void TransformStore::SetPosition(size_t index, const vec3& position) {
+    positionX[index] = position.x;
+    positionY[index] = position.y;
+    positionZ[index] = position.z;
+    MarkDirty(index);
+}
+
+void TransformStore::SetRotation(size_t index, const vec3& eulerDegrees) {
+    angleX[index] = eulerDegrees.x;
+    angleY[index] = eulerDegrees.y;
+    angleZ[index] = eulerDegrees.z;
+    // Trig happens here, once per change, so the batched pass is pure multiply-add
+    sinX[index] = std::sin(eulerDegrees.x * DegreesToRadians);
+    cosX[index] = std::cos(eulerDegrees.x * DegreesToRadians);
+    sinY[index] = std::sin(eulerDegrees.y * DegreesToRadians);
+    cosY[index] = std::cos(eulerDegrees.y * DegreesToRadians);
+    sinZ[index] = std::sin(eulerDegrees.z * DegreesToRadians);
+    cosZ[index] = std::cos(eulerDegrees.z * DegreesToRadians);
+    MarkDirty(index);
+}
+
+void TransformStore::SetScale(size_t index, float newScale) {
+    scale[index] = newScale;
+    MarkDirty(index);
+}
+
+void TransformStore::Update(unsigned int maxThreads) {
+    if (dirtyCount == 0) return;
+
+    const size_t wordCount = dirtyBits.size();
+    if (maxThreads == 0) maxThreads = std::thread::hardware_concurrency();
+    int threadCount = static_cast<int>(std::max(1u, maxThreads));
+    threadCount = static_cast<int>(std::min<size_t>(threadCount, wordCount));
+    if (dirtyCount < PARALLEL_UPDATE_THRESHOLD || threadCount <= 1) {
+        UpdateWords(0, wordCount);
+    } else {
+        // Contiguous bands of dirty words; each band writes only its own matrices
+        std::vector<std::thread> workers;
+        workers.reserve(threadCount - 1);
+        size_t wordsPerBand = (wordCount + threadCount - 1) / threadCount;
+        for (int band = 1; band < threadCount; band++) {
+            size_t firstWord = band * wordsPerBand;
+            if (firstWord >= wordCount) break;
+            workers.emplace_back(&TransformStore::UpdateWords, this, firstWord, std::min(wordCount, firstWord + wordsPerBand));
+        }
+        UpdateWords(0, std::min(wordCount, wordsPerBand));
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+    dirtyCount = 0;
+}
+
+void TransformStore::UpdateWords(size_t firstWord, size_t endWord) {
+    // M = T * Rz * Ry * Rx * S. With Angel's rotation matrices the 3x3 part is
+    //   | cz*cy   cz*sy*sx - sz*cx   cz*sy*cx + sz*sx |
+    //   | sz*cy   sz*sy*sx + cz*cx   sz*sy*cx - cz*sx | * scale
+    //   | -sy     cy*sx              cy*cx            |
+    // and the stored (transposed) matrix has M's columns as its rows.
+    for (size_t word = firstWord; word < endWord; ++word) {
+        uint64_t bits = dirtyBits[word];
+        if (bits == 0) continue;
+        dirtyBits[word] = 0;
+
+        // Rebuild whole groups of four; clean lanes in a dirty group just get rewritten unchanged
+        for (size_t group = 0; group < 16; ++group) {
+            if (((bits >> (group * 4)) & 0xFu) == 0) continue;
+            const size_t i = word * 64 + group * 4;
+            float* out = reinterpret_cast<float*>(&instanceMatrices[i]);
+
+#ifdef TRANSFORM_STORE_SSE
+            __m128 sx = _mm_loadu_ps(&sinX[i]), cx = _mm_loadu_ps(&cosX[i]);
+            __m128 sy = _mm_loadu_ps(&sinY[i]), cy = _mm_loadu_ps(&cosY[i]);
+            __m128 sz = _mm_loadu_ps(&sinZ[i]), cz = _mm_loadu_ps(&cosZ[i]);
+            __m128 s = _mm_loadu_ps(&scale[i]);
+
+            __m128 sysx = _mm_mul_ps(sy, sx);
+            __m128 sycx = _mm_mul_ps(sy, cx);
+            __m128 m00 = _mm_mul_ps(_mm_mul_ps(cz, cy), s);
+            __m128 m10 = _mm_mul_ps(_mm_mul_ps(sz, cy), s);
+            __m128 m20 = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), sy), s);
+            __m128 m01 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cz, sysx), _mm_mul_ps(sz, cx)), s);
+            __m128 m11 = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sz, sysx), _mm_mul_ps(cz, cx)), s);
+            __m128 m21 = _mm_mul_ps(_mm_mul_ps(cy, sx), s);
+            __m128 m02 = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cz, sycx), _mm_mul_ps(sz, sx)), s);
+            __m128 m12 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sz, sycx), _mm_mul_ps(cz, sx)), s);
+            __m128 m22 = _mm_mul_ps(_mm_mul_ps(cy, cx), s);
+            __m128 m03 = _mm_loadu_ps(&positionX[i]);
+            __m128 m13 = _mm_loadu_ps(&positionY[i]);
+            __m128 m23 = _mm_loadu_ps(&positionZ[i]);
+            __m128 zero0 = _mm_setzero_ps(), zero1 = zero0, zero2 = zero0;
+            __m128 one = _mm_set1_ps(1.0f);
+
+            // Each variable holds one matrix element for four objects; transposing the four
+            // elements of a column gives that column for each object
+            _MM_TRANSPOSE4_PS(m00, m10, m20, zero0);
+            _MM_TRANSPOSE4_PS(m01, m11, m21, zero1);
+            _MM_TRANSPOSE4_PS(m02, m12, m22, zero2);
+            _MM_TRANSPOSE4_PS(m03, m13, m23, one);
+            const __m128 laneColumns[4][4] = {
+                { m00, m01, m02, m03 }, { m10, m11, m12, m13 }, { m20, m21, m22, m23 }, { zero0, zero1, zero2, one }
+            };
+            for (int lane = 0; lane < 4; ++lane) {
+                for (int column = 0; column < 4; ++column) {
+                    _mm_storeu_ps(out + lane * 16 + column * 4, laneColumns[lane][column]);
+                }
+            }
+#else
+            for (int lane = 0; lane < 4; ++lane) {
+                const size_t k = i + lane;
+                float s = scale[k];
+                float* m = out + lane * 16;
+                m[0] = cosZ[k] * cosY[k] * s;
+                m[1] = sinZ[k] * cosY[k] * s;
+                m[2] = -sinY[k] * s;
+                m[3] = 0.0f;
+                m[4] = (cosZ[k] * sinY[k] * sinX[k] - sinZ[k] * cosX[k]) * s;
+                m[5] = (sinZ[k] * sinY[k] * sinX[k] + cosZ[k] * cosX[k]) * s;
+                m[6] = cosY[k] * sinX[k] * s;
+                m[7] = 0.0f;
+                m[8] = (cosZ[k] * sinY[k] * cosX[k] + sinZ[k] * sinX[k]) * s;
+                m[9] = (sinZ[k] * sinY[k] * cosX[k] - cosZ[k] * sinX[k]) * s;
+                m[10] = cosY[k] * cosX[k] * s;
+                m[11] = 0.0f;
+                m[12] = positionX[k];
+                m[13] = positionY[k];
+                m[14] = positionZ[k];
+                m[15] = 1.0f;
+            }
+#endif
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef TRANSFORM_STORE_H
+#define TRANSFORM_STORE_H
+
+#include "Angel.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Position, Euler angles and uniform scale of every GameObject as structure-of-arrays.
+// Setters only store the components and set a dirty bit; Update() then rebuilds all
+// dirty model matrices in one batched pass, four objects per SSE step and split across
+// threads for large batches. Matrices are written transposed (column-major), which is
+// the layout the instance buffers upload, so they can be copied there as is.
+class TransformStore {
+public:
+    TransformStore();
+
+    // Appends an identity transform and returns its index
+    size_t Add();
+    // Moves the last transform into index (swap-remove); the caller re-points whoever owned it
+    void Remove(size_t index);
+    // Preallocates room for capacity transforms so bulk Adds don't reallocate
+    void Reserve(size_t capacity);
+    size_t Size() const { return count; }
+
+    void SetPosition(size_t index, const vec3& position);
+    void SetRotation(size_t index, const vec3& eulerDegrees); // Applied as Rz * Ry * Rx, like Angel's RotateX/Y/Z
+    void SetScale(size_t index, float scale);
+
+    vec3 GetPosition(size_t index) const { return vec3(positionX[index], positionY[index], positionZ[index]); }
+    vec3 GetRotation(size_t index) const { return vec3(angleX[index], angleY[index], angleZ[index]); }
+    float GetScale(size_t index) const { return scale[index]; }
+
+    // Rebuilds the matrices of everything changed since the last call, on at most
+    // maxThreads threads (0: one per hardware thread)
+    void Update(unsigned int maxThreads = 0);
+
+    // Translate * Rz * Ry * Rx * Scale, transposed; current as of the last Update()
+    const mat4& GetInstanceMatrix(size_t index) const { return instanceMatrices[index]; }
+    // Same matrix in Angel's row-major convention
+    mat4 GetModelMatrix(size_t index) const { return transpose(instanceMatrices[index]); }
+
+private:
+    // Dirty batches at least this large are split across threads
+    static const size_t PARALLEL_UPDATE_THRESHOLD = 16384;
+
+    void MarkDirty(size_t index);
+    void UpdateWords(size_t firstWord, size_t endWord); // Rebuilds the dirty objects of dirtyBits[firstWord, endWord)
+
+    size_t count;
+    size_t dirtyCount; // Dirty bits set since the last Update (counted once each)
+
+    // Arrays are padded to a multiple of 4 so the SSE pass never reads past the end
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> angleX, angleY, angleZ;             // Degrees, as set
+    std::vector<float> sinX, cosX, sinY, cosY, sinZ, cosZ; // Of the angles, refreshed only when they change
+    std::vector<float> scale;
+    std::vector<uint64_t> dirtyBits;
+    std::vector<mat4> instanceMatrices;
+};
+
+#endif // TRANSFORM_STORE_H
@@ -1,4 +1,5 @@
 #include "UIButton.h"
+#include "../Core/TextureCache.h"
 #include <iostream>
 
 UIButton::UIButton(float x, float y, float width, float height, const std::string& text)
@@ -40,11 +41,21 @@ void UIButton::SetTexture(std::shared_ptr<Texture> texture) {
     m_texture = texture;
 }
 
-void UIButton::SetTexture(const std::string& texturePath) {
-    m_texture = std::make_shared<Texture>(GL_TEXTURE_2D, texturePath);
-    if (!m_texture->Load()) {
-        std::cerr << "Failed to load button texture: " << texturePath << std::endl;
+void UIButton::SetTexture(const std::string& texturePath, AssetLoader* loader) {
+    if (loader) {
+        // Buttons outlive the loader, which is drained before the first frame
         m_texture = nullptr;
+        TextureCache::getInstance().acquireAsync(texturePath, *loader, [this, texturePath](std::shared_ptr<Texture> texture) {
+            if (!texture) {
+                std::cerr << "Failed to load button texture: " << texturePath << std::endl;
+            }
+            m_texture = texture;
+        });
+        return;
+    }
+    m_texture = TextureCache::getInstance().acquire(texturePath);
+    if (!m_texture) {
+        std::cerr << "Failed to load button texture: " << texturePath << std::endl;
     }
 }
 
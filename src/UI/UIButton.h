@@ -7,6 +7,8 @@
 #include <string>
 #include <memory>
 
+class AssetLoader;
+
 class UIButton : public UIElement {
 public:
     UIButton(float x, float y, float width, float height, const std::string& text = "");
@@ -23,7 +25,7 @@ public:
     
     // Texture
     void SetTexture(std::shared_ptr<Texture> texture);
-    void SetTexture(const std::string& texturePath);
+    void SetTexture(const std::string& texturePath, AssetLoader* loader = nullptr); // Decodes on loader's workers if given
     bool HasTexture() const;
     std::shared_ptr<Texture> GetTexture() const;
     
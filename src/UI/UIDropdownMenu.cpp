@@ -12,6 +12,7 @@ UIDropdownMenu::UIDropdownMenu(float x, float y, float width, float itemHeight)
       m_animationSpeed(8.0f),
       m_animationProgress(0.0f),
       m_uiRenderer(nullptr),
+      m_assetLoader(nullptr),
       m_buttonsInRenderer(false)
 {
     // The dropdown starts with zero height when closed
@@ -28,7 +29,7 @@ void UIDropdownMenu::AddMenuItem(const std::string& text, std::function<void()>
     button->SetPressedColor(vec3(0.2f, 0.2f, 0.2f));
      if(res_path != ""){
         std::cout << "texture set ni" << std::endl;
-        button->SetTexture(res_path);
+        button->SetTexture(res_path, m_assetLoader);
     }
     
     // Wrap the callback to also close the menu when an item is clicked
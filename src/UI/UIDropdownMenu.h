@@ -30,6 +30,9 @@ public:
     
     // Set UIRenderer reference for managing menu items
     void SetUIRenderer(UIRenderer* renderer) { m_uiRenderer = renderer; }
+
+    // Item icons added while this is set are decoded on the loader's workers
+    void SetAssetLoader(AssetLoader* loader) { m_assetLoader = loader; }
     
     // Override input handling
     virtual bool OnClick(float x, float y) override;
@@ -59,6 +62,7 @@ private:
     
     // Reference to UIRenderer for managing button visibility
     UIRenderer* m_uiRenderer;
+    AssetLoader* m_assetLoader;
     bool m_buttonsInRenderer; // Track if buttons are currently in the renderer
     
     void UpdateItemPositions();
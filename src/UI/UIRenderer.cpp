@@ -2,6 +2,7 @@
 #include "UIElement.h"
 #include "UIButton.h"
 #include "../Core/ShaderManager.h"
+#include "../Core/GLStateCache.h"
 #include <iostream>
 
 UIRenderer::UIRenderer() 
@@ -56,12 +57,13 @@ void UIRenderer::SetScreenSize(int width, int height) {
 void UIRenderer::BeginUIRender() {
     if (!m_initialized) return;
     
+    GLStateCache& state = GLStateCache::GetInstance();
     // Disable depth testing for UI
-    glDisable(GL_DEPTH_TEST);
+    state.SetCapability(GL_DEPTH_TEST, false);
     
-    // Enable blending for transparency
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    // Enable blending for transparency; the function never changes, so only the first frame sets it
+    state.SetCapability(GL_BLEND, true);
+    state.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     
     // Use UI shader
     m_uiShader->use();
@@ -71,11 +73,12 @@ void UIRenderer::BeginUIRender() {
 void UIRenderer::EndUIRender() {
     if (!m_initialized) return;
     
+    GLStateCache& state = GLStateCache::GetInstance();
     // Re-enable depth testing
-    glEnable(GL_DEPTH_TEST);
+    state.SetCapability(GL_DEPTH_TEST, true);
     
     // Disable blending
-    glDisable(GL_BLEND);
+    state.SetCapability(GL_BLEND, false);
 }
 
 void UIRenderer::RenderUIElement(UIElement* element) {
@@ -89,22 +92,15 @@ void UIRenderer::RenderUIElement(UIElement* element) {
     UIButton* button = dynamic_cast<UIButton*>(element);
     if (button && button->HasTexture()) {
         m_uiShader->setUniform("u_hasTexture", true);
-        button->GetTexture()->Bind(GL_TEXTURE10);  // Use texture unit 6 to avoid conflicts
+        button->GetTexture()->Bind(GL_TEXTURE10);  // A unit of its own, clear of the scene's
         m_uiShader->setUniform("u_texture", 10);
     } else {
         m_uiShader->setUniform("u_hasTexture", false);
     }
     
-    // Render quad
-    glBindVertexArray(m_quadVAO);
+    // Render quad; unit 10 keeps its texture, so buttons sharing one don't rebind it
+    GLStateCache::GetInstance().BindVertexArray(m_quadVAO);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-    
-    // Clean up texture state if we used a texture
-    if (button && button->HasTexture()) {
-        glActiveTexture(GL_TEXTURE10);
-        glBindTexture(GL_TEXTURE_2D, 0);
-    }
 }
 
 void UIRenderer::AddUIElement(std::shared_ptr<UIElement> element) {
@@ -197,7 +193,7 @@ void UIRenderer::CreateQuadGeometry() {
     glGenBuffers(1, &m_quadVBO);
     glGenBuffers(1, &m_quadEBO);
     
-    glBindVertexArray(m_quadVAO);
+    GLStateCache::GetInstance().BindVertexArray(m_quadVAO);
     
     glBindBuffer(GL_ARRAY_BUFFER, m_quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
@@ -209,11 +205,11 @@ void UIRenderer::CreateQuadGeometry() {
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
     
-    glBindVertexArray(0);
+    GLStateCache::GetInstance().BindVertexArray(0);
 }
 
 void UIRenderer::Cleanup() {
-    if (m_quadVAO) glDeleteVertexArrays(1, &m_quadVAO);
+    GLStateCache::GetInstance().DeleteVertexArray(m_quadVAO);
     if (m_quadVBO) glDeleteBuffers(1, &m_quadVBO);
     if (m_quadEBO) glDeleteBuffers(1, &m_quadEBO);
     
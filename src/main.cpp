@@ -4,6 +4,8 @@
 #include "Core/Camera.h"
 #include "Grid/TerrainGrid.h"
 #include "Core/Texture.h"
+#include "Core/TextureCache.h"
+#include "Core/TextureArrayCache.h"
 #include "Core/light.h"
 #include "Core/Material.h"
 #include "ObjectLoader/GameObject.h"
@@ -11,11 +13,15 @@
 #include "Angel.h"
 #include "Core/CelestialLightManager.h"
 #include "ObjectLoader/GameObjectManager.h"
+#include "ObjectLoader/ObjectPopulation.h"
 #include "Core/ShadowMap.h"
 #include "UI/UIRenderer.h"
 #include "UI/UIButton.h"
 #include "UI/UIDropdownMenu.h"
 #include "Core/ObjectConfig.h"
+#include "Core/AssetLoader.h"
+#include "Core/RenderQueue.h"
+#include "Core/GLStateCache.h"
 
 #include <iostream>
 #include <memory>
@@ -49,10 +55,12 @@ const int WINDOW_WIDTH = 1920;
 const int WINDOW_HEIGHT = 1080;
 const int GRID_SIZE = 250; // Size of the grid
 const unsigned int SHADOW_WIDTH = 4096, SHADOW_HEIGHT = 4096; // Shadow map resolution
+const int SHADOW_LOD_BIAS = 1; // Shadow casters are drawn one LOD coarser than they are seen
+const uint32_t WORLD_SEED = 0x5EED; // The same seed populates the same world
 
 ObjectLoader* objectLoader;
 std::vector<ObjectLoader*> objectLoaders;
-GameObject* gameObject; //SelectedGameObject
+GameObjectHandle selectedObject; //SelectedGameObject; stale once destroyed
 
 // Forward declarations of callback functions
 static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -70,12 +78,14 @@ GameObjectManager* objectManager;
 std::vector<ObjectConfig> objectConfigs;
 
 
-// Grid demo application
-class GridDemo
+// Grid demo application; draws the terrain as a render queue packet
+class GridDemo : public RenderSource
 {
 public:
     GridDemo() = default;
     ~GridDemo() {
+        // Stop the workers before anything they might still be loading into goes away
+        m_assetLoader.reset();
         if (objectLoader) {
             delete objectLoader;
             objectLoader = nullptr;
@@ -89,10 +99,20 @@ public:
         InitCamera();
         InitMaterial();
         InitShader(); // This will now load both shaders
+
+        // Textures are decoded on worker threads while the Init* steps below run and
+        // uploaded when drained here; models are loaded on demand through the same
+        // loader, whose completions Run() processes every frame
+        m_assetLoader = std::make_unique<AssetLoader>();
+        std::cout << "Loading assets on " << m_assetLoader->GetThreadCount() << " threads" << std::endl;
         InitGrid();
         InitObjects();
+        PopulateWorld();
         InitLight();
         InitUI(); // Initialize UI system
+        m_assetLoader->WaitAll();
+        CheckTerrainTextures();
+
         m_celestialLightManager = std::make_unique<CelestialLightManager>(); // INITIALIZE LIGHT MANAGER
         
         // Initialize the Shadow Map
@@ -113,6 +133,9 @@ public:
             float deltaTime = static_cast<float>(currentFrameTime - lastFrameTime);
             lastFrameTime = currentFrameTime;
 
+            // Upload models whose on-demand load finished since the last frame
+            m_assetLoader->ProcessCompletions();
+
             // Update camera movement (smooth movement)
             if (camera) {
                 camera->UpdateMovement(deltaTime);
@@ -138,6 +161,7 @@ public:
             }
             
             RenderScene();
+            GLStateCache::GetInstance().EndFrame();
 
             window->pollEvents();
             window->swapBuffers();
@@ -155,13 +179,54 @@ public:
         
         glClear(GL_DEPTH_BUFFER_BIT);
          
-        // --- Render Terrain for Shadow Map ---
-        mat4 terrainModelMatrix = mat4(1.0f);
-        m_shadowShader->setUniform("gModelMatrix", terrainModelMatrix);
-        grid->Render();
+        // --- Render Terrain and Objects for Shadow Map ---
+        EnqueueTerrain(RenderQueue::SHADOW_PASS, *m_shadowShader, m_shadowObjectUniforms);
+        objectManager->Enqueue(m_renderQueue, *m_shadowShader, m_shadowObjectUniforms, GameObjectManager::RenderPass::Shadow, SHADOW_LOD_BIAS);
+        m_renderQueue.Submit(GLStateCache::GetInstance());
+    }
+
+    // The terrain sorts ahead of everything else drawn with its program (no texture or VAO
+    // in its key, depth 0), so it lays down depth before the objects standing on it
+    void EnqueueTerrain(unsigned int pass, const Shader& program, const ObjectRenderUniforms& uniforms)
+    {
+        RenderPacket packet = {};
+        packet.shader = &program;
+        packet.source = this;
+        packet.context = &uniforms;
+        packet.key = RenderQueue::MakeKey(pass, program.getProgramID(), 0, 0, 0.0f);
+        m_renderQueue.Add(packet);
+    }
 
-        // --- Render Objects for Shadow Map ---
-        objectManager->RenderAll(*m_shadowShader); // We need to modify RenderAll to accept a shader
+    void Draw(const RenderPacket& packet, bool continuing) override
+    {
+        const Shader& program = *packet.shader;
+        const ObjectRenderUniforms& uniforms = *static_cast<const ObjectRenderUniforms*>(packet.context);
+        // Object packets leave their own state behind; the terrain draws with float vertices and gModelMatrix
+        program.setUniform(uniforms.isTerrain, true);
+        program.setUniform(uniforms.instanced, false);
+        program.setUniform(uniforms.packedVertex, false);
+        program.setUniform(uniforms.scatter, false);
+        program.setUniform(uniforms.modelMatrix, mat4(1.0f));
+
+        if (&program == shader.get()) {
+            if (m_terrainMaterial && shader->isValid()) {
+                GLint specularIntensityLoc = shader->getUniformLocation("material.specularIntensity");
+                GLint shininessLoc = shader->getUniformLocation("material.shininess");
+                m_terrainMaterial->UseMaterial(specularIntensityLoc, shininessLoc);
+            }
+            shader->setUniform("gMinHeight", m_minTerrainHeight);
+            shader->setUniform("gMaxHeight", m_maxTerrainHeight);
+
+            // Units 0-4 belong to the terrain, so after the first frame these binds are all skipped
+            for (size_t i = 0; i < m_terrainTextures.size(); ++i) {
+                if (m_terrainTextures[i] && i < MAX_SHADER_TEXTURE_LAYERS) {
+                    m_terrainTextures[i]->Bind(GL_TEXTURE0 + static_cast<GLenum>(i));
+                    shader->setUniform("gTextureHeight" + std::to_string(i), static_cast<int>(i));
+                    shader->setUniform("gHeight" + std::to_string(i), m_terrainTextureTransitionHeights[i]);
+                }
+            }
+        }
+        grid->Render(&program == shader.get() ? m_mainFrustum : m_shadowFrustum);
     }
 
     
@@ -198,10 +263,38 @@ public:
             lightSpaceMatrix = lightProjection * lightView;
         }
  
+        // Use raycasting to position objects on terrain
+        GameObject* gameObject = objectManager->GetGameObject(selectedObject);
+        if (gameObject && gameObject->isInPlacement) {
+            vec3 intersectionPoint;
+            if (camera->GetTerrainIntersection(mouseX, mouseY, grid.get(), intersectionPoint)) {
+                // Center the object on the cursor by offsetting by half its width and depth
+                float halfWidth = gameObject->GetWidth() / 2.0f;
+                float halfDepth = gameObject->GetDepth() / 2.0f;
+                gameObject->SetPosition(vec4(intersectionPoint.x - halfDepth,
+                                           intersectionPoint.y,
+                                           intersectionPoint.z - halfWidth, 1.0f));
+            }
+        }
+
+        // Objects standing on terrain edited since the last frame follow the new surface
+        TerrainNormals::Rect editedRect;
+        if (grid->TakeHeightEdits(editedRect)) {
+            objectManager->FollowTerrainEdits(*grid, editedRect);
+        }
+
+        // Cull and upload object transforms once; both passes draw from the same instance buffers
+        const PersProjInfo& projInfo = camera->GetPersProjInfo();
+        float pixelsPerUnit = projInfo.Height / (2.0f * std::tan(projInfo.FOV * 0.5f * DegreesToRadians));
+        objectManager->UpdateInstances(camera->GetViewProjMatrix(), lightSpaceMatrix, camera->GetPosition(), pixelsPerUnit);
+        m_mainFrustum = FrustumCulling::FromMatrix(camera->GetViewProjMatrix());
+        m_shadowFrustum = FrustumCulling::FromMatrix(lightSpaceMatrix);
+
         // --- PASS 1 - Render scene to depth map ---
-        glCullFace(GL_FRONT); // Fix for peter-panning shadow artifact
+        GLStateCache& state = GLStateCache::GetInstance();
+        state.CullFace(GL_FRONT); // Fix for peter-panning shadow artifact
         RenderSceneForShadowMap(lightSpaceMatrix);
-        glCullFace(GL_BACK); // Reset culling
+        state.CullFace(GL_BACK); // Reset culling
 
         // --- PASS 2 - Render scene normally with shadows ---
         glBindFramebuffer(GL_FRAMEBUFFER, 0); // Bind back to default framebuffer
@@ -234,68 +327,33 @@ public:
         // Bind shadow map texture to an available texture unit (e.g., 5)
         m_shadowMap->Read(GL_TEXTURE5);
         shader->setUniform("shadowMap", 5); 
-        
-        // Debug: Verify shadow map is bound correctly
-        GLint currentTexture;
-        glActiveTexture(GL_TEXTURE5);
-        glGetIntegerv(GL_TEXTURE_BINDING_2D, &currentTexture);
+        // Set before any draw: left at unit 0 it would clash with the terrain's sampler2D there
+        shader->setUniform("objectTextureArray", static_cast<int>(RenderQueue::MATERIAL_ARRAY_UNIT));
         
         // Light Uniforms (The 'light' object is now configured by CelestialLightManager)
         if (light && shader->isValid()) {
-            GLuint shaderID = shader->getProgramID();
-            GLint ambientIntensityLoc = glGetUniformLocation(shaderID, "directionalLight.ambientIntensity");
-            GLint ambientColorLoc     = glGetUniformLocation(shaderID, "directionalLight.color");
-            GLint diffuseIntensityLoc = glGetUniformLocation(shaderID, "directionalLight.diffuseIntensity");
-            GLint directionLoc        = glGetUniformLocation(shaderID, "directionalLight.direction");
+            GLint ambientIntensityLoc = shader->getUniformLocation("directionalLight.ambientIntensity");
+            GLint ambientColorLoc     = shader->getUniformLocation("directionalLight.color");
+            GLint diffuseIntensityLoc = shader->getUniformLocation("directionalLight.diffuseIntensity");
+            GLint directionLoc        = shader->getUniformLocation("directionalLight.direction");
             light->UseLight(ambientIntensityLoc, ambientColorLoc, diffuseIntensityLoc, directionLoc); // Use the configured light
         }
 
-        // --- Render Terrain ---
-        shader->setUniform("u_isTerrain", true);
-
-        if (m_terrainMaterial && shader->isValid()) {
-            GLuint shaderID = shader->getProgramID();
-            GLint specularIntensityLoc = glGetUniformLocation(shaderID, "material.specularIntensity");
-            GLint shininessLoc = glGetUniformLocation(shaderID, "material.shininess");
-            m_terrainMaterial->UseMaterial(specularIntensityLoc, shininessLoc);
-        }
-        shader->setUniform("gMinHeight", m_minTerrainHeight);
-        shader->setUniform("gMaxHeight", m_maxTerrainHeight);
-        mat4 terrainModelMatrix = mat4(1.0f);
-        shader->setUniform("gModelMatrix", terrainModelMatrix);
-
-        for (size_t i = 0; i < m_terrainTextures.size(); ++i) {
-            if (m_terrainTextures[i] && i < MAX_SHADER_TEXTURE_LAYERS) {
-                m_terrainTextures[i]->Bind(GL_TEXTURE0 + static_cast<GLenum>(i));
-                shader->setUniform("gTextureHeight" + std::to_string(i), static_cast<int>(i));
-                shader->setUniform("gHeight" + std::to_string(i), m_terrainTextureTransitionHeights[i]);
-            }
-        }
-        grid->Render();
+        // --- Render Terrain and Objects ---
+        EnqueueTerrain(RenderQueue::MAIN_PASS, *shader, m_objectUniforms);
+        objectManager->Enqueue(m_renderQueue, *shader, m_objectUniforms, GameObjectManager::RenderPass::Main);
+        m_renderQueue.Submit(GLStateCache::GetInstance());
 
-        // --- Render Objects ---
-        shader->setUniform("u_isTerrain", false);
-        
-        // Debug: Check if shadow map is still bound before rendering objects
-        glActiveTexture(GL_TEXTURE5);
+#ifdef BUILDSIM_DEBUG_GL_STATE
+        // Debug: The cache's view of unit 5 must match GL's, or a bind was made around it
+        GLint currentTexture;
+        GLStateCache::GetInstance().ActiveTexture(5);
         glGetIntegerv(GL_TEXTURE_BINDING_2D, &currentTexture);
-
-        
-        // Use raycasting to position objects on terrain
-        if (gameObject && gameObject->isInPlacement) {
-            vec3 intersectionPoint;
-            if (camera->GetTerrainIntersection(mouseX, mouseY, grid.get(), intersectionPoint)) {
-                // Center the object on the cursor by offsetting by half its width and depth
-                float halfWidth = gameObject->GetWidth() / 2.0f;
-                float halfDepth = gameObject->GetDepth() / 2.0f;
-                gameObject->SetPosition(vec4(intersectionPoint.x - halfDepth,
-                                           intersectionPoint.y,
-                                           intersectionPoint.z - halfWidth, 1.0f));
-            }
+        if (static_cast<GLuint>(currentTexture) != m_shadowMap->GetTextureID()) {
+            std::cerr << "Shadow map unbound during the scene pass (unit 5 has " << currentTexture << ")" << std::endl;
         }
+#endif
 
-        objectManager->RenderAll(*shader);
-        
         // --- Render UI ---
         if (m_uiRenderer) {
             m_uiRenderer->RenderAll();
@@ -317,6 +375,29 @@ public:
                 case GLFW_KEY_C:
                     camera->Print();
                     break;
+                case GLFW_KEY_I: {
+                    const GameObjectManager::CullingStats& stats = objectManager->GetCullingStats();
+                    std::cout << "Objects drawn/culled: main " << stats.mainSubmitted << "/" << stats.mainCulled
+                              << ", shadow " << stats.shadowSubmitted << "/" << stats.shadowCulled << std::endl;
+                    const ScatterLayer::Stats& scatterStats = objectManager->GetScatterLayer().GetStats();
+                    std::cout << "Scattered instances: " << objectManager->GetScatterLayer().GetInstanceCount()
+                              << ", drawn " << scatterStats.instances << " in " << scatterStats.chunksSubmitted
+                              << " chunks, " << scatterStats.chunksCulled << " chunks culled" << std::endl;
+                    const RenderQueue::Stats& queueStats = m_renderQueue.GetStats();
+                    std::cout << "Main pass: " << queueStats.packets << " packets in " << queueStats.drawCalls
+                              << " draw calls" << std::endl;
+                    const GLStateCache::Stats& stateStats = GLStateCache::GetInstance().GetFrameStats();
+                    std::cout << "GL state calls last frame: " << stateStats.issued << " issued, "
+                              << stateStats.saved << " skipped as redundant" << std::endl;
+                    std::cout << "Material array layers:";
+                    for (int sizeClass = 0; sizeClass < TextureArrayCache::SIZE_CLASS_COUNT; ++sizeClass) {
+                        std::cout << " " << TextureArrayCache::getInstance().getLayerCount(sizeClass) << "/"
+                                  << TextureArrayCache::getInstance().getLayerCapacity(sizeClass) << " at "
+                                  << TextureArrayCache::getClassSize(sizeClass) << "px";
+                    }
+                    std::cout << std::endl;
+                    break;
+                }
                 case GLFW_KEY_P:
                     isTexturePainting = !isTexturePainting;
                     std::cout << "Texture painting mode: " << (isTexturePainting ? "ON" : "OFF") << std::endl;
@@ -367,6 +448,7 @@ public:
                     isDigging = false;
                     isRaising = false;
                     isInPlacement = false;
+                    isScattering = false;
                     if (isFlattening) {
                         // Ensure flatten captures the first click's height in this session
                         grid->ResetFlatteningState();
@@ -378,8 +460,33 @@ public:
 
                     break;
                 
+                case GLFW_KEY_T:
+                    // Scatter brush: paints the asset last picked from the object menu (Shift erases)
+                    isScattering = !isScattering;
+                    isTexturePainting = false;
+                    isFlattening = false;
+                    isDigging = false;
+                    isRaising = false;
+                    if (isScattering && scatterAsset < objectConfigs.size()) {
+                        std::cout << "Scatter mode: ON (" << objectConfigs[scatterAsset].displayName << ")" << std::endl;
+                    } else {
+                        std::cout << "Scatter mode: OFF" << std::endl;
+                    }
+                    break;
+
                 case GLFW_KEY_R:
-                    gameObject->RotateY(15.0f);
+                    if (GameObject* gameObject = objectManager->GetGameObject(selectedObject)) {
+                        gameObject->RotateY(15.0f);
+                    }
+                    break;
+
+                case GLFW_KEY_DELETE:
+                case GLFW_KEY_BACKSPACE:
+                    // Drop the selected object
+                    if (objectManager->DestroyObject(selectedObject)) {
+                        selectedObject = GameObjectHandle();
+                        std::cout << "Object removed (" << objectManager->GetObjectCount() << " left)" << std::endl;
+                    }
                     break;
                     
             }
@@ -405,7 +512,7 @@ public:
         mouseY = (static_cast<double>(y) * WINDOW_HEIGHT) / currentHeight;
         
         // Update texture painting while dragging with timing control
-        if ((isTexturePainting || isFlattening || isDigging || isRaising) &&
+        if ((isTexturePainting || isFlattening || isDigging || isRaising || isScattering) &&
                     glfwGetMouseButton(window->getHandle(), GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
                     
             // Add timing control to prevent excessive calls
@@ -432,6 +539,8 @@ public:
                     } else if (isRaising) {
                         grid->RaiseTerrain(intersectionPoint.x, intersectionPoint.z,
                                         frameRateAdjustedStrength, brushRadius, 1.0f);
+                    } else if (isScattering) {
+                        ApplyScatterBrush(intersectionPoint);
                     }
                     
                     lastTerrainModTime = currentTime;
@@ -465,7 +574,7 @@ public:
                 }
                     
                 // Only handle camera rotation if we're not in any terrain modification mode
-                if (!isTexturePainting && !isFlattening && !isDigging && !isRaising) {
+                if (!isTexturePainting && !isFlattening && !isDigging && !isRaising && !isScattering) {
                     camera->UpdateMousePos(x, y);
                     camera->StartRotation();
                 }
@@ -495,8 +604,12 @@ public:
                         grid->RaiseTerrain(intersectionPoint.x, intersectionPoint.z,
                                         initialStrength, brushRadius, 1.0f);
                     }
+                    if (isScattering) {
+                        ApplyScatterBrush(intersectionPoint);
+                    }
                 }
                 // Only finalize object placement if there's an object in placement mode
+                GameObject* gameObject = objectManager->GetGameObject(selectedObject);
                 if (gameObject && gameObject->isInPlacement) {
                     gameObject->isInPlacement = false;
                 }
@@ -506,6 +619,27 @@ public:
         }
     }
  
+    void ApplyScatterBrush(const vec3& point)
+    {
+        ScatterLayer& scatter = objectManager->GetScatterLayer();
+        if (glfwGetKey(window->getHandle(), GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) {
+            scatter.Erase(point.x, point.z, brushRadius);
+            return;
+        }
+        if (scatterAsset >= objectConfigs.size()) return;
+
+        const ObjectConfig& config = objectConfigs[scatterAsset];
+        ObjectLoader* objectLoader = objectLoaders[scatterAsset];
+        if (objectLoader->getLoadState() == ObjectLoader::LoadState::Failed) return;
+        if (objectLoader->getLoadState() == ObjectLoader::LoadState::Unloaded) {
+            // Instances show up once the model is resident
+            objectLoader->loadAsync(*m_assetLoader, config.filepath, config.intVector);
+        }
+        // Same rotation and scale a placed GameObject of this config gets
+        mat4 baseTransform = RotateZ(config.rotZ) * RotateY(config.rotY) * RotateX(config.rotX) * Scale(config.scale);
+        scatter.Scatter(*objectLoader, baseTransform, *grid, point.x, point.z, brushRadius, scatterBrush);
+    }
+
     void ResizeCB(int width, int height)
     {
         glViewport(0, 0, width, height);
@@ -535,13 +669,61 @@ private:
         
         objectManager = new GameObjectManager();
         
-        // Load all objects into objectLoaders
-        for(const auto& config : objectConfigs){
-            ObjectLoader* objectLoader = new ObjectLoader(*shader);
-            objectLoader->load(config.filepath, config.intVector); 
-            objectLoaders.push_back(objectLoader);
-            std::cout << "Loaded object: " << config.displayName << " from " << config.filepath << std::endl;
+        // Only create the loaders here; each model is loaded on its first use from the menu
+        for(size_t i = 0; i < objectConfigs.size(); ++i){
+            objectLoaders.push_back(new ObjectLoader(*shader));
+            // Every model's textures in the shared size-class arrays, so models batch together
+            objectLoaders.back()->setUseTextureArrays(true);
+            if (objectConfigs[i].displayName.find("Tree") != std::string::npos) {
+                scatterAsset = i; // The scatter brush paints forests unless told otherwise
+            }
+        }
+    }
+
+    // Covers the generated terrain with the configs that have a habitat (matched by name)
+    void PopulateWorld()
+    {
+        struct Habitat {
+            const char* keyword;
+            int splatLayer; // GridMesh order: sand, grass, dirt, rock, snow
+            float minSlope, maxSlope;
+            float spacing;
+            float density;
+        };
+        // Earlier habitats claim the ground first: rocks outcrop from steep rock, forests
+        // take the gentle grass, bushes fill in around them
+        const Habitat habitats[] = {
+            { "Rock", 3, 25.0f, 90.0f, 10.0f, 0.6f },
+            { "Tree", 1,  0.0f, 25.0f,  9.0f, 0.7f },
+            { "Bush", 1,  0.0f, 30.0f,  5.0f, 0.3f },
+        };
+
+        std::vector<PopulationRule> rules;
+        for (const Habitat& habitat : habitats) {
+            for (size_t i = 0; i < objectConfigs.size(); ++i) {
+                const ObjectConfig& config = objectConfigs[i];
+                if (config.displayName.find(habitat.keyword) == std::string::npos) continue;
+
+                PopulationRule rule;
+                rule.asset = objectLoaders[i];
+                rule.baseTransform = RotateZ(config.rotZ) * RotateY(config.rotY) * RotateX(config.rotX) * Scale(config.scale);
+                rule.splatLayer = habitat.splatLayer;
+                rule.minSlope = habitat.minSlope;
+                rule.maxSlope = habitat.maxSlope;
+                rule.spacing = habitat.spacing;
+                rule.density = habitat.density;
+                rules.push_back(rule);
+                // Instances show up once the model is resident
+                objectLoaders[i]->loadAsync(*m_assetLoader, config.filepath, config.intVector);
+                break;
+            }
         }
+        if (rules.empty()) return;
+
+        double start = glfwGetTime();
+        size_t count = populateObjects(*grid, rules, WORLD_SEED, objectManager->GetScatterLayer());
+        std::cout << "Populated the world with " << count << " objects in "
+                  << (glfwGetTime() - start) * 1000.0 << " ms" << std::endl;
     }
 
     void InitCamera()
@@ -602,6 +784,10 @@ private:
             exit(-1);
         }
         std::cout << "Shadow shader loaded successfully." << std::endl;
+
+        // Object draws use handles resolved here instead of per-draw lookups
+        m_objectUniforms = ObjectRenderUniforms(*shader);
+        m_shadowObjectUniforms = ObjectRenderUniforms(*m_shadowShader);
     }
     
     void InitUI()
@@ -617,19 +803,21 @@ private:
         menuButton->SetNormalColor(vec3(1.0f, 1.0f, 1.0f));  // White to show texture clearly
         menuButton->SetHoverColor(vec3(1.2f, 1.2f, 1.2f));   // Slightly brighter on hover
         menuButton->SetPressedColor(vec3(0.8f, 0.8f, 0.8f)); // Darker when pressed
-        menuButton->SetTexture("resources/icons/dice.png");  // Add icon texture
+        menuButton->SetTexture("resources/icons/dice.png", m_assetLoader.get());  // Add icon texture
 
         auto menuButton2 = std::make_shared<UIButton>(150.0f, WINDOW_HEIGHT - 130.0f, 120.0f, 120.0f, "Terrain");
         menuButton2->SetNormalColor(vec3(1.0f, 1.0f, 1.0f));  // White to show texture clearly
         menuButton2->SetHoverColor(vec3(1.2f, 1.2f, 1.2f));   // Slightly brighter on hover
         menuButton2->SetPressedColor(vec3(0.8f, 0.8f, 0.8f)); // Darker when pressed
-        menuButton2->SetTexture("resources/icons/brush.png"); // Add grass texture
+        menuButton2->SetTexture("resources/icons/brush.png", m_assetLoader.get()); // Add grass texture
         
         // Create dropdown menus that appears from the top
         m_objectMenu2 = std::make_shared<UIDropdownMenu>(150.0f, WINDOW_HEIGHT - 130.0f, 120.0f, 120.0f);
         m_objectMenu2 -> SetUIRenderer(m_uiRenderer.get());
+        m_objectMenu2->SetAssetLoader(m_assetLoader.get());
         m_objectMenu = std::make_shared<UIDropdownMenu>(20.0f, WINDOW_HEIGHT - 130.0f, 120.0f, 120.0f);
         m_objectMenu->SetUIRenderer(m_uiRenderer.get());
+        m_objectMenu->SetAssetLoader(m_assetLoader.get());
 
             
         m_objectMenu2->AddMenuItem("Rock", [this]() {
@@ -665,6 +853,7 @@ private:
             isFlattening = false;       // Disable other modes
             isRaising = false;
             isInPlacement = false;
+            isScattering = false;
             
         },"resources/icons/dig.png");
         m_objectMenu2->AddMenuItem("Raise", [this]() {
@@ -673,6 +862,7 @@ private:
                     isFlattening = false;
                     isDigging = false;
                     isInPlacement = false;
+                    isScattering = false;
                     if (isRaising) {
                         // Store initial heightmap when entering raising mode
                         grid->StoreInitHeightMap();
@@ -685,6 +875,7 @@ private:
             isDigging = false;
             isRaising = false;
             isInPlacement = false;
+            isScattering = false;
             std::cout << "Flattening mode: " << (isFlattening ? "ON" : "OFF") << std::endl;
         },"resources/icons/flatten.png");
        
@@ -698,10 +889,25 @@ private:
             
             m_objectMenu->AddMenuItem(config.displayName, [this, i]() {
                 const auto& config = objectConfigs[i];
-                std::cout << "Loading " << config.displayName << "..." << std::endl;
+                ObjectLoader* objectLoader = objectLoaders[i];
+                if (objectLoader->getLoadState() == ObjectLoader::LoadState::Failed) {
+                    std::cerr << "Cannot place " << config.displayName << ": its model failed to load" << std::endl;
+                    return;
+                }
+                if (isScattering) {
+                    // Pick what the scatter brush paints instead of placing a single object
+                    scatterAsset = i;
+                    std::cout << "Scattering " << config.displayName << std::endl;
+                    return;
+                }
+                if (objectLoader->getLoadState() == ObjectLoader::LoadState::Unloaded) {
+                    // First use: load in the background, a bounding box stands in until it's resident
+                    std::cout << "Loading " << config.displayName << "..." << std::endl;
+                    objectLoader->loadAsync(*m_assetLoader, config.filepath, config.intVector);
+                }
                 
-                int index = objectManager->CreateNewObject(*objectLoaders[i]);
-                GameObject* newGameObject = objectManager->GetGameObject(index);
+                GameObjectHandle handle = objectManager->CreateNewObject(*objectLoaders[i]);
+                GameObject* newGameObject = objectManager->GetGameObject(handle);
                 if (newGameObject) {
                     newGameObject->Scale(config.scale);
                     if (config.rotX != 0.0f) newGameObject->RotateX(config.rotX);
@@ -712,7 +918,7 @@ private:
                     isTexturePainting = false;  // Disable other modes
                     isFlattening = false;       // Disable other modes
                     isRaising = false;
-                    gameObject = newGameObject;
+                    selectedObject = handle;
                 }
                 isTexturePainting = false;
             }, config.iconPath);
@@ -744,6 +950,31 @@ private:
         float worldScale = 5.0f;
         float textureScale = 10.0f;
 
+        std::vector<std::string> texturePaths = {
+            "resources/textures/sand.jpg",
+            "resources/textures/grass.jpg",
+            "resources/textures/dirt.jpg",
+            "resources/textures/rock.jpg",
+            "resources/textures/snow.jpg"
+        };
+
+        // Start decoding the layer textures first so it overlaps terrain generation.
+        // Each layer keeps its slot; one that fails to load is left null and skipped when binding.
+        m_terrainTextures.clear();
+        for (size_t i = 0; i < texturePaths.size() && i < MAX_SHADER_TEXTURE_LAYERS; ++i) {
+            m_terrainTextures.push_back(nullptr);
+            TextureCache::getInstance().acquireAsync(texturePaths[i], *m_assetLoader,
+                [this, i, path = texturePaths[i]](std::shared_ptr<Texture> texture) {
+                if (texture) {
+                    m_terrainTextures[i] = texture;
+                    std::cout << "Loaded texture " << texture->GetFileName()
+                              << " with transition height " << m_terrainTextureTransitionHeights[i] << std::endl;
+                } else {
+                    std::cerr << "Failed to load terrain texture: " << path << std::endl;
+                }
+            });
+        }
+
         grid = std::make_unique<TerrainGrid>();
         TerrainGrid::TerrainType terrainType = TerrainGrid::TerrainType::VOLCANIC_CALDERA;
         float maxEdgeHeightForGenerator = 120.0f;
@@ -756,16 +987,6 @@ private:
         m_maxTerrainHeight = grid->GetMaxHeight();
 
         const auto& layerPercentages = grid->GetLayerInfo();
-        std::vector<std::string> texturePaths = {
-            "resources/textures/sand.jpg",
-            "resources/textures/grass.jpg",
-            "resources/textures/dirt.jpg",
-            "resources/textures/rock.jpg",
-            "resources/textures/snow.jpg"
-        };
-
-        m_terrainTextures.clear();
-        m_terrainTextureTransitionHeights.clear();
 
         float heightRange = m_maxTerrainHeight - m_minTerrainHeight;
         if (heightRange <= 1e-5f) {
@@ -779,23 +1000,18 @@ private:
         float transitionHeight4 = m_minTerrainHeight + heightRange * 0.80f; // rock -> snow
         float transitionHeight5 = m_maxTerrainHeight; // final snow
 
-        std::vector<float> calculatedTransitions = {
+        m_terrainTextureTransitionHeights = {
             transitionHeight1, transitionHeight2, transitionHeight3, transitionHeight4, transitionHeight5
         };
+    }
 
-        for (size_t i = 0; i < texturePaths.size(); ++i) {
-            if (i >= MAX_SHADER_TEXTURE_LAYERS) break;
-            auto tex = std::make_shared<Texture>(GL_TEXTURE_2D, texturePaths[i]);
-            if (tex->Load()) {
-                m_terrainTextures.push_back(tex);
-                m_terrainTextureTransitionHeights.push_back(calculatedTransitions[i]);
-                std::cout << "Loaded texture " << texturePaths[i] << " with transition height " << calculatedTransitions[i] << std::endl;
-            } else {
-                std::cerr << "Failed to load terrain texture: " << texturePaths[i] << std::endl;
-            }
+    void CheckTerrainTextures()
+    {
+        bool anyLoaded = false;
+        for (const auto& tex : m_terrainTextures) {
+            anyLoaded = anyLoaded || tex != nullptr;
         }
-
-        if (m_terrainTextures.empty()) {
+        if (!anyLoaded) {
             std::cerr << "CRITICAL: No terrain textures were loaded!" << std::endl;
         }
     }
@@ -807,6 +1023,10 @@ private:
     std::unique_ptr<Light> light; // The actual light object used by shaders
     std::unique_ptr<CelestialLightManager> m_celestialLightManager;
     std::unique_ptr<ShadowMap> m_shadowMap; // Shadow map member
+    ObjectRenderUniforms m_objectUniforms;
+    ObjectRenderUniforms m_shadowObjectUniforms;
+    RenderQueue m_renderQueue; // Refilled and submitted once per pass
+    FrustumCulling::Frustum m_mainFrustum, m_shadowFrustum; // Terrain tiles are culled against these
     bool m_isWireframe = false;
     float m_minTerrainHeight = 0.0f;
     float m_maxTerrainHeight = 1.0f;
@@ -814,6 +1034,7 @@ private:
     std::vector<std::shared_ptr<Texture>> m_terrainTextures;
     std::vector<float> m_terrainTextureTransitionHeights;
     std::unique_ptr<UIRenderer> m_uiRenderer;
+    std::unique_ptr<AssetLoader> m_assetLoader;
     std::shared_ptr<UIDropdownMenu> m_objectMenu, m_objectMenu2;
     static const int MAX_SHADER_TEXTURE_LAYERS = 5;
 
@@ -821,6 +1042,9 @@ private:
     bool isDigging = false;
     bool isRaising = false;
     bool isInPlacement = false;
+    bool isScattering = false;
+    size_t scatterAsset = 0; // Object config painted by the scatter brush
+    ScatterLayer::BrushSettings scatterBrush;
 };
 
 GridDemo* g_app = nullptr;
@@ -846,9 +1070,10 @@ int main(int argc, char** argv)
     g_app->Init();
 
     glFrontFace(GL_CCW);
-    glCullFace(GL_BACK);
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_DEPTH_TEST);
+    GLStateCache& state = GLStateCache::GetInstance();
+    state.CullFace(GL_BACK);
+    state.SetCapability(GL_CULL_FACE, true);
+    state.SetCapability(GL_DEPTH_TEST, true);
 
     g_app->Run();
 